@@ -0,0 +1,132 @@
+#pragma once
+#include <stdint.h>
+#include <stdlib.h>
+#include <vector>
+#include "clock.hpp"
+#include "singleton.hpp"
+
+#define BUFFER_POOL Common::ThreadLocalSingleton<Common::BufferPool>::Instance() // 获取当前线程的 Common::BufferPool 实例
+
+namespace Common {
+constexpr size_t BUFFER_POOL_MIN_SIZE = 256;               // 最小规格
+constexpr int BUFFER_POOL_CLASS_COUNT = 13;                // 规格数，从256B到1MB，每个规格是上一个的2倍
+constexpr size_t BUFFER_POOL_HEADROOM = 32;                // 每个规格额外预留的空间，使用方的小头部不会让缓冲区升到下一个规格
+constexpr int64_t BUFFER_POOL_TRIM_INTERVAL_MS = 1000;     // 高水位回收的时间间隔
+
+// 线程级的分规格缓冲区池，Packet和编解码器的缓冲区都从这里申请。每个规格一个空闲链表，
+// 申请时优先复用空闲的缓冲区，不需要每个消息都经过malloc/free，也减少了多线程下分配器的竞争。
+// 每个缓冲区都是单独malloc的，在其他线程释放的缓冲区直接放入释放线程的池中。
+// 空闲的缓冲区按高水位回收：每个回收周期内记录每个规格同时在用的峰值，周期结束时只保留回到峰值需要的空闲缓冲区，多余的释放。
+class BufferPool {
+public:
+    ~BufferPool() {
+        for (SizeClass &sizeClass : classes_) {
+            for (void *buf : sizeClass.free_)
+                free(buf);
+        }
+        exited() = true;
+    }
+    // 申请至少size字节的缓冲区，cap返回实际的容量。超过最大规格时直接malloc
+    static void *Acquire(size_t size, size_t &cap) {
+        int index = classIndex(size);
+        BufferPool *pool = local();
+        if (index < 0 || nullptr == pool) {
+            cap = size;
+            return malloc(size);
+        }
+        return pool->acquire(index, cap);
+    }
+    // 归还Acquire申请的缓冲区，cap是Acquire返回的容量
+    static void Release(void *buf, size_t cap) {
+        int index = classIndex(cap);
+        BufferPool *pool = local();
+        if (index < 0 || classSize(index) != cap || nullptr == pool) {
+            free(buf);
+            return;
+        }
+        pool->release(index, buf);
+    }
+
+    // 距离上一次回收超过了回收周期时按高水位回收，和协程池的内存回收一起在subReactor的事件循环中调用
+    bool TryTrim() {
+        int64_t now = Clock::NowMs();
+        if (now - last_trim_ms_ < BUFFER_POOL_TRIM_INTERVAL_MS)
+            return false;
+        last_trim_ms_ = now;
+        Trim();
+        return true;
+    }
+    // 每个规格只保留本周期内在用峰值和当前在用数的差值个空闲缓冲区，然后开始新的周期
+    void Trim() {
+        for (int i = 0; i < BUFFER_POOL_CLASS_COUNT; i++) {
+            SizeClass &sizeClass = classes_[i];
+            int64_t inUse = sizeClass.in_use_ > 0 ? sizeClass.in_use_ : 0; // 其他线程申请的缓冲区在这里释放时可能为负
+            int64_t keep = sizeClass.peak_in_use_ - inUse;
+            while ((int64_t)sizeClass.free_.size() > keep && not sizeClass.free_.empty()) {
+                free(sizeClass.free_.back());
+                sizeClass.free_.pop_back();
+                bytes_held_ -= classSize(i);
+            }
+            sizeClass.peak_in_use_ = inUse;
+        }
+    }
+
+    int64_t AllocCount() const { return alloc_count_; } // 从池中申请的次数
+    int64_t HitCount() const { return hit_count_; }     // 复用了空闲缓冲区的次数
+    double HitRate() const { return alloc_count_ > 0 ? hit_count_ * 1.0 / alloc_count_ : 0; }
+    int64_t BytesHeld() const { return bytes_held_; }   // 池中空闲缓冲区占用的内存
+    static size_t ClassSize(size_t size) { // size所在规格的大小，超过最大规格时返回0
+        int index = classIndex(size);
+        return index < 0 ? 0 : classSize(index);
+    }
+
+private:
+    typedef struct SizeClass {
+        std::vector<void *> free_; // 空闲的缓冲区，后进先出，优先复用最近释放的热缓冲区
+        int64_t in_use_{0};        // 当前在用的个数
+        int64_t peak_in_use_{0};   // 本回收周期内在用的峰值
+    } SizeClass;
+
+    void *acquire(int index, size_t &cap) {
+        SizeClass &sizeClass = classes_[index];
+        cap = classSize(index);
+        alloc_count_++;
+        if (++sizeClass.in_use_ > sizeClass.peak_in_use_)
+            sizeClass.peak_in_use_ = sizeClass.in_use_;
+        if (sizeClass.free_.empty())
+            return malloc(cap);
+        hit_count_++;
+        bytes_held_ -= cap;
+        void *buf = sizeClass.free_.back();
+        sizeClass.free_.pop_back();
+        return buf;
+    }
+    void release(int index, void *buf) {
+        SizeClass &sizeClass = classes_[index];
+        sizeClass.in_use_--;
+        sizeClass.free_.push_back(buf);
+        bytes_held_ += classSize(index);
+    }
+    static size_t classSize(int index) { return (BUFFER_POOL_MIN_SIZE << index) + BUFFER_POOL_HEADROOM; }
+    static int classIndex(size_t size) {
+        size_t len = size > BUFFER_POOL_HEADROOM ? size - BUFFER_POOL_HEADROOM : 0;
+        if (len <= BUFFER_POOL_MIN_SIZE)
+            return 0;
+        int index = 64 - __builtin_clzll((unsigned long long)(len - 1)) - 8; // 向上取整到2的幂，256是第0个规格
+        return index < BUFFER_POOL_CLASS_COUNT ? index : -1;
+    }
+    // 线程退出时池已经析构，之后释放的缓冲区直接free
+    static bool &exited() {
+        static thread_local bool value = false;
+        return value;
+    }
+    static BufferPool *local() { return exited() ? nullptr : &BUFFER_POOL; }
+
+private:
+    SizeClass classes_[BUFFER_POOL_CLASS_COUNT];
+    int64_t alloc_count_{0};
+    int64_t hit_count_{0};
+    int64_t bytes_held_{0};
+    int64_t last_trim_ms_{0};
+};
+} // namespace Common
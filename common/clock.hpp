@@ -0,0 +1,116 @@
+#pragma once
+#include <stdint.h>
+#include <time.h>
+#include <algorithm>
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
+
+namespace Common {
+// 时钟子系统：
+// 1. NowMs()：单调时钟，单位毫秒，定时器使用，系统时间被NTP调整时不受影响。
+// 2. WallMs()：墙上时钟（unix时间戳），单位毫秒，请求截止时间这类需要跨机器比较的时间使用。
+// 3. Ticks()：统计耗时使用，CPU支持不变TSC时直接读取TSC，否则读取单调时钟，TicksToUs()换算成微秒。
+// 事件循环在每次epoll_wait返回之后调用Update()，本轮事件处理中NowMs()和WallMs()直接返回缓存的时间，
+// 一个RPC中多次获取时间都不需要再读取时钟。没有调用过Update()的线程不使用缓存，每次都读取时钟。
+class Clock {
+public:
+    // 刷新当前线程缓存的时间，并开启缓存
+    static void Update() {
+        Cache &c = cache();
+        c.mono_ms_ = monoMs();
+        c.wall_ms_ = wallMs();
+        c.enabled_ = true;
+    }
+    // 读取最新的单调时间，开启了缓存时同时刷新缓存，定时器计算超时和执行超时回调时使用
+    static int64_t RefreshMs() {
+        int64_t now = monoMs();
+        Cache &c = cache();
+        if (c.enabled_)
+            c.mono_ms_ = now;
+        return now;
+    }
+    static int64_t NowMs() {
+        Cache &c = cache();
+        return c.enabled_ ? c.mono_ms_ : monoMs();
+    }
+    static int64_t WallMs() {
+        Cache &c = cache();
+        return c.enabled_ ? c.wall_ms_ : wallMs();
+    }
+    static int64_t Ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+        if (TscEnabled())
+            return (int64_t)__rdtsc();
+#endif
+        return monoNs();
+    }
+    static int64_t TicksToUs(int64_t ticks) {
+        double ticksPerUs = tscTicksPerUs();
+        if (ticksPerUs > 0)
+            return (int64_t)(ticks / ticksPerUs);
+        return ticks / 1000;
+    }
+    static bool TscEnabled() { return tscTicksPerUs() > 0; }
+
+private:
+    typedef struct Cache {
+        bool enabled_{false};
+        int64_t mono_ms_{0};
+        int64_t wall_ms_{0};
+    } Cache;
+    static Cache &cache() {
+        static thread_local Cache c;
+        return c;
+    }
+    static int64_t monoNs() {
+        struct timespec current;
+        clock_gettime(CLOCK_MONOTONIC, &current);
+        return current.tv_sec * 1000000000LL + current.tv_nsec;
+    }
+    static int64_t monoMs() { return monoNs() / 1000000; }
+    static int64_t wallMs() {
+        struct timespec current;
+        clock_gettime(CLOCK_REALTIME, &current);
+        return current.tv_sec * 1000LL + current.tv_nsec / 1000000;
+    }
+    // 每微秒的TSC计数，只在第一次使用时校准一次，CPU不支持不变TSC时为0
+    static double tscTicksPerUs() {
+        static double ticksPerUs = calibrateTsc();
+        return ticksPerUs;
+    }
+#if defined(__x86_64__) || defined(__i386__)
+    // 读取单调时钟，同时取读取前后两次TSC的中间值，减小读取时钟本身的耗时带来的误差
+    static int64_t pairedNs(uint64_t &tsc) {
+        uint64_t before = __rdtsc();
+        int64_t ns = monoNs();
+        tsc = before + (__rdtsc() - before) / 2;
+        return ns;
+    }
+#endif
+    static double calibrateTsc() {
+#if defined(__x86_64__) || defined(__i386__)
+        unsigned int eax, ebx, ecx, edx;
+        if (not __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) || 0 == (edx & (1 << 8)))
+            return 0; // 没有不变TSC，频率会随着CPU调频变化，不能用来计时
+        uint64_t tsc;
+        pairedNs(tsc); // 预热，第一次读取时钟可能有缺页等额外开销
+        double ratios[3];
+        for (int i = 0; i < 3; i++) { // 用单调时钟校准3次，每次2毫秒，取中间值排除被调度打断的那次
+            uint64_t beginTsc;
+            int64_t beginNs = pairedNs(beginTsc);
+            uint64_t endTsc;
+            int64_t endNs = pairedNs(endTsc);
+            while (endNs - beginNs < 2000000)
+                endNs = pairedNs(endTsc);
+            ratios[i] = (endTsc - beginTsc) * 1000.0 / (endNs - beginNs);
+        }
+        std::sort(ratios, ratios + 3);
+        return ratios[1];
+#else
+        return 0;
+#endif
+    }
+};
+} // namespace Common
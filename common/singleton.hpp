@@ -1,4 +1,5 @@
 #pragma once
+#include <memory>
 
 namespace Common
 {
@@ -11,4 +12,14 @@ public:
         return object;
     }
 };
+
+// 线程级单例模版类，每个线程各自拥有一个实例，用于每个subReactor线程独立的调度器、定时器和连接池
+template <class Type>
+class ThreadLocalSingleton {
+public:
+    static Type &Instance() {
+        static thread_local std::unique_ptr<Type> object(new Type);
+        return *object;
+    }
+};
 } // namespace Common
@@ -11,6 +11,8 @@ enum STATUS_CODE_FRAME_DEF {
     CONNECTION_FAILED = -101,    // 连接失败
     WRITE_FAILED = -102,         // 写失败
     READ_FAILED = -103,          // 读失败
+    DEADLINE_EXCEEDED = -104,    // 请求已经超过截止时间
+    OVERLOADED = -105,           // 服务端过载，请求被拒绝
     NOT_SUPPORT_RPC = -300,      // 不支持的rpc调用
     SERIALIZE_FAILED = -301,     // 序列化失败
     PARSE_FAILED = -302,         // 解析失败
@@ -36,6 +38,8 @@ public:
         Set(CONNECTION_FAILED, "connection failed");
         Set(WRITE_FAILED, "write failed");
         Set(READ_FAILED, "read failed");
+        Set(DEADLINE_EXCEEDED, "deadline exceeded");
+        Set(OVERLOADED, "server overloaded");
         Set(NOT_SUPPORT_RPC, "not support rpc");
         Set(SERIALIZE_FAILED, "serialize failed");
         Set(PARSE_FAILED, "parse failed");
@@ -1,48 +1,72 @@
 #pragma once
-#include <sys/time.h>
+#include <stdio.h>
+#include <time.h>
 #include <string>
+#include "clock.hpp"
 
 namespace Common {
 class TimeStat {
 public:
     TimeStat() { 
-        gettimeofday(&begin, NULL); 
+        begin_ = Clock::Ticks(); 
     }
     
     int64_t GetSpendTimeUs(bool reset = true) {
-        struct timeval temp;
-        struct timeval current;
-        gettimeofday(&current, NULL);
-        temp = current;
-        temp.tv_sec -= begin.tv_sec;
-        temp.tv_usec -= begin.tv_usec;
-        if (temp.tv_usec < 0) {
-            temp.tv_sec -= 1;
-            temp.tv_usec += 1000000;
-        }
+        int64_t current = Clock::Ticks();
+        int64_t spend = Clock::TicksToUs(current - begin_); // 计算运行的时间，单位微秒
         if (reset)
-            begin = current;
-        return temp.tv_sec * 1000000 + temp.tv_usec; // 计算运行的时间，单位微秒
+            begin_ = current;
+        return spend;
     }
 
 private:
-    struct timeval begin;
+    int64_t begin_; // 开始时的时钟计数，支持不变TSC时是TSC计数
 };
 
 class TimeFormat
 {
 public:
     static std::string GetTimeStr(const char *format, bool hasUSec = false) {
-        struct timeval curTime;
-        char temp[100] = {0};
-        char timeStr[100] = {0};
-        gettimeofday(&curTime, NULL);
-        strftime(temp, 99, format, localtime(&curTime.tv_sec));
+        struct timespec curTime;
+        clock_gettime(CLOCK_REALTIME, &curTime);
+        const std::string &secStr = formatSecond(format, curTime.tv_sec);
         if (hasUSec) {
-            snprintf(timeStr, 99, "%s:%06ld", temp, curTime.tv_usec);
+            char timeStr[100] = {0};
+            snprintf(timeStr, 99, "%s:%06ld", secStr.c_str(), curTime.tv_nsec / 1000);
             return std::string(timeStr);
         }
-        return std::string(temp);
+        return secStr;
+    }
+
+private:
+    typedef struct SecondCache {
+        std::string format_;
+        time_t sec_{-1};
+        std::string time_str_;
+    } SecondCache;
+    // 同一秒内格式化的结果不变，每个线程按格式缓存最近一秒的结果，日志不需要每条都调用localtime_r和strftime
+    static const std::string &formatSecond(const char *format, time_t sec) {
+        static thread_local SecondCache caches[4]; // 多个subReactor线程会并发调用
+        static thread_local int next = 0;
+        SecondCache *cache = nullptr;
+        for (int i = 0; i < 4 && nullptr == cache; i++) {
+            if (caches[i].format_ == format)
+                cache = &caches[i];
+        }
+        if (nullptr == cache) {
+            cache = &caches[next];
+            next = (next + 1) % 4;
+            cache->format_ = format;
+            cache->sec_ = -1;
+        }
+        if (cache->sec_ != sec) {
+            char temp[100] = {0};
+            struct tm tmTime;
+            strftime(temp, 99, format, localtime_r(&sec, &tmTime));
+            cache->sec_ = sec;
+            cache->time_str_ = temp;
+        }
+        return cache->time_str_;
     }
 };
 } // namespace Common
\ No newline at end of file
@@ -0,0 +1,66 @@
+#pragma once
+#include <stdint.h>
+#include <atomic>
+#include <deque>
+#include "../common/clock.hpp"
+#include "../common/singleton.hpp"
+#include "epollctl.hpp"
+
+#define ADMISSION Common::ThreadLocalSingleton<Core::Admission>::Instance() // 获取当前线程的 Core::Admission 实例
+
+namespace Core {
+// 过载时的准入控制。协程池满了之后，新请求所在的连接不再直接关闭，而是放入当前subReactor的有界等待队列，
+// 协程释放之后按先进先出的顺序创建协程处理。等待队列满了，或者请求排队超过了排队时间上限，则拒绝请求，
+// 由handler直接回复过载的错误并保留连接，避免客户端重连和重试让过载更严重。
+class Admission {
+public:
+    void Init(int64_t queueSize, int64_t queueTimeMs) {
+        queue_size_ = queueSize > 0 ? (size_t)queueSize : 0;
+        queue_time_ms_ = queueTimeMs;
+    }
+    // 放入等待队列，队列满了返回false
+    bool Push(EventData *eventData) {
+        if (pending_.size() >= queue_size_)
+            return false;
+        pending_.push_back(PendingConn{eventData, Common::Clock::NowMs()});
+        queueDepth()++;
+        return true;
+    }
+    bool Empty() const { return pending_.empty(); }
+    size_t Size() const { return pending_.size(); }
+    // 队首的请求是否已经排队超时，队列按入队时间有序，只需要检查队首
+    bool FrontExpired() const {
+        return not pending_.empty() && Common::Clock::NowMs() - pending_.front().enqueue_ms_ >= queue_time_ms_;
+    }
+    EventData *Pop() {
+        EventData *eventData = pending_.front().event_data_;
+        pending_.pop_front();
+        queueDepth()--;
+        return eventData;
+    }
+
+    // 所有subReactor的等待队列中的连接数，以及因为过载被拒绝的请求数
+    static int64_t QueueDepth() { return queueDepth().load(); }
+    static void AddShed() { shedCount()++; }
+    static int64_t ShedCount() { return shedCount().load(); }
+
+private:
+    typedef struct PendingConn {
+        EventData *event_data_;
+        int64_t enqueue_ms_; // 入队的时间
+    } PendingConn;
+    static std::atomic<int64_t> &queueDepth() {
+        static std::atomic<int64_t> depth{0};
+        return depth;
+    }
+    static std::atomic<int64_t> &shedCount() {
+        static std::atomic<int64_t> count{0};
+        return count;
+    }
+
+private:
+    std::deque<PendingConn> pending_;
+    size_t queue_size_{1024};    // 等待队列的容量，0表示不排队，协程池满了直接拒绝
+    int64_t queue_time_ms_{100}; // 请求在等待队列中排队的时间上限，单位毫秒
+};
+} // namespace Core
@@ -0,0 +1,199 @@
+#pragma once
+// 协程间通信的通道（Channel），语义类似golang的channel，用于在同一个线程的协程之间传递数据。
+// Send和Recv在通道满或者空的时候挂起当前协程，条件满足时由CoroutineWakeUp标记唤醒，
+// 再由主协程调用CoroutineResumeWakeUp恢复执行。数据在通道中只做移动，不做拷贝。
+// 共享栈模式下，协程栈上的变量不能被其他协程访问，通道对象需要分配在堆上。
+
+#include <assert.h>
+#include <stdint.h>
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <utility>
+#include <vector>
+#include "coroutine.h"
+#include "timer.hpp"
+
+namespace Core {
+constexpr size_t CHANNEL_UNBOUNDED = 0; // 容量为0表示无界通道，Send永远不会挂起
+constexpr int SELECT_NONE = -1;         // Select没有就绪的case或者等待超时
+
+class ChannelBase {
+public:
+    virtual ~ChannelBase() = default;
+    virtual bool CanRecv() const = 0; // 有数据可以读取，或者通道已经关闭
+    virtual bool CanSend() const = 0; // 有空位可以写入，或者通道已经关闭
+    bool IsClosed() const { return closed_; }
+    // 关闭通道，唤醒所有等待的协程。关闭之后Send失败，Recv读完剩余的数据之后失败
+    void Close() {
+        closed_ = true;
+        wakeUpAll(recv_waiters_);
+        wakeUpAll(send_waiters_);
+    }
+
+protected:
+    friend class Select;
+    std::deque<int> &waiters(bool isRecv) { return isRecv ? recv_waiters_ : send_waiters_; }
+    static void removeWaiter(std::deque<int> &waiters, int cid) {
+        waiters.erase(std::remove(waiters.begin(), waiters.end(), cid), waiters.end());
+    }
+    static void wakeUpAll(std::deque<int> &waiters) {
+        for (int cid : waiters)
+            MyCoroutine::CoroutineWakeUp(SCHEDULE, cid);
+        waiters.clear();
+    }
+    // 通道状态变化之后，条件满足的一侧唤醒一个等待者。被唤醒的协程如果最终没有处理这个通道（比如Select中处理了
+    // 其他通道），会再次调用notify把唤醒传递给下一个等待者，保证不会丢失唤醒
+    void notify() {
+        if (not recv_waiters_.empty() && CanRecv()) {
+            MyCoroutine::CoroutineWakeUp(SCHEDULE, recv_waiters_.front());
+            recv_waiters_.pop_front();
+        }
+        if (not send_waiters_.empty() && CanSend()) {
+            MyCoroutine::CoroutineWakeUp(SCHEDULE, send_waiters_.front());
+            send_waiters_.pop_front();
+        }
+    }
+    // 挂起当前协程直到被唤醒，唤醒之后需要调用方重新检查条件
+    void wait(bool isRecv) {
+        int cid = MyCoroutine::ScheduleGetRunCid(SCHEDULE);
+        waiters(isRecv).push_back(cid);
+        MyCoroutine::CoroutineYield(SCHEDULE);
+        removeWaiter(waiters(isRecv), cid);
+    }
+
+protected:
+    bool closed_{false};
+    std::deque<int> recv_waiters_; // 等待读取的协程id
+    std::deque<int> send_waiters_; // 等待写入的协程id
+};
+
+template <class Type>
+class Channel : public ChannelBase {
+public:
+    explicit Channel(size_t capacity = CHANNEL_UNBOUNDED) : capacity_(capacity) {}
+    bool CanRecv() const override { return not queue_.empty() || closed_; }
+    bool CanSend() const override { return CHANNEL_UNBOUNDED == capacity_ || queue_.size() < capacity_ || closed_; }
+    size_t Size() const { return queue_.size(); }
+    // 写入数据，通道满了挂起当前协程，只能在从协程中调用。通道已经关闭返回false，此时value没有被移走
+    bool Send(Type &&value) {
+        while (not TrySend(std::move(value))) {
+            if (closed_)
+                return false;
+            wait(false);
+        }
+        return true;
+    }
+    // 读取数据，通道空了挂起当前协程，只能在从协程中调用。通道已经关闭并且数据读完了返回false
+    bool Recv(Type &value) {
+        while (not TryRecv(value)) {
+            if (closed_)
+                return false;
+            wait(true);
+        }
+        return true;
+    }
+    // 非阻塞的写入，通道满了或者已经关闭返回false，主协程中也可以调用
+    bool TrySend(Type &&value) {
+        if (closed_ || (capacity_ != CHANNEL_UNBOUNDED && queue_.size() >= capacity_))
+            return false;
+        queue_.push_back(std::move(value));
+        notify();
+        return true;
+    }
+    // 非阻塞的读取，通道空了返回false，主协程中也可以调用
+    bool TryRecv(Type &value) {
+        if (queue_.empty())
+            return false;
+        value = std::move(queue_.front());
+        queue_.pop_front();
+        notify();
+        return true;
+    }
+
+private:
+    size_t capacity_;
+    std::deque<Type> queue_;
+};
+
+// 同时等待多个通道的读写，任意一个就绪就返回就绪的case的下标，多个case同时就绪时按添加的顺序选择
+class Select {
+public:
+    template <class Type>
+    int AddRecv(Channel<Type> &channel, Type &value) {
+        cases_.push_back({&channel, true, [&channel, &value]() { return channel.TryRecv(value); }});
+        return cases_.size() - 1;
+    }
+    // Wait返回之前一直引用value，所以只接受左值，只有对应的case被选中时value才会被移走
+    template <class Type>
+    int AddSend(Channel<Type> &channel, Type &value) {
+        cases_.push_back({&channel, false, [&channel, &value]() { return channel.TrySend(std::move(value)); }});
+        return cases_.size() - 1;
+    }
+    // 被选中的case是否读写成功，false表示通道已经关闭
+    bool Ok() const { return ok_; }
+    // 非阻塞的检查所有case，没有就绪的返回SELECT_NONE
+    int TryWait() {
+        for (size_t i = 0; i < cases_.size(); i++) {
+            if (cases_[i].try_op_()) {
+                ok_ = true;
+                return i;
+            }
+            if (cases_[i].channel_->IsClosed()) {
+                ok_ = false;
+                return i;
+            }
+        }
+        return SELECT_NONE;
+    }
+    // 等待任意一个case就绪，timeOutMs小于0表示一直等待，超时返回SELECT_NONE，只能在从协程中调用
+    int Wait(int64_t timeOutMs = -1) {
+        int index = TryWait();
+        if (index != SELECT_NONE || 0 == timeOutMs)
+            return index;
+        int cid = MyCoroutine::ScheduleGetRunCid(SCHEDULE);
+        SelectTimer *timer = nullptr; // 分配在堆上，原因见IoWait
+        uint64_t timerId = 0;
+        if (timeOutMs > 0) {
+            timer = new SelectTimer{cid, false};
+            timerId = TIMER.Register(onTimeOut, timer, timeOutMs);
+        }
+        while (SELECT_NONE == index && not(timer && timer->is_fired_)) {
+            for (auto &oneCase : cases_)
+                oneCase.channel_->waiters(oneCase.is_recv_).push_back(cid);
+            MyCoroutine::CoroutineYield(SCHEDULE);
+            for (auto &oneCase : cases_)
+                ChannelBase::removeWaiter(oneCase.channel_->waiters(oneCase.is_recv_), cid);
+            index = TryWait();
+        }
+        if (timer) {
+            if (not timer->is_fired_)
+                TIMER.Cancel(timerId);
+            delete timer;
+        }
+        for (auto &oneCase : cases_) // 可能被多个通道唤醒，没有处理的通道把唤醒传递给下一个等待者
+            oneCase.channel_->notify();
+        return index;
+    }
+
+private:
+    typedef struct SelectCase {
+        ChannelBase *channel_;
+        bool is_recv_;
+        std::function<bool()> try_op_;
+    } SelectCase;
+    typedef struct SelectTimer {
+        int cid_;
+        bool is_fired_;
+    } SelectTimer;
+    static void onTimeOut(void *data) {
+        SelectTimer *timer = (SelectTimer *)data;
+        timer->is_fired_ = true;
+        MyCoroutine::CoroutineWakeUp(SCHEDULE, timer->cid_);
+    }
+
+private:
+    bool ok_{false};
+    std::vector<SelectCase> cases_;
+};
+} // namespace Core
@@ -5,6 +5,7 @@
 #include "connmanager.hpp"
 #include "coroutineio.hpp"
 #include "coroutinelocal.hpp"
+#include "deadline.hpp"
 
 extern Core::CoroutineLocal<Core::TimeOut> RpcTimeOut; // rpc调用超时配置
 namespace Core {
@@ -39,6 +40,11 @@ protected:
         int statusCode = 0;
         std::string error = "";
         for (int i = 0; i < 3; i++) {
+            if (Deadline::IsExpired(Deadline::Get())) { // 请求已经超过截止时间，不再调用下游
+                statusCode = DEADLINE_EXCEEDED;
+                error = "deadline exceeded";
+                break;
+            }
             Conn *conn = getConn(serviceName);
             if (nullptr == conn) {
                 WARN("get conn failed. serviceName[%s]", serviceName.c_str());
@@ -55,6 +61,7 @@ protected:
                 continue;
             }
             RpcTimeOut.Set(conn->time_out_);
+            Deadline::ShrinkTimeOut(RpcTimeOut.Get()); // 超时不能超过请求剩余的时间
             if (not writeMessage(codec, reqMessage, conn->fd_, statusCode, error)) {
                 CONN_MANAGER.Release(conn);
                 continue;
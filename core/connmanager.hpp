@@ -9,7 +9,8 @@
 #include "coroutineio.hpp"
 #include "coroutinelocal.hpp"
 
-#define CONN_MANAGER Common::Singleton<Core::ConnManager>::Instance() // 获取 Core::ConnManager 的单例实例
+#define CONN_MANAGER Common::ThreadLocalSingleton<Core::ConnManager>::Instance() // 获取当前线程的 Core::ConnManager 实例
+extern Core::CoroutineLocal<int> EpollFd;
 extern Core::CoroutineLocal<Core::TimeOut> RpcTimeOut;
 
 namespace Core {
@@ -24,6 +25,9 @@ typedef struct Conn {
 
 class ConnManager {
 public:
+    ConnManager() {
+        PERSISTENT_EVENT.Get(-1); // 保证PersistentEvent先于连接池构造，线程退出时后于连接池析构
+    }
     ~ConnManager() {
         for (auto &connList : conn_pools_)
             for (Conn *conn : connList.second)
@@ -79,7 +83,6 @@ public:
     }
 
     void Put(Conn *conn) { // 归还一个连接
-        static Common::Percentile pct;
         assert(conn != nullptr);
         std::string serviceName = conn->service_name_;
         Common::Defer defer([this, serviceName]() {
@@ -89,9 +92,9 @@ public:
         auto iter = conn_pools_.find(serviceName);
         assert(iter != conn_pools_.end());
         iter->second.push_back(conn);
-        pct.Stat(serviceName, conn_stats_[serviceName]); // 更新服务的当前连接数
+        pct_.Stat(serviceName, conn_stats_[serviceName]); // 更新服务的当前连接数
         double pctValue;
-        if (not pct.GetPercentile(serviceName, 0.99, pctValue)) { //试获取该服务连接池的99百分位数值
+        if (not pct_.GetPercentile(serviceName, 0.99, pctValue)) { //试获取该服务连接池的99百分位数值
             return;
         }
         size_t remainCnt = (size_t)pctValue;
@@ -125,6 +128,7 @@ private:
         return false;
     }
     void deleteConn(Conn *conn) {
+        PERSISTENT_EVENT.Remove(conn->fd_);
         assert(0 == close(conn->fd_));
         delete conn;
     }
@@ -150,6 +154,8 @@ private:
             assert(0 == close(fd));
             return nullptr;
         }
+        if (not URING.Enabled()) // io_uring后端的读写不经过epoll
+            PERSISTENT_EVENT.Add(fd, EpollFd.Get()); // 连接在整个生命周期内都注册在epoll实例中，之后的读写不再需要epoll_ctl
         Conn *conn = new Conn;
         conn->fd_ = fd;
         conn->last_used_time_ = time(nullptr);
@@ -162,5 +168,6 @@ private:
     int64_t max_idle_time_{300};                          // 连接最大空闲时间，单位秒，默认5分钟
     std::map<std::string, std::list<Conn *>> conn_pools_; // 连接池
     std::map<std::string, int32_t> conn_stats_;           // 连接使用统计
+    Common::Percentile pct_;                              // 连接使用数的分位值统计，用于决定保留多少空闲连接
 };
 } // namespace Core
\ No newline at end of file
@@ -1,11 +1,111 @@
 #include "coroutine.h"
 
 #include <assert.h>
+#include <sys/mman.h>
+#include <unistd.h>
 
+#include <algorithm>
+#include <atomic>
 #include <iostream>
 
 #include "../common/percentile.hpp"
 
+#ifdef MY_COROUTINE_ASM_SWITCH
+// 把callee-saved寄存器压到当前栈上，栈顶指针保存到*fromSp中，再切换到toSp指向的栈上，恢复寄存器之后返回。
+// 调用约定保证了caller-saved寄存器由调用方保存，所以这里不需要保存全部寄存器，也不需要切换信号屏蔽字。
+extern "C" void MyCoroutineContextSwap(void **fromSp, void *toSp);
+// 新协程第一次被切入时的入口，从callee-saved寄存器中取出入口函数和参数，然后调用入口函数
+extern "C" void MyCoroutineContextEntry();
+#if defined(__x86_64__)
+asm(R"(
+    .text
+    .p2align 4
+    .globl MyCoroutineContextSwap
+    .hidden MyCoroutineContextSwap
+    .type MyCoroutineContextSwap, @function
+MyCoroutineContextSwap:
+    pushq %rbp
+    pushq %rbx
+    pushq %r12
+    pushq %r13
+    pushq %r14
+    pushq %r15
+    subq $8, %rsp
+    stmxcsr (%rsp)
+    fnstcw 4(%rsp)
+    movq %rsp, (%rdi)
+    movq %rsi, %rsp
+    ldmxcsr (%rsp)
+    fldcw 4(%rsp)
+    addq $8, %rsp
+    popq %r15
+    popq %r14
+    popq %r13
+    popq %r12
+    popq %rbx
+    popq %rbp
+    ret
+    .size MyCoroutineContextSwap, .-MyCoroutineContextSwap
+
+    .p2align 4
+    .globl MyCoroutineContextEntry
+    .hidden MyCoroutineContextEntry
+    .type MyCoroutineContextEntry, @function
+MyCoroutineContextEntry:
+    movq %r12, %rdi
+    callq *%r13
+    ud2
+    .size MyCoroutineContextEntry, .-MyCoroutineContextEntry
+)");
+#elif defined(__aarch64__)
+asm(R"(
+    .text
+    .p2align 4
+    .globl MyCoroutineContextSwap
+    .hidden MyCoroutineContextSwap
+    .type MyCoroutineContextSwap, %function
+MyCoroutineContextSwap:
+    sub sp, sp, #160
+    stp x19, x20, [sp, #0]
+    stp x21, x22, [sp, #16]
+    stp x23, x24, [sp, #32]
+    stp x25, x26, [sp, #48]
+    stp x27, x28, [sp, #64]
+    stp x29, x30, [sp, #80]
+    stp d8, d9, [sp, #96]
+    stp d10, d11, [sp, #112]
+    stp d12, d13, [sp, #128]
+    stp d14, d15, [sp, #144]
+    mov x2, sp
+    str x2, [x0]
+    mov sp, x1
+    ldp x19, x20, [sp, #0]
+    ldp x21, x22, [sp, #16]
+    ldp x23, x24, [sp, #32]
+    ldp x25, x26, [sp, #48]
+    ldp x27, x28, [sp, #64]
+    ldp x29, x30, [sp, #80]
+    ldp d8, d9, [sp, #96]
+    ldp d10, d11, [sp, #112]
+    ldp d12, d13, [sp, #128]
+    ldp d14, d15, [sp, #144]
+    add sp, sp, #160
+    ret
+    .size MyCoroutineContextSwap, .-MyCoroutineContextSwap
+
+    .p2align 4
+    .globl MyCoroutineContextEntry
+    .hidden MyCoroutineContextEntry
+    .type MyCoroutineContextEntry, %function
+MyCoroutineContextEntry:
+    mov x0, x19
+    blr x20
+    brk #0
+    .size MyCoroutineContextEntry, .-MyCoroutineContextEntry
+)");
+#endif
+#endif
+
 namespace MyCoroutine
 {
 
@@ -13,12 +113,72 @@ namespace MyCoroutine
     {
         assert(batchId >= 0 && batchId < MAX_BATCH_RUN_SIZE);
         assert(schedule.batchs[batchId]->state == Run); // 校验batch的状态，必须是run的状态
-        for (const auto &kv : schedule.batchs[batchId]->cid2finish)
+        return 0 == schedule.batchs[batchId]->pendingCnt;
+    }
+
+    static ReadyQueue &readyQueueOf(Schedule &schedule, Coroutine *routine)
+    {
+        // 插入了batch卡点的协程放在单独的队列中，只有没有其他可运行的协程时才会被调度
+        return routine->isInsertBatch ? schedule.batchReadyQueue : schedule.readyQueue;
+    }
+
+    static void readyQueueInit(ReadyQueue &queue)
+    {
+        queue.bitmap = 0;
+        for (int i = 0; i < PRIORITY_BUCKET_SIZE; i++)
         {
-            if (not kv.second)
-                return false; // 只要有一个关联的协程没执行完，就返回false
+            queue.heads[i] = INVALID_ROUTINE_ID;
+            queue.tails[i] = INVALID_ROUTINE_ID;
         }
-        return true;
+    }
+
+    static int readyQueueBucket(uint32_t priority)
+    {
+        return priority < PRIORITY_BUCKET_SIZE ? (int)priority : PRIORITY_BUCKET_SIZE - 1;
+    }
+
+    // 协程进入ready或者suspend状态时，插入就绪队列对应桶的尾部
+    static void readyQueuePush(Schedule &schedule, int id)
+    {
+        Coroutine *routine = schedule.coroutines[id];
+        ReadyQueue &queue = readyQueueOf(schedule, routine);
+        int bucket = readyQueueBucket(routine->priority);
+        routine->prevReady = queue.tails[bucket];
+        routine->nextReady = INVALID_ROUTINE_ID;
+        if (queue.tails[bucket] == INVALID_ROUTINE_ID)
+            queue.heads[bucket] = id;
+        else
+            schedule.coroutines[queue.tails[bucket]]->nextReady = id;
+        queue.tails[bucket] = id;
+        queue.bitmap |= (1u << bucket);
+    }
+
+    // 协程被唤醒运行时，从就绪队列中摘除，时间复杂度为O(1)
+    static void readyQueueRemove(Schedule &schedule, int id)
+    {
+        Coroutine *routine = schedule.coroutines[id];
+        ReadyQueue &queue = readyQueueOf(schedule, routine);
+        int bucket = readyQueueBucket(routine->priority);
+        if (routine->prevReady == INVALID_ROUTINE_ID)
+            queue.heads[bucket] = routine->nextReady;
+        else
+            schedule.coroutines[routine->prevReady]->nextReady = routine->nextReady;
+        if (routine->nextReady == INVALID_ROUTINE_ID)
+            queue.tails[bucket] = routine->prevReady;
+        else
+            schedule.coroutines[routine->nextReady]->prevReady = routine->prevReady;
+        if (queue.heads[bucket] == INVALID_ROUTINE_ID)
+            queue.bitmap &= ~(1u << bucket);
+        routine->prevReady = INVALID_ROUTINE_ID;
+        routine->nextReady = INVALID_ROUTINE_ID;
+    }
+
+    // 获取就绪队列中优先级最高的协程id，队列为空则返回INVALID_ROUTINE_ID
+    static int readyQueueFront(ReadyQueue &queue)
+    {
+        if (0 == queue.bitmap)
+            return INVALID_ROUTINE_ID;
+        return queue.heads[__builtin_ctz(queue.bitmap)]; // 最低位的非空桶就是优先级最高的桶
     }
 
     static void CoroutineRun(Schedule *schedule)
@@ -31,13 +191,16 @@ namespace MyCoroutine
         routine->entry(routine->arg);
         // entry函数执行完之后，才能把协程状态更新为idle，并标记runningCoroutineId为无效的id
         routine->state = Idle;
+        // 归还到空闲链表的头部，最近使用过的协程优先被复用，其协程栈大概率还在cpu cache中
+        routine->nextIdle = schedule->idleHead;
+        schedule->idleHead = id;
         // 如果有关联的batch，则要更新batch的信息，设置batch关联的协程已经执行完
         if (routine->relateBatchId != INVALID_BATCH_ID)
         {
             Batch *batch = schedule->batchs[routine->relateBatchId];
-            batch->cid2finish[id] = true;
-            // batch都执行完了，则更新batchFinishList。
-            if (isBatchDone(*schedule, routine->relateBatchId))
+            batch->pendingCnt--;
+            // batch都执行完了，则更新batchFinishList。BatchRun之前就都执行完的，由BatchRun直接返回
+            if (0 == batch->pendingCnt && Run == batch->state)
             {
                 schedule->batchFinishList.push_back(batch->relateId);
             }
@@ -45,34 +208,263 @@ namespace MyCoroutine
         }
         schedule->activityCnt--;
         schedule->runningCoroutineId = INVALID_ROUTINE_ID;
+        if (schedule->sharedStackCnt > 0)
+        {
+            // 协程执行完了，共享栈上的内容不再需要保存，后续切入的协程不需要换出它
+            schedule->sharedStacks[routine->sharedStackId].ownerId = INVALID_ROUTINE_ID;
+        }
         if (schedule->stackCheck)
         {
             assert(Normal == CoroutineStackCheck(*schedule, id));
         }
-        // 这个函数执行完，调用栈会回到主协程中，执行routine->ctx.uc_link指向的上下文的下一条指令
+        // UContext模式下，这个函数执行完，调用栈会回到主协程中，执行routine->ctx.uc_link指向的上下文的下一条指令；
+        // Assembly模式下，由CoroutineAsmRun负责切换回主协程
     }
 
-    static void CoroutineInit(Schedule &schedule, Coroutine *routine, Entry entry, void *arg, uint32_t priority,
-                              int relateBatchId)
+    static int pageSize()
     {
+        static int size = (int)sysconf(_SC_PAGESIZE);
+        return size;
+    }
+
+    // 填充栈两端的canary内容
+    static void stackFillCanary(uint8_t *stack, int32_t stackSize)
+    {
+        memset(stack, CANARY_PADDING, CANARY_SIZE);
+        memset(stack + stackSize - CANARY_SIZE, CANARY_PADDING, CANARY_SIZE);
+    }
+
+    // 协程栈所在的槽位，每个槽位由一个保护页和一个协程栈组成
+    static size_t stackSlotSize(Schedule &schedule) { return pageSize() + schedule.stackSize; }
+
+    // 预留所有协程栈的虚拟地址空间，物理内存只在页被第一次访问时才由内核分配，所以名义上的栈大小可以设置得比较大
+    static void stackRegionInit(Schedule &schedule, int slotCnt)
+    {
+        schedule.stackRegionSize = slotCnt * stackSlotSize(schedule);
+        void *region = mmap(nullptr, schedule.stackRegionSize, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        assert(region != MAP_FAILED);
+        schedule.stackRegion = (uint8_t *)region;
+    }
+
+    // 从stackRegion中取出第slot个槽位放置大小为stackSize的协程栈，栈贴着槽位的高地址端放置，
+    // 栈下方（低地址）剩余的空间都设置为PROT_NONE的保护区，栈溢出时会立即触发段错误。
+    // 每个保护区都会拆分出独立的内存映射区域，超出vm.max_map_count时mprotect会失败，这时退化为只有canary检测。
+    // oldStackSize是槽位中原来放置的栈的大小，栈变大时需要把原来保护区的一部分恢复成可读写。
+    static uint8_t *stackAlloc(Schedule &schedule, int slot, int32_t stackSize, int32_t oldStackSize = 0)
+    {
+        uint8_t *slotBase = schedule.stackRegion + slot * stackSlotSize(schedule);
+        uint8_t *stack = slotBase + stackSlotSize(schedule) - stackSize;
+        mprotect(slotBase, stack - slotBase, PROT_NONE);
+        if (oldStackSize > 0 && stackSize > oldStackSize)
+            mprotect(stack, stackSize - oldStackSize, PROT_READ | PROT_WRITE);
+        stackFillCanary(stack, stackSize);
+        return stack;
+    }
+
+    // 协程栈的栈顶，按16字节对齐
+    static uint8_t *stackTop(Schedule &schedule, Coroutine *routine)
+    {
+        uintptr_t top = (uintptr_t)(routine->stack + routine->stackSize - CANARY_SIZE);
+        return (uint8_t *)(top & ~(uintptr_t)15);
+    }
+
+#ifdef MY_COROUTINE_ASM_SWITCH
+    // Assembly模式下协程的入口，entry执行完之后没有uc_link可以用，需要主动切换回主协程
+    static void CoroutineAsmRun(Schedule *schedule)
+    {
+        Coroutine *routine = schedule->coroutines[schedule->runningCoroutineId];
+        CoroutineRun(schedule);
+        MyCoroutineContextSwap(&routine->sp, schedule->mainSp); // 不会再返回
+        assert(0);
+    }
+
+    // 在协程栈上构造一个初始的寄存器保存帧，第一次切入时MyCoroutineContextSwap恢复寄存器之后，
+    // 会ret到MyCoroutineContextEntry，再由它调用CoroutineAsmRun(schedule)，作用等价于makecontext。
+    static void contextMake(Schedule &schedule, Coroutine *routine)
+    {
+        uintptr_t top = (uintptr_t)stackTop(schedule, routine);
+#if defined(__x86_64__)
+        uint64_t *frame = (uint64_t *)(top - 8 * sizeof(uint64_t));
+        uint32_t mxcsr = 0;
+        uint16_t fpucw = 0;
+        asm volatile("stmxcsr %0\n\tfnstcw %1" : "=m"(mxcsr), "=m"(fpucw));
+        memset(frame, 0, 8 * sizeof(uint64_t));
+        frame[0] = (uint64_t)mxcsr | ((uint64_t)fpucw << 32); // 浮点控制字沿用主协程的
+        frame[3] = (uint64_t)CoroutineAsmRun;                 // r13，入口函数
+        frame[4] = (uint64_t)&schedule;                       // r12，入口函数的参数
+        frame[7] = (uint64_t)MyCoroutineContextEntry;         // 返回地址，ret之后rsp是16字节对齐的
+#elif defined(__aarch64__)
+        uint64_t *frame = (uint64_t *)(top - 20 * sizeof(uint64_t));
+        memset(frame, 0, 20 * sizeof(uint64_t));
+        frame[0] = (uint64_t)&schedule;                // x19，入口函数的参数
+        frame[1] = (uint64_t)CoroutineAsmRun;          // x20，入口函数
+        frame[11] = (uint64_t)MyCoroutineContextEntry; // x30，ret返回的地址
+#endif
+        routine->sp = frame;
+    }
+#else
+    static void contextMake(Schedule &schedule, Coroutine *routine) { assert(0); }
+#endif
+
+#ifdef MY_COROUTINE_ASM_SWITCH
+    // 把占用共享栈的协程实际使用的栈内容（从切出时的栈顶指针到栈底）保存到它的私有缓冲区中
+    static void sharedStackSave(Schedule &schedule, Coroutine *routine)
+    {
+        uint8_t *top = stackTop(schedule, routine);
+        int32_t used = (int32_t)(top - (uint8_t *)routine->sp);
+        assert(used > 0 && used <= routine->stackSize);
+        if (routine->saveCap < used)
+        {
+            // 私有缓冲区按实际使用的大小分配，向上取整到1KB，避免栈深度小幅波动时反复分配
+            routine->saveCap = (used + 1023) & ~1023;
+            free(routine->saveBuffer);
+            routine->saveBuffer = (uint8_t *)malloc(routine->saveCap);
+        }
+        memcpy(routine->saveBuffer, routine->sp, used);
+        routine->saveSize = used;
+    }
+
+    // 共享栈模式下，协程切入之前（在主协程中执行）把共享栈准备好：换出当前占用共享栈的协程，再换入要切入的协程
+    static void sharedStackSwitchIn(Schedule &schedule, int id)
+    {
+        Coroutine *routine = schedule.coroutines[id];
+        SharedStack &shared = schedule.sharedStacks[routine->sharedStackId];
+        if (shared.ownerId != id && shared.ownerId != INVALID_ROUTINE_ID)
+        {
+            sharedStackSave(schedule, schedule.coroutines[shared.ownerId]);
+        }
+        if (not routine->isStackInit)
+        {
+            contextMake(schedule, routine); // 第一次运行，在共享栈上构造初始的栈帧
+            routine->isStackInit = true;
+        }
+        else if (shared.ownerId != id)
+        {
+            memcpy(routine->sp, routine->saveBuffer, routine->saveSize); // 恢复之前保存的栈内容
+        }
+        shared.ownerId = id;
+    }
+#endif
+
+    // 统计栈使用量时，协程创建时把栈（除去两端的canary）填充为CANARY_PADDING，
+    // 上一次执行只改写了栈顶端stackUsed大小的空间，只需要重新填充这部分
+    static void stackProfileFill(Coroutine *routine)
+    {
+        uint8_t *begin = routine->stack + CANARY_SIZE;
+        uint8_t *end = routine->stack + routine->stackSize - CANARY_SIZE;
+        if (end - begin > routine->stackUsed)
+            begin = end - routine->stackUsed;
+        memset(begin, CANARY_PADDING, end - begin);
+    }
+
+    // 协程执行结束之后（在主协程中执行），从栈的低地址端开始找到第一个被改写的字节，得到栈的最大使用量
+    static void stackProfileRecord(Schedule &schedule, Coroutine *routine)
+    {
+        uint8_t *begin = routine->stack + CANARY_SIZE;
+        uint8_t *end = routine->stack + routine->stackSize - CANARY_SIZE;
+        uint8_t *cur = begin;
+        while (cur < end && CANARY_PADDING == *cur)
+            cur++;
+        routine->stackUsed = (int32_t)(end - cur);
+        int32_t bucket = (routine->stackUsed + STACK_USAGE_BUCKET_SIZE - 1) / STACK_USAGE_BUCKET_SIZE * STACK_USAGE_BUCKET_SIZE;
+        const std::string &tag = routine->stackTag.empty() ? std::string("default") : routine->stackTag;
+        for (auto *usage : {&schedule.stackUsage["all"], &schedule.stackUsage[tag]})
+        {
+            usage->count++;
+            usage->max = std::max(usage->max, routine->stackUsed);
+            usage->histogram[bucket]++;
+        }
+        StackUsage &all = schedule.stackUsage["all"];
+        if (StackProfileAutoSize == schedule.stackProfileMode && 0 == all.count % STACK_AUTO_SIZE_SAMPLE)
+        {
+            // 新协程的栈大小取p99.9的使用量加上余量，按页对齐，不超过ScheduleInit时设置的栈大小
+            int32_t stackSize = StackUsagePercentile(all, 0.999) + STACK_AUTO_SIZE_HEADROOM + 2 * CANARY_SIZE;
+            stackSize = (stackSize + pageSize() - 1) / pageSize() * pageSize();
+            schedule.autoStackSize = std::min(stackSize, schedule.stackSize);
+        }
+    }
+
+    // 从主协程切换到从协程
+    static void switchToCoroutine(Schedule &schedule, int id)
+    {
+        Coroutine *routine = schedule.coroutines[id];
+#ifdef MY_COROUTINE_ASM_SWITCH
+        if (schedule.sharedStackCnt > 0)
+        {
+            sharedStackSwitchIn(schedule, id);
+        }
+        if (Assembly == schedule.switchMode)
+        {
+            MyCoroutineContextSwap(&schedule.mainSp, routine->sp);
+        }
+        else
+#endif
+        {
+            swapcontext(&schedule.main, &routine->ctx);
+        }
+        if (schedule.stackProfileMode != StackProfileOff && Idle == routine->state)
+        {
+            stackProfileRecord(schedule, routine); // 协程执行结束了，统计栈使用量
+        }
+    }
+
+    // 从从协程切换回主协程
+    static void switchToMain(Schedule &schedule, Coroutine *routine)
+    {
+#ifdef MY_COROUTINE_ASM_SWITCH
+        if (Assembly == schedule.switchMode)
+        {
+            MyCoroutineContextSwap(&routine->sp, schedule.mainSp);
+            return;
+        }
+#endif
+        swapcontext(&routine->ctx, &(schedule.main));
+    }
+
+    static void CoroutineInit(Schedule &schedule, int id, Entry entry, void *arg, uint32_t priority, int relateBatchId)
+    {
+        Coroutine *routine = schedule.coroutines[id];
         routine->arg = arg;
         routine->entry = entry;
         routine->state = Ready;
         routine->priority = priority;
         routine->relateBatchId = relateBatchId;
         routine->isInsertBatch = false;
-        if (nullptr == routine->stack)
+        routine->isWakeUpPending = false;
+        int32_t stackSize = schedule.autoStackSize > 0 ? schedule.autoStackSize : schedule.stackSize;
+        if (nullptr == routine->stack || routine->stackSize != stackSize)
+        { // 第一次使用，或者自动调整了栈大小，需要在槽位中重新放置协程栈
+            routine->stack = stackAlloc(schedule, id, stackSize, routine->stack ? routine->stackSize : 0);
+            routine->stackSize = stackSize;
+            routine->stackUsed = stackSize;
+        }
+        else if (routine->isStackCold)
+        {
+            stackFillCanary(routine->stack, routine->stackSize); // madvise之后页的内容被清零了，需要重新填充canary
+            routine->stackUsed = stackSize;
+        }
+        routine->isStackCold = false;
+        routine->stackTag.clear();
+        routine->localMask = 0; // 上一次运行设置的本地变量不再可见，内存留给本次运行原地复用
+        if (schedule.stackProfileMode != StackProfileOff)
+        {
+            stackProfileFill(routine);
+        }
+        if (schedule.sharedStackCnt > 0)
+        {
+            routine->isStackInit = false; // 共享栈可能正在被其他协程使用，初始栈帧延迟到第一次切入时再构造
+            return;
+        }
+        if (Assembly == schedule.switchMode)
         {
-            routine->stack = new uint8_t[schedule.stackSize];
-            // 填充栈顶canary内容
-            memset(routine->stack, CANARY_PADDING, CANARY_SIZE);
-            // 填充栈底canary内容
-            memset(routine->stack + schedule.stackSize - CANARY_SIZE, CANARY_PADDING, CANARY_SIZE);
+            contextMake(schedule, routine);
+            return;
         }
         getcontext(&(routine->ctx));
         routine->ctx.uc_stack.ss_flags = 0;
         routine->ctx.uc_stack.ss_sp = routine->stack + CANARY_SIZE;
-        routine->ctx.uc_stack.ss_size = schedule.stackSize - 2 * CANARY_SIZE;
+        routine->ctx.uc_stack.ss_size = routine->stackSize - 2 * CANARY_SIZE;
         routine->ctx.uc_link = &(schedule.main);
         // 设置routine->ctx上下文要执行的函数和对应的参数，
         // 这里没有直接使用entry和arg设置，而是多包了一层CoroutineRun函数的调用，
@@ -83,32 +475,23 @@ namespace MyCoroutine
 
     int CoroutineCreate(Schedule &schedule, Entry entry, void *arg, uint32_t priority, int relateBatchId)
     {
-        int id = 0;
-        for (id = 0; id < schedule.coroutineCnt; id++)
-        {
-            if (schedule.coroutines[id]->state == Idle)
-                break;
-        }
-        if (id >= schedule.coroutineCnt)
+        // 直接从空闲链表的头部取出一个空闲的协程，时间复杂度为O(1)
+        int id = schedule.idleHead;
+        if (id == INVALID_ROUTINE_ID)
         {
             return INVALID_ROUTINE_ID;
         }
-        schedule.activityCnt++;
         Coroutine *routine = schedule.coroutines[id];
-        CoroutineInit(schedule, routine, entry, arg, priority, relateBatchId);
+        assert(routine->state == Idle);
+        schedule.idleHead = routine->nextIdle;
+        routine->nextIdle = INVALID_ROUTINE_ID;
+        schedule.activityCnt++;
+        CoroutineInit(schedule, id, entry, arg, priority, relateBatchId);
+        readyQueuePush(schedule, id); // 新创建的协程是ready状态，进入就绪队列
         return id;
     }
 
-    bool CoroutineCanCreate(Schedule &schedule)
-    {
-        int id = 0;
-        for (id = 0; id < schedule.coroutineCnt; id++)
-        {
-            if (schedule.coroutines[id]->state == Idle)
-                return true;
-        }
-        return false;
-    }
+    bool CoroutineCanCreate(Schedule &schedule) { return schedule.idleHead != INVALID_ROUTINE_ID; }
 
     void CoroutineYield(Schedule &schedule)
     {
@@ -118,46 +501,24 @@ namespace MyCoroutine
         Coroutine *routine = schedule.coroutines[schedule.runningCoroutineId];
         // 更新当前的从协程状态为挂起
         routine->state = Suspend;
+        readyQueuePush(schedule, id);
         // 当前的从协程让出执行权，并把当前的从协程的执行上下文保存到routine->ctx中，
-        // 执行权回到主协程中，主协程再做调度，当从协程被主协程resume时，swapcontext才会返回。
-        swapcontext(&routine->ctx, &(schedule.main));
+        // 执行权回到主协程中，主协程再做调度，当从协程被主协程resume时，才会返回。
+        switchToMain(schedule, routine);
         schedule.isMasterCoroutine = false;
     }
 
     int CoroutineResume(Schedule &schedule)
     {
         assert(schedule.isMasterCoroutine);
-        bool isInsertBatch = true;
-        uint32_t priority = UINT32_MAX;
-        int coroutineId = INVALID_ROUTINE_ID;
-        // 按优先级调度，选择优先级最高的状态为挂起的从协程来运行，并考虑是否插入了batch卡点
-        for (int i = 0; i < schedule.coroutineCnt; i++)
+        // 按优先级调度，选择优先级最高的状态为挂起或者就绪的从协程来运行，没batch卡点的协程优先级更高
+        bool isInsertBatch = false;
+        int coroutineId = readyQueueFront(schedule.readyQueue);
+        if (coroutineId == INVALID_ROUTINE_ID)
         {
-            if (schedule.coroutines[i]->state == Idle || schedule.coroutines[i]->state == Run)
-            {
-                continue;
-            }
-            // 执行到这里，schedule.coroutines[i]->state的值为 Suspend 或者 Ready
-            if (not schedule.coroutines[i]->isInsertBatch && isInsertBatch)
-            { // 没batch卡点的协程优先级更高
-                coroutineId = i;
-                priority = schedule.coroutines[i]->priority;
-                isInsertBatch = false;
-            }
-            else if (schedule.coroutines[i]->isInsertBatch && not isInsertBatch)
-            {
-                // 插入batch卡点的协程优先级更低，所以这里不更新isInsertBatch，priority，coroutineId
-            }
-            else
-            { // 都没插入batch卡点 或者 都插入了batch卡点
-                if (schedule.coroutines[i]->priority < priority)
-                {
-                    coroutineId = i;
-                    priority = schedule.coroutines[i]->priority;
-                }
-            }
+            isInsertBatch = true;
+            coroutineId = readyQueueFront(schedule.batchReadyQueue);
         }
-
         if (coroutineId == INVALID_ROUTINE_ID)
             return NotRunnable;
         Coroutine *routine = schedule.coroutines[coroutineId];
@@ -166,11 +527,13 @@ namespace MyCoroutine
         {
             assert(isBatchDone(schedule, routine->relateBatchId)); // batch卡点关联的协程必须全部执行完
         }
+        readyQueueRemove(schedule, coroutineId);
         routine->state = Run;
+        routine->isWakeUpPending = false; // 已经运行了，之前的唤醒标记失效
         schedule.runningCoroutineId = coroutineId;
         // 从主协程切换到协程编号为id的协程中执行，并把当前执行上下文保存到schedule.main中，
-        // 当从协程执行结束或者从协程主动yield时，swapcontext才会返回。
-        swapcontext(&schedule.main, &routine->ctx);
+        // 当从协程执行结束或者从协程主动yield时，才会返回。
+        switchToCoroutine(schedule, schedule.runningCoroutineId);
         schedule.isMasterCoroutine = true;
         return Success;
     }
@@ -186,11 +549,13 @@ namespace MyCoroutine
         // 有被插入batch卡点的，需要batch执行完才可以唤醒
         if (routine->isInsertBatch && not isBatchDone(schedule, routine->relateBatchId))
             return NotRunnable;
+        readyQueueRemove(schedule, id);
         routine->state = Run;
+        routine->isWakeUpPending = false; // 已经运行了，之前的唤醒标记失效
         schedule.runningCoroutineId = id;
         // 从主协程切换到协程编号为id的协程中执行，并把当前执行上下文保存到schedule.main中，
-        // 当从协程执行结束或者从协程主动yield时，swapcontext才会返回。
-        swapcontext(&schedule.main, &routine->ctx);
+        // 当从协程执行结束或者从协程主动yield时，才会返回。
+        switchToCoroutine(schedule, schedule.runningCoroutineId);
         schedule.isMasterCoroutine = true;
         return Success;
     }
@@ -204,13 +569,10 @@ namespace MyCoroutine
         if (not routine->isInsertBatch)
             return NotRunnable;
         int batchId = routine->relateBatchId;
-        auto iter = schedule.batchs[batchId]->cid2finish.begin();
         // 恢复batch关联的所有从协程
-        while (iter != schedule.batchs[batchId]->cid2finish.end())
+        for (int cid : schedule.batchs[batchId]->children)
         {
-            assert(iter->second == false);
-            assert(CoroutineResumeById(schedule, iter->first) == Success);
-            iter++;
+            assert(CoroutineResumeById(schedule, cid) == Success);
         }
         return Success;
     }
@@ -229,6 +591,39 @@ namespace MyCoroutine
         return Success;
     }
 
+    void CoroutineWakeUp(Schedule &schedule, int id)
+    {
+        assert(id >= 0 && id < schedule.coroutineCnt);
+        Coroutine *routine = schedule.coroutines[id];
+        if (routine->isWakeUpPending)
+            return;
+        routine->isWakeUpPending = true;
+        schedule.wakeUpList.push_back(id);
+    }
+
+    int CoroutineResumeWakeUp(Schedule &schedule)
+    {
+        assert(schedule.isMasterCoroutine);
+        if (schedule.wakeUpList.empty())
+            return NotRunnable;
+        std::vector<int> wakeUpList;
+        while (not schedule.wakeUpList.empty() || not schedule.batchFinishList.empty())
+        {
+            // 被唤醒的batch子协程执行完之后，关联的协程在batchFinishList中，事件循环中不一定还有其他地方恢复它
+            CoroutineResumeBatchFinish(schedule);
+            wakeUpList.swap(schedule.wakeUpList); // 唤醒的过程中会继续标记新的协程
+            for (int cid : wakeUpList)
+            {
+                // 标记之后已经通过其他方式运行过的协程，不再唤醒，避免唤醒复用了同一个id的新协程
+                if (not schedule.coroutines[cid]->isWakeUpPending)
+                    continue;
+                CoroutineResumeById(schedule, cid);
+            }
+            wakeUpList.clear();
+        }
+        return Success;
+    }
+
     bool CoroutineIsInBatch(Schedule &schedule)
     {
         assert(not schedule.isMasterCoroutine);
@@ -236,41 +631,33 @@ namespace MyCoroutine
         return schedule.coroutines[cid]->relateBatchId != INVALID_BATCH_ID;
     }
 
-    void CoroutineLocalSet(Schedule &schedule, void *key, LocalData localData)
+    int CoroutineLocalSlotAlloc()
+    {
+        static std::atomic<int> slotCnt{0};
+        int slot = slotCnt++;
+        assert(slot < MAX_LOCAL_SLOT_SIZE); // 最多创建MAX_LOCAL_SLOT_SIZE个协程本地变量
+        return slot;
+    }
+    LocalData &CoroutineLocalSet(Schedule &schedule, int slot)
     {
         assert(not schedule.isMasterCoroutine); // 从协程中才可以调用
-        int cid = schedule.runningCoroutineId;
-        auto iter = schedule.coroutines[cid]->local.find(key);
-        if (iter != schedule.coroutines[cid]->local.end())
-        {
-            iter->second.freeEntry(iter->second.data); // 之前有值，则要先释放空间
-        }
-        schedule.coroutines[cid]->local[key] = localData;
+        Coroutine *routine = schedule.coroutines[schedule.runningCoroutineId];
+        routine->localMask |= (1u << slot);
+        return routine->local[slot];
     }
-
-    bool CoroutineLocalGet(Schedule &schedule, void *key, LocalData &localData)
+    void *CoroutineLocalGetFromBatch(Schedule &schedule, int slot)
     {
         assert(not schedule.isMasterCoroutine); // 从协程中才可以调用
-        int cid = schedule.runningCoroutineId;
-        auto iter = schedule.coroutines[cid]->local.find(key);
-        if (iter == schedule.coroutines[cid]->local.end())
-        {
-            // 如果不存在，判断是否有关联batch，
-            int relateBatchId = schedule.coroutines[cid]->relateBatchId;
-            if (relateBatchId == INVALID_BATCH_ID)
-                return false;
-            // 从被插入batch卡点的协程中查找，进而实现部分协程间本地变量的共享
-            Batch *batch = schedule.batchs[relateBatchId];
-            iter = schedule.coroutines[batch->relateId]->local.find(key);
-            if (iter == schedule.coroutines[batch->relateId]->local.end())
-                return false;
-            localData = iter->second;
-            return true;
-        }
-        localData = iter->second;
-        return true;
+        // 如果不存在，判断是否有关联batch，
+        int relateBatchId = schedule.coroutines[schedule.runningCoroutineId]->relateBatchId;
+        if (relateBatchId == INVALID_BATCH_ID)
+            return nullptr;
+        // 从被插入batch卡点的协程中查找，进而实现部分协程间本地变量的共享
+        Coroutine *relate = schedule.coroutines[schedule.batchs[relateBatchId]->relateId];
+        if (relate->localMask & (1u << slot))
+            return relate->local[slot].data;
+        return nullptr;
     }
-
     int CoroutineStackCheck(Schedule &schedule, int id)
     {
         assert(id >= 0 && id < schedule.coroutineCnt);
@@ -283,7 +670,7 @@ namespace MyCoroutine
             {
                 return OverFlow;
             }
-            if (routine->stack[schedule.stackSize - 1 - i] != CANARY_PADDING)
+            if (routine->stack[routine->stackSize - 1 - i] != CANARY_PADDING)
             {
                 return UnderFlow;
             }
@@ -294,18 +681,19 @@ namespace MyCoroutine
     int BatchInit(Schedule &schedule)
     {
         assert(not schedule.isMasterCoroutine); // 从协程中才可以调用
-        for (int i = 0; i < MAX_BATCH_RUN_SIZE; i++)
-        {
-            if (schedule.batchs[i]->state == Idle)
-            {
-                schedule.batchs[i]->state = Ready;
-                schedule.batchs[i]->relateId = schedule.runningCoroutineId;
-                schedule.coroutines[schedule.runningCoroutineId]->relateBatchId = i;
-                schedule.coroutines[schedule.runningCoroutineId]->isInsertBatch = true;
-                return i;
-            }
-        }
-        return INVALID_BATCH_ID;
+        // 直接从空闲链表的头部取出一个空闲的batch，时间复杂度为O(1)
+        int batchId = schedule.batchIdleHead;
+        if (batchId == INVALID_BATCH_ID)
+            return INVALID_BATCH_ID;
+        Batch *batch = schedule.batchs[batchId];
+        assert(batch->state == Idle);
+        schedule.batchIdleHead = batch->nextFree;
+        batch->state = Ready;
+        batch->relateId = schedule.runningCoroutineId;
+        batch->pendingCnt = 0;
+        schedule.coroutines[schedule.runningCoroutineId]->relateBatchId = batchId;
+        schedule.coroutines[schedule.runningCoroutineId]->isInsertBatch = true;
+        return batchId;
     }
 
     void BatchAdd(Schedule &schedule, int batchId, Entry entry, void *arg, uint32_t priority)
@@ -316,7 +704,8 @@ namespace MyCoroutine
         assert(schedule.batchs[batchId]->relateId == schedule.runningCoroutineId); // 关联的协程id必须正确
         int id = CoroutineCreate(schedule, entry, arg, priority, batchId);
         assert(id != INVALID_ROUTINE_ID);
-        schedule.batchs[batchId]->cid2finish[id] = false; // 新增要执行的协程还没执行完
+        schedule.batchs[batchId]->children.push_back(id); // 新增要执行的协程还没执行完
+        schedule.batchs[batchId]->pendingCnt++;
     }
 
     void BatchRun(Schedule &schedule, int batchId)
@@ -324,35 +713,85 @@ namespace MyCoroutine
         assert(not schedule.isMasterCoroutine);                                    // 从协程中才可以调用
         assert(batchId >= 0 && batchId < MAX_BATCH_RUN_SIZE);                      // 校验batchId的合法性
         assert(schedule.batchs[batchId]->relateId == schedule.runningCoroutineId); // 关联的协程id必须正确
-        schedule.batchs[batchId]->state = Run;
-        CoroutineYield(schedule); // 这里的BatchRun只是一个卡点，等batch中所有的协程都执行完了，主协程再恢复从协程的执行
-        schedule.batchs[batchId]->state = Idle;
-        schedule.batchs[batchId]->cid2finish.clear();
+        Batch *batch = schedule.batchs[batchId];
+        batch->state = Run;
+        if (batch->pendingCnt > 0)
+        {
+            CoroutineYield(schedule); // 这里的BatchRun只是一个卡点，等batch中所有的协程都执行完了，主协程再恢复从协程的执行
+        }
+        batch->state = Idle;
+        batch->children.clear();
+        batch->nextFree = schedule.batchIdleHead; // 归还到空闲链表的头部
+        schedule.batchIdleHead = batchId;
         schedule.coroutines[schedule.runningCoroutineId]->relateBatchId = INVALID_BATCH_ID;
         schedule.coroutines[schedule.runningCoroutineId]->isInsertBatch = false; // 重新设置未被插入batch卡点
     }
 
-    int ScheduleInit(Schedule &schedule, int coroutineCnt, int stackSize)
+    int ScheduleInit(Schedule &schedule, int coroutineCnt, int stackSize, SwitchMode switchMode, int sharedStackCnt)
     {
         assert(coroutineCnt > 0 && coroutineCnt <= MAX_COROUTINE_SIZE); // 最多创建MAX_COROUTINE_SIZE个协程
+        assert(sharedStackCnt >= 0 && sharedStackCnt <= MAX_SHARED_STACK_SIZE);
+#ifndef MY_COROUTINE_ASM_SWITCH
+        switchMode = UContext; // 不支持汇编切换的平台，回退到ucontext
+#endif
+        if (UContext == switchMode)
+            sharedStackCnt = 0; // ucontext模式下拿不到协程切出时的栈顶指针，不支持共享栈
+        schedule.switchMode = switchMode;
+        schedule.sharedStackCnt = sharedStackCnt;
         stackSize += (CANARY_SIZE * 2);                                 // 添加canary需要的额外内存
+        stackSize = (stackSize + pageSize() - 1) / pageSize() * pageSize(); // 按页大小对齐，方便mmap和madvise
         schedule.activityCnt = 0;
         schedule.stackCheck = true;
+        schedule.stackProfileMode = StackProfileOff;
+        schedule.autoStackSize = 0;
+        schedule.stackUsage.clear();
         schedule.stackSize = stackSize;
+        // 共享栈模式下只需要为共享栈预留空间
+        stackRegionInit(schedule, sharedStackCnt > 0 ? sharedStackCnt : coroutineCnt);
+        for (int i = 0; i < sharedStackCnt; i++)
+        {
+            schedule.sharedStacks[i].stack = stackAlloc(schedule, i, stackSize);
+            schedule.sharedStacks[i].ownerId = INVALID_ROUTINE_ID;
+        }
         schedule.isMasterCoroutine = true;
+        schedule.batchFinishList.clear(); // 同一个调度器可能被多次初始化，不能残留上一次的待唤醒协程
+        schedule.wakeUpList.clear();
         schedule.coroutineCnt = coroutineCnt;
         schedule.runningCoroutineId = INVALID_ROUTINE_ID;
+        readyQueueInit(schedule.readyQueue);
+        readyQueueInit(schedule.batchReadyQueue);
+        // 初始时所有的协程都是空闲的，按id从小到大串成空闲链表
+        schedule.idleHead = 0;
         for (int i = 0; i < coroutineCnt; i++)
         {
             schedule.coroutines[i] = new Coroutine;
             schedule.coroutines[i]->state = Idle;
             schedule.coroutines[i]->stack = nullptr;
+            schedule.coroutines[i]->isStackCold = false;
+            schedule.coroutines[i]->localMask = 0;
+            schedule.coroutines[i]->isWakeUpPending = false;
+            schedule.coroutines[i]->stackSize = 0;
+            schedule.coroutines[i]->stackUsed = 0;
+            schedule.coroutines[i]->nextIdle = (i + 1 < coroutineCnt) ? i + 1 : INVALID_ROUTINE_ID;
+            schedule.coroutines[i]->prevReady = INVALID_ROUTINE_ID;
+            schedule.coroutines[i]->nextReady = INVALID_ROUTINE_ID;
+            schedule.coroutines[i]->saveBuffer = nullptr;
+            schedule.coroutines[i]->saveSize = 0;
+            schedule.coroutines[i]->saveCap = 0;
+            if (sharedStackCnt > 0)
+            { // 协程按id轮流分配到各个共享栈上
+                schedule.coroutines[i]->sharedStackId = i % sharedStackCnt;
+                schedule.coroutines[i]->stack = schedule.sharedStacks[i % sharedStackCnt].stack;
+                schedule.coroutines[i]->stackSize = stackSize;
+            }
         }
         for (int i = 0; i < MAX_BATCH_RUN_SIZE; i++)
         {
             schedule.batchs[i] = new Batch;
             schedule.batchs[i]->state = Idle;
+            schedule.batchs[i]->nextFree = (i + 1 < MAX_BATCH_RUN_SIZE) ? i + 1 : INVALID_BATCH_ID;
         }
+        schedule.batchIdleHead = 0;
         return 0;
     }
 
@@ -361,12 +800,7 @@ namespace MyCoroutine
         assert(schedule.isMasterCoroutine);
         if (schedule.runningCoroutineId != INVALID_ROUTINE_ID)
             return true;
-        for (int i = 0; i < schedule.coroutineCnt; i++)
-        {
-            if (schedule.coroutines[i]->state != Idle)
-                return true;
-        }
-        return false;
+        return schedule.activityCnt > 0; // activityCnt就是非idle状态的协程数，不需要再遍历协程数组
     }
 
     void ScheduleClean(Schedule &schedule)
@@ -374,10 +808,11 @@ namespace MyCoroutine
         assert(schedule.isMasterCoroutine);
         for (int i = 0; i < schedule.coroutineCnt; i++)
         {
-            delete[] schedule.coroutines[i]->stack;
+            free(schedule.coroutines[i]->saveBuffer);
             for (auto &item : schedule.coroutines[i]->local)
             {
-                item.second.freeEntry(item.second.data); // 释放协程本地变量的内存空间
+                if (item.data)
+                    item.freeEntry(item.data); // 释放协程本地变量的内存空间
             }
             delete schedule.coroutines[i];
         }
@@ -385,11 +820,14 @@ namespace MyCoroutine
         {
             delete schedule.batchs[i];
         }
+        munmap(schedule.stackRegion, schedule.stackRegionSize); // 一次性释放所有的协程栈
+        schedule.stackRegion = nullptr;
+        schedule.sharedStackCnt = 0;
     }
 
     bool ScheduleTryReleaseMemory(Schedule &schedule)
     {
-        static Common::Percentile pct;
+        static thread_local Common::Percentile pct; // 每个线程的调度器独立统计
         pct.Stat("activityCnt", schedule.activityCnt);
         double pctValue;
         // 保持pct99的水位即可
@@ -398,21 +836,35 @@ namespace MyCoroutine
         int32_t releaseCnt = 0;
         // 扣除活动的协程，计算剩余需要保留的栈空间内存的协程数
         int32_t remainStackCnt = (int32_t)pctValue - schedule.activityCnt;
-        for (int i = 0; i < schedule.coroutineCnt; i++)
+        // 只需要遍历空闲链表，链表头部是最近使用过的协程，优先保留它们的栈空间，释放链表尾部冷的协程栈
+        int id = schedule.idleHead;
+        while (id != INVALID_ROUTINE_ID)
         {
-            if (schedule.coroutines[i]->state != Idle)
-                continue;
-            if (nullptr == schedule.coroutines[i]->stack)
+            Coroutine *routine = schedule.coroutines[id];
+            id = routine->nextIdle;
+            if (nullptr == routine->stack || routine->isStackCold ||
+                (schedule.sharedStackCnt > 0 && nullptr == routine->saveBuffer))
                 continue;
             if (remainStackCnt <= 0)
-            {                                           // 没有保留名额了
-                delete[] schedule.coroutines[i]->stack; // 释放状态为idle的协程的栈内存
-                schedule.coroutines[i]->stack = nullptr;
-                for (auto &item : schedule.coroutines[i]->local)
+            { // 没有保留名额了
+                if (schedule.sharedStackCnt > 0)
+                { // 共享栈模式下，释放私有缓冲区
+                    free(routine->saveBuffer);
+                    routine->saveBuffer = nullptr;
+                    routine->saveCap = 0;
+                    routine->saveSize = 0;
+                }
+                else
+                { // 归还状态为idle的协程栈的物理内存，保留映射，下次使用时不需要重新mmap
+                    madvise(routine->stack, routine->stackSize, MADV_DONTNEED);
+                    routine->isStackCold = true;
+                }
+                for (auto &item : routine->local)
                 {
-                    item.second.freeEntry(item.second.data); // 释放协程本地变量的内存空间
+                    if (item.data)
+                        item.freeEntry(item.data); // 释放协程本地变量的内存空间
+                    item = LocalData();
                 }
-                schedule.coroutines[i]->local.clear();
                 releaseCnt++;
                 if (releaseCnt >= 25)
                     break; // 每次最多释放25个协程栈的空间，避免释放内存占用过多时间
@@ -427,5 +879,88 @@ namespace MyCoroutine
 
     int ScheduleGetRunCid(Schedule &schedule) { return schedule.runningCoroutineId; }
     void ScheduleDisableStackCheck(Schedule &schedule) { schedule.stackCheck = false; }
+    bool ScheduleIsSharedStack(Schedule &schedule) { return schedule.sharedStackCnt > 0; }
+
+    // 统计一段按页对齐的协程栈中已经分配了物理页的字节数，mincore失败时按全部驻留计算
+    static int64_t stackResidentBytes(uint8_t *stack, int32_t stackSize)
+    {
+        size_t pages = ((size_t)stackSize + pageSize() - 1) / pageSize();
+        std::vector<unsigned char> residency(pages);
+        if (mincore(stack, pages * pageSize(), residency.data()) != 0)
+            return stackSize;
+        int64_t resident = 0;
+        for (unsigned char page : residency)
+            resident += (page & 1) ? pageSize() : 0;
+        return resident;
+    }
+
+    int64_t ScheduleStackMemory(Schedule &schedule)
+    {
+        int64_t memory = 0;
+        if (schedule.sharedStackCnt > 0)
+        {
+            for (int i = 0; i < schedule.sharedStackCnt; i++)
+                memory += stackResidentBytes(schedule.sharedStacks[i].stack, schedule.stackSize);
+            for (int i = 0; i < schedule.coroutineCnt; i++)
+                memory += schedule.coroutines[i]->saveCap;
+            return memory;
+        }
+        for (int i = 0; i < schedule.coroutineCnt; i++)
+        {
+            Coroutine *routine = schedule.coroutines[i];
+            if (routine->stack && not routine->isStackCold) // 冷的协程栈已经通过madvise归还了物理内存
+                memory += stackResidentBytes(routine->stack, routine->stackSize);
+        }
+        return memory;
+    }
+
+    int64_t ScheduleStackNominalMemory(Schedule &schedule)
+    {
+        int64_t memory = 0;
+        if (schedule.sharedStackCnt > 0)
+        {
+            memory = (int64_t)schedule.sharedStackCnt * schedule.stackSize;
+            for (int i = 0; i < schedule.coroutineCnt; i++)
+                memory += schedule.coroutines[i]->saveCap;
+            return memory;
+        }
+        for (int i = 0; i < schedule.coroutineCnt; i++)
+        {
+            if (schedule.coroutines[i]->stack && not schedule.coroutines[i]->isStackCold)
+                memory += schedule.coroutines[i]->stackSize;
+        }
+        return memory;
+    }
+
+    void ScheduleSetStackProfile(Schedule &schedule, StackProfileMode mode)
+    {
+        if (schedule.sharedStackCnt > 0)
+            return; // 共享栈上保存着其他协程的栈内容，不支持统计
+        schedule.stackProfileMode = mode;
+        if (mode != StackProfileAutoSize)
+            schedule.autoStackSize = 0;
+    }
+
+    const std::map<std::string, StackUsage> &ScheduleStackProfile(Schedule &schedule) { return schedule.stackUsage; }
+
+    void CoroutineSetStackTag(Schedule &schedule, const std::string &tag)
+    {
+        if (StackProfileOff == schedule.stackProfileMode || schedule.isMasterCoroutine)
+            return;
+        schedule.coroutines[schedule.runningCoroutineId]->stackTag = tag;
+    }
+
+    int32_t StackUsagePercentile(const StackUsage &usage, double pct)
+    {
+        int64_t target = (int64_t)(usage.count * pct);
+        int64_t count = 0;
+        for (auto &item : usage.histogram)
+        {
+            count += item.second;
+            if (count > target)
+                return item.first;
+        }
+        return usage.max;
+    }
 
 } // namespace MyCoroutine
\ No newline at end of file
@@ -4,10 +4,17 @@
 #include <ucontext.h>
 #include <cstdint>
 #include <list>
+#include <map>
+#include <string>
 #include <unordered_map>
+#include <vector>
 #include "../common/singleton.hpp"
 
-#define SCHEDULE Common::Singleton<MyCoroutine::Schedule>::Instance()
+#define SCHEDULE Common::ThreadLocalSingleton<MyCoroutine::Schedule>::Instance()
+// x86-64和aarch64下支持只保存寄存器的汇编上下文切换，其他平台只能使用ucontext
+#if defined(__x86_64__) || defined(__aarch64__)
+#define MY_COROUTINE_ASM_SWITCH 1
+#endif
 namespace MyCoroutine
 {
 
@@ -17,6 +24,12 @@ constexpr int MAX_COROUTINE_SIZE = 102400; // 最多创建102400个协程
 constexpr int MAX_BATCH_RUN_SIZE = 51200;  // 最多创建51200个批量执行
 constexpr int CANARY_SIZE = 512;           // canary内存的大小，单位字节
 constexpr uint8_t CANARY_PADDING = 0x88;   // canary填充的内容
+constexpr int MAX_SHARED_STACK_SIZE = 256;  // 最多创建256个共享栈
+constexpr int MAX_LOCAL_SLOT_SIZE = 16;    // 最多创建16个协程本地变量
+constexpr int PRIORITY_BUCKET_SIZE = 32;   // 就绪队列优先级桶的个数，priority大于等于31的协程都放在最后一个桶中
+constexpr int STACK_USAGE_BUCKET_SIZE = 1024;      // 栈使用量直方图每个桶的宽度，单位字节
+constexpr int STACK_AUTO_SIZE_HEADROOM = 16 * 1024; // 自动调整栈大小时，在p99.9使用量之上预留的余量，单位字节
+constexpr int STACK_AUTO_SIZE_SAMPLE = 1024;       // 自动调整栈大小时，每统计这么多个样本重新计算一次栈大小
 
 /* 1.协程的状态，协程的状态转移如下：
     *  idle->ready
@@ -41,6 +54,22 @@ enum ResumeResult {
     Success = 2,     // 成功唤醒一个挂起状态的协程
 };
 
+enum SwitchMode {
+    UContext = 1, // 使用glibc的swapcontext切换，每次切换都会有一次rt_sigprocmask系统调用
+    Assembly = 2, // 使用汇编实现的上下文切换，只保存和恢复callee-saved寄存器，不涉及系统调用
+};
+#ifdef MY_COROUTINE_ASM_SWITCH
+constexpr SwitchMode DEFAULT_SWITCH_MODE = Assembly;
+#else
+constexpr SwitchMode DEFAULT_SWITCH_MODE = UContext;
+#endif
+
+enum StackProfileMode {
+    StackProfileOff = 0,      // 不统计栈使用量
+    StackProfileOn = 1,       // 统计栈使用量
+    StackProfileAutoSize = 2, // 统计栈使用量，并按统计结果自动调整新协程的栈大小
+};
+
 enum StackCheckResult {
     Normal = 0,    // 正常
     OverFlow = 1,  // 栈顶溢出
@@ -49,8 +78,8 @@ enum StackCheckResult {
 
 typedef void (*Entry)(void *arg); // 入口函数
 typedef struct LocalData { // 协程本地变量数据
-    void *data;
-    Entry freeEntry; // 用于释放本地协程变量的内存
+    void *data{nullptr};       // 第一次设置时分配，协程复用时继续原地使用
+    Entry freeEntry{nullptr};  // 用于释放本地协程变量的内存
 } LocalData;
 
 // 协程结构体
@@ -59,34 +88,85 @@ typedef struct Coroutine {
     uint32_t priority;                           // 协程优先级，值越小，优先级越高
     void *arg;                                   // 协程入口函数的参数
     Entry entry;                                 // 协程入口函数
-    ucontext_t ctx;                              // 协程执行上下文
-    uint8_t *stack;                              // 每个协程独占的协程栈，动态分配
-    std::unordered_map<void *, LocalData> local; // 协程本地变量，key是协程变量的内存地址
+    ucontext_t ctx;                              // 协程执行上下文，UContext模式下使用
+    void *sp;                                    // 协程切出时的栈顶指针，寄存器保存在栈上，Assembly模式下使用
+    uint8_t *stack;                              // 每个协程独占的协程栈，第一次使用时从stackRegion中分配；共享栈模式下指向使用的共享栈
+    bool isStackCold;                            // 协程栈的物理内存是否已经通过madvise归还给内核，映射仍然保留
+    int32_t stackSize;                           // 协程栈的实际大小，自动调整栈大小时可能小于schedule.stackSize
+    int32_t stackUsed;                           // 上一次执行结束时栈的最大使用量，统计栈使用量时使用
+    std::string stackTag;                        // 栈使用量统计的标签，比如rpc名
+    LocalData local[MAX_LOCAL_SLOT_SIZE];        // 协程本地变量，下标是协程本地变量分配到的槽位
+    uint32_t localMask;                          // 第i位为1表示第i个槽位在协程本次运行中被设置过
     int relateBatchId;                           // 关联的batchId，INVALID_BATCH_ID表示无关联的batch
     bool isInsertBatch;                          // 当前在协程中是否被插入了batchRun的卡点
+    bool isWakeUpPending;                        // 是否已经放入了wakeUpList，协程被唤醒运行之后清除
+    int32_t nextIdle;                            // 空闲链表中下一个空闲协程的id，只在idle状态时有效
+    int32_t prevReady;                           // 就绪队列中前一个协程的id，只在ready和suspend状态时有效
+    int32_t nextReady;                           // 就绪队列中后一个协程的id，只在ready和suspend状态时有效
+    int32_t sharedStackId;                       // 共享栈模式下，使用的共享栈的id
+    bool isStackInit;                            // 共享栈模式下，是否已经在共享栈上构造了初始的栈帧
+    uint8_t *saveBuffer;                         // 共享栈模式下，协程被换出时用于保存栈内容的私有缓冲区
+    int32_t saveSize;                            // 私有缓冲区中保存的栈内容的大小，单位字节
+    int32_t saveCap;                             // 私有缓冲区的容量，单位字节
 } Coroutine;
 
+// 共享栈结构体，多个协程轮流在同一个共享栈上运行，切换时只把被换出协程实际使用的栈内容保存到它的私有缓冲区中
+typedef struct SharedStack {
+    uint8_t *stack;  // 共享栈的内存
+    int32_t ownerId; // 当前栈上保存着哪个协程的栈内容，INVALID_ROUTINE_ID表示没有
+} SharedStack;
+
+// 就绪队列，按priority分桶，每个桶内是先进先出的双向链表
+// 协程栈使用量的统计
+typedef struct StackUsage {
+    int64_t count{0};                     // 样本数
+    int32_t max{0};                       // 最大使用量，单位字节
+    std::map<int32_t, int64_t> histogram; // 直方图，key是向上取整到STACK_USAGE_BUCKET_SIZE的使用量，value是样本数
+} StackUsage;
+
+typedef struct ReadyQueue {
+    uint32_t bitmap;                      // 非空桶的位图，第i位为1表示第i个桶中有协程
+    int32_t heads[PRIORITY_BUCKET_SIZE];  // 每个桶的头结点，INVALID_ROUTINE_ID表示桶为空
+    int32_t tails[PRIORITY_BUCKET_SIZE];  // 每个桶的尾结点
+} ReadyQueue;
+
 // 批量执行结构体
 typedef struct Batch
 {
-    State state;                              // 批量执行的状态
-    int relateId;                             // 关联的协程id
-    std::unordered_map<int, bool> cid2finish; // 每个关联协程的运行状态（是否执行完）
+    State state;               // 批量执行的状态
+    int relateId;              // 关联的协程id
+    int32_t pendingCnt;        // 还没执行完的关联协程的个数
+    int32_t nextFree;          // 空闲链表中下一个空闲batch的id，只在idle状态时有效
+    std::vector<int> children; // 所有关联的协程id，batch复用时保留容量
 } Batch;
 
 // 协程调度器
 typedef struct Schedule
 {
-    ucontext_t main;                           // 用于保存主协程的上下文
+    ucontext_t main;                           // 用于保存主协程的上下文，UContext模式下使用
+    void *mainSp;                              // 主协程切出时的栈顶指针，Assembly模式下使用
+    SwitchMode switchMode;                     // 上下文切换的方式
     int32_t runningCoroutineId;                // 运行中（Run + Suspend）的从协程的id
     int32_t coroutineCnt;                      // 协程个数
     int32_t activityCnt;                       // 非idle状态的协程数
+    int32_t idleHead;                          // 空闲协程链表（栈）的头结点，INVALID_ROUTINE_ID表示没有空闲协程
+    ReadyQueue readyQueue;                     // ready和suspend状态且没有插入batch卡点的协程
+    ReadyQueue batchReadyQueue;                // ready和suspend状态且插入了batch卡点的协程，优先级比readyQueue低
     bool isMasterCoroutine;                    // 当前协程是否为主协程
     Coroutine *coroutines[MAX_COROUTINE_SIZE]; // 从协程数组池
     Batch *batchs[MAX_BATCH_RUN_SIZE];         // 批量执行数组池
-    int stackSize;                             // 协程栈的大小，单位字节
+    int32_t batchIdleHead;                     // 空闲batch链表（栈）的头结点，INVALID_BATCH_ID表示没有空闲batch
+    int stackSize;                             // 协程栈的大小，单位字节，按页大小对齐
     std::list<int> batchFinishList;            // 完成了批量执行的关联的协程的id
+    std::vector<int> wakeUpList;               // 被其他协程或者定时器标记为需要唤醒的协程的id
     bool stackCheck;                           // 是否检测协程栈空间是否溢出
+    int sharedStackCnt;                        // 共享栈的个数，0表示每个协程独占协程栈
+    SharedStack sharedStacks[MAX_SHARED_STACK_SIZE]; // 共享栈数组
+    uint8_t *stackRegion;                      // 所有协程栈一次性mmap出来的虚拟地址空间，每个栈独占一个槽位
+    size_t stackRegionSize;                    // stackRegion的大小，单位字节
+    StackProfileMode stackProfileMode;         // 栈使用量统计的模式
+    int32_t autoStackSize;                     // 自动调整后的协程栈大小，0表示还没有调整
+    std::map<std::string, StackUsage> stackUsage; // 按标签统计的栈使用量
 } Schedule;
 
 // 创建协程
@@ -104,12 +184,20 @@ int CoroutineResumeById(Schedule &schedule, int id);
 int CoroutineResumeInBatch(Schedule &schedule, int id);
 // 恢复被插入batch卡点的从协程的调用，只能在主协程中调用
 int CoroutineResumeBatchFinish(Schedule &schedule);
+// 标记协程需要被唤醒，从协程和主协程中都可以调用，实际的唤醒由主协程调用CoroutineResumeWakeUp完成
+void CoroutineWakeUp(Schedule &schedule, int id);
+// 唤醒所有被标记的协程，被唤醒的协程又标记的协程也会在本次调用中唤醒，唤醒之后完成了批量执行的协程也一并恢复，只能在主协程中调用
+int CoroutineResumeWakeUp(Schedule &schedule);
 // 判断当前从协程是否在batch中
 bool CoroutineIsInBatch(Schedule &schedule);
-// 设置协程本地变量
-void CoroutineLocalSet(Schedule &schedule, void *key, LocalData localData);
-// 获取协程本地变量
-bool CoroutineLocalGet(Schedule &schedule, void *key, LocalData &localData);
+// 分配协程本地变量的槽位，所有调度器共用槽位编号
+int CoroutineLocalSlotAlloc();
+// 获取当前从协程第slot个槽位的本地变量数据，并标记为已设置，只能在从协程中调用
+LocalData &CoroutineLocalSet(Schedule &schedule, int slot);
+// 当前从协程没有设置第slot个槽位时，查找插入batch卡点的协程，找不到返回nullptr
+void *CoroutineLocalGetFromBatch(Schedule &schedule, int slot);
+// 获取协程本地变量，只能在从协程中调用
+inline void *CoroutineLocalGet(Schedule &schedule, int slot);
 // 协程栈使用检测
 int CoroutineStackCheck(Schedule &schedule, int id);
 
@@ -120,17 +208,45 @@ void BatchAdd(Schedule &schedule, int batchId, Entry entry, void *arg, uint32_t
 // 执行批量操作
 void BatchRun(Schedule &schedule, int batchId);
 
-// 协程调度结构体初始化
-int ScheduleInit(Schedule &schedule, int coroutineCnt, int stackSize = 8 * 1024);
+// 协程调度结构体初始化，sharedStackCnt大于0时开启共享栈模式（只支持Assembly模式）。
+// 共享栈模式下，从协程切出之后它的栈内容可能被换出，所以协程栈上变量的地址不能交给其他协程或者主协程访问，
+// 比如WaitGroup的参数需要分配在堆上。
+int ScheduleInit(Schedule &schedule, int coroutineCnt, int stackSize = 8 * 1024,
+                 SwitchMode switchMode = DEFAULT_SWITCH_MODE, int sharedStackCnt = 0);
 // 判断是否还有协程在运行
 bool ScheduleRunning(Schedule &schedule);
 // 释放调度器
 void ScheduleClean(Schedule &schedule);
-// 调度器尝试释放内存
+// 调度器尝试释放内存，冷的空闲协程栈通过madvise(MADV_DONTNEED)归还物理内存，保留虚拟地址映射
 bool ScheduleTryReleaseMemory(Schedule &schedule);
 // 获取当前运行中的从协程id
 int ScheduleGetRunCid(Schedule &schedule);
 // 关闭协程栈检查
 void ScheduleDisableStackCheck(Schedule &schedule);
+// 判断是否开启了共享栈模式
+bool ScheduleIsSharedStack(Schedule &schedule);
+// 获取协程栈当前实际占用的物理内存大小，单位字节。私有栈和共享栈都是按需提交的mmap区域，按mincore统计驻留的页，
+// 共享栈模式下再加上所有协程保存栈内容的缓冲区
+int64_t ScheduleStackMemory(Schedule &schedule);
+// 获取协程栈名义上的内存大小，单位字节，私有栈模式下是所有没有归还物理内存的协程栈的栈大小之和，
+// 共享栈模式下是共享栈的栈大小之和加上所有保存栈内容的缓冲区
+int64_t ScheduleStackNominalMemory(Schedule &schedule);
+// 设置栈使用量统计的模式，只支持私有栈。开启之后协程每次创建都要把栈填充为CANARY_PADDING，
+// 协程执行结束时从栈顶开始找到第一个被改写的字节，得到栈的最大使用量，开销较大，适合压测或者灰度时开启。
+void ScheduleSetStackProfile(Schedule &schedule, StackProfileMode mode);
+// 获取按标签统计的栈使用量，"all"是所有协程的汇总，没有设置标签的协程统计在"default"中
+const std::map<std::string, StackUsage> &ScheduleStackProfile(Schedule &schedule);
+// 设置当前从协程的栈使用量统计标签，比如处理的rpc名，没有开启统计时什么也不做
+void CoroutineSetStackTag(Schedule &schedule, const std::string &tag);
+// 计算栈使用量的分位值，单位字节，精度为STACK_USAGE_BUCKET_SIZE
+int32_t StackUsagePercentile(const StackUsage &usage, double pct);
+
+inline void *CoroutineLocalGet(Schedule &schedule, int slot)
+{
+    Coroutine *routine = schedule.coroutines[schedule.runningCoroutineId];
+    if (routine->localMask & (1u << slot))
+        return routine->local[slot].data;
+    return CoroutineLocalGetFromBatch(schedule, slot);
+}
 
-} // namespace MyCoroutine
+} // namespace MyCoroutine
\ No newline at end of file
@@ -1,7 +1,10 @@
 #pragma once
 
 #include <errno.h>
+#include <sys/uio.h>
 #include <unistd.h>
+#include <string>
+#include <vector>
 
 #include "../common/defer.hpp"
 #include "../common/log.hpp"
@@ -13,6 +16,7 @@
 #include "epollctl.hpp"
 #include "routeinfo.hpp"
 #include "timer.hpp"
+#include "uring.hpp"
 
 #define SYSTEM Common::Singleton<Core::System>::Instance()
 extern Core::CoroutineLocal<int> EpollFd;
@@ -32,20 +36,41 @@ class System {
 public:
     void SetIoMock(SocketIoMock *socketIoMock) { socket_io_mock_ = socketIoMock; }
     ssize_t read(int fd, void *buf, size_t count) {
+        ReadCount()++;
         if (not socket_io_mock_)
             return ::read(fd, buf, count);
         return socket_io_mock_->read(fd, buf, count);
     }
     ssize_t write(int fd, const void *buf, size_t count) {
+        WriteCount()++;
         if (not socket_io_mock_)
             return ::write(fd, buf, count);
         return socket_io_mock_->write(fd, buf, count);
     }
+    ssize_t writev(int fd, const struct iovec *iov, int iovcnt) {
+        WriteCount()++;
+        if (not socket_io_mock_)
+            return ::writev(fd, iov, iovcnt);
+        std::string data; // mock只模拟了write，拼接之后一次写入
+        for (int i = 0; i < iovcnt; i++)
+            data.append((const char *)iov[i].iov_base, iov[i].iov_len);
+        return socket_io_mock_->write(fd, data.data(), data.size());
+    }
     int connect(int sockfd, const struct sockaddr *addr, socklen_t addrlen) {
         if (not socket_io_mock_)
             return ::connect(sockfd, addr, addrlen);
         return socket_io_mock_->connect(sockfd, addr, addrlen);
     }
+    // 当前线程调用read的次数，用于评估每个请求的读系统调用开销
+    static int64_t &ReadCount() {
+        static thread_local int64_t count = 0;
+        return count;
+    }
+    // 当前线程调用write和writev的次数
+    static int64_t &WriteCount() {
+        static thread_local int64_t count = 0;
+        return count;
+    }
 private:
     SocketIoMock *socket_io_mock_{nullptr};
 };
@@ -55,24 +80,143 @@ typedef struct TimeOutData {
     bool time_out_{false};
 } TimeOutData;
 
+// 协程等待IO就绪时，需要被主协程访问的数据（epoll事件的关联数据和超时定时器的数据）
+typedef struct IoWaitData {
+    IoWaitData(int fd, int epollFd, int cid) : event_data_(fd, epollFd, RPC_CLIENT) {
+        event_data_.cid_ = cid;
+        time_out_data_.cid_ = cid;
+    }
+    EventData event_data_;
+    TimeOutData time_out_data_;
+} IoWaitData;
+
+// 共享栈模式下，从协程切出之后栈内容可能被换出，主协程（epoll事件处理和定时器回调都在主协程中执行）不能再访问
+// 从协程栈上的变量，所以这时IoWaitData需要分配在堆上。其他挂起期间需要被主协程访问的数据也是同样的原因分配在堆上
+class IoWait {
+public:
+    IoWait(int fd) : stack_data_(fd, EpollFd.Get(), MyCoroutine::ScheduleGetRunCid(SCHEDULE)) {
+        data_ = &stack_data_;
+        if (MyCoroutine::ScheduleIsSharedStack(SCHEDULE))
+            data_ = new IoWaitData(stack_data_);
+    }
+    ~IoWait() {
+        if (data_ != &stack_data_)
+            delete data_;
+    }
+    EventData &Event() { return data_->event_data_; }
+    TimeOutData &TimeOut() { return data_->time_out_data_; }
+
+private:
+    IoWaitData stack_data_;
+    IoWaitData *data_{nullptr};
+};
+
 inline void TimeOutCallBack(void *data) {
     TimeOutData *timeOutData = (TimeOutData *)data;
     timeOutData->time_out_ = true;
     MyCoroutine::CoroutineResumeById(SCHEDULE, timeOutData->cid_); // 超时之后，直接唤醒协程
 }
 
-inline ssize_t CoRead(int fd, void *buf, size_t size, bool useInnerEventData = true)
+#define PERSISTENT_EVENT Common::ThreadLocalSingleton<Core::PersistentEvent>::Instance()
+
+// 连接池中的长连接在整个生命周期内以边缘触发的方式注册在epoll实例中，协程等待IO就绪时只需要更新关联的协程id，
+// 不需要每次读写都ADD/DEL。EventData分配在堆上，共享栈模式下主协程也可以访问，只在所属的subReactor线程中使用。
+class PersistentEvent {
+public:
+    ~PersistentEvent() {
+        for (EventData *eventData : events_)
+            delete eventData;
+    }
+    void Add(int fd, int epollFd) {
+        if (fd >= (int)events_.size())
+            events_.resize(fd + 1, nullptr);
+        assert(nullptr == events_[fd]);
+        EventData *eventData = new EventData(fd, epollFd, RPC_CLIENT);
+        EpollCtl::SetEvent(eventData, EPOLLIN | EPOLLOUT | EPOLLET);
+        events_[fd] = eventData;
+    }
+    EventData *Get(int fd) {
+        if (fd < 0 || fd >= (int)events_.size())
+            return nullptr;
+        return events_[fd];
+    }
+    // 调用方接着会关闭fd，内核会自动把fd从epoll实例中移除，这里不需要EPOLL_CTL_DEL
+    void Remove(int fd) {
+        EventData *eventData = Get(fd);
+        if (nullptr == eventData)
+            return;
+        delete eventData;
+        events_[fd] = nullptr;
+    }
+
+private:
+    std::vector<EventData *> events_; // 按fd索引
+};
+
+// 等待fd上的IO就绪，只在IO操作返回EAGAIN之后才调用，所以边缘触发和ONESHOT的事件都不会丢失。
+// connEventData非空时是服务端的客户端连接，重新激活连接上的ONESHOT事件；连接池中的长连接使用长期注册的事件；
+// 其他临时的fd才在这里注册IoWait中的事件，并且在IO操作结束时移除。
+inline void waitIoReady(EventData &eventData, EventData *connEventData, uint32_t events) {
+    if (connEventData) {
+        EpollCtl::SetEvent(connEventData, events | EPOLLONESHOT);
+        MyCoroutine::CoroutineYield(SCHEDULE);
+        return;
+    }
+    EventData *persistent = PERSISTENT_EVENT.Get(eventData.fd_);
+    if (nullptr == persistent) {
+        EpollCtl::SetEvent(&eventData, events);
+        MyCoroutine::CoroutineYield(SCHEDULE);
+        return;
+    }
+    persistent->epoll_fd_ = eventData.epoll_fd_;
+    EpollCtl::SetEvent(persistent, EPOLLIN | EPOLLOUT | EPOLLET); // 只有epoll实例变化时才需要重新注册
+    persistent->cid_ = eventData.cid_;
+    MyCoroutine::CoroutineYield(SCHEDULE);
+    persistent->cid_ = MyCoroutine::INVALID_ROUTINE_ID; // 空闲时触发的事件没有关联的协程，会被忽略
+}
+
+// io_uring后端：把IO请求和链接的超时一起放入提交队列，由subReactor在下一次epoll_wait之前批量提交，完成事件到来时再唤醒协程。
+// 超时的请求会被内核取消，和epoll后端一样返回-1并把errno设置为EAGAIN。只在非共享栈模式下开启，IO的缓冲区可以在协程栈上。
+inline ssize_t uringIo(uint8_t opcode, int fd, const void *buf, size_t len, uint64_t off, int64_t timeOutMs) {
+    UringRequest request;
+    request.cid_ = MyCoroutine::ScheduleGetRunCid(SCHEDULE);
+    request.timeout_.tv_sec = timeOutMs / 1000;
+    request.timeout_.tv_nsec = (timeOutMs % 1000) * 1000000;
+    io_uring_sqe *sqe = URING.GetSqe(2);
+    if (nullptr == sqe) { // 提交队列中的请求内核暂时取不走，按超时处理
+        errno = EAGAIN;
+        return -1;
+    }
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)buf;
+    sqe->len = (uint32_t)len;
+    sqe->off = off;
+    sqe->flags = IOSQE_IO_LINK;
+    sqe->user_data = (uint64_t)&request;
+    io_uring_sqe *timeOutSqe = URING.GetSqe();
+    timeOutSqe->opcode = IORING_OP_LINK_TIMEOUT;
+    timeOutSqe->fd = -1;
+    timeOutSqe->addr = (uint64_t)&request.timeout_;
+    timeOutSqe->len = 1;
+    while (not request.done_)
+        MyCoroutine::CoroutineYield(SCHEDULE); // 请求被内核持有期间不能返回，被其他方式唤醒时继续等待
+    if (request.res_ >= 0)
+        return request.res_;
+    errno = (-ECANCELED == request.res_) ? EAGAIN : -request.res_; // 被链接的超时取消
+    return -1;
+}
+
+inline ssize_t CoRead(int fd, void *buf, size_t size, EventData *connEventData = nullptr)
 {
-    EventData eventData(fd, EpollFd.Get(), RPC_CLIENT);
-    eventData.cid_ = MyCoroutine::ScheduleGetRunCid(SCHEDULE);
-    if (useInnerEventData)
-        EpollCtl::AddReadEvent(eventData.epoll_fd_, eventData.fd_, &eventData);
-    TimeOutData timeOutData;
-    timeOutData.cid_ = MyCoroutine::ScheduleGetRunCid(SCHEDULE);
+    if (URING.Enabled())
+        return uringIo(IORING_OP_RECV, fd, buf, size, 0, RpcTimeOut.Get().read_time_out_ms_);
+    IoWait ioWait(fd);
+    EventData &eventData = ioWait.Event();
+    TimeOutData &timeOutData = ioWait.TimeOut();
     int64_t timerId = TIMER.Register(TimeOutCallBack, &timeOutData, RpcTimeOut.Get().read_time_out_ms_);
-    Common::Defer defer([&timeOutData, &eventData, useInnerEventData, timerId]() {
-        if (useInnerEventData) 
-            EpollCtl::ClearEvent(eventData.epoll_fd_, eventData.fd_, false);
+    Common::Defer defer([&timeOutData, &eventData, timerId]() {
+        EpollCtl::RemoveEvent(&eventData, false); // 只有临时注册过才需要EPOLL_CTL_DEL
         if (not timeOutData.time_out_) {
             TIMER.Cancel(timerId);  // 定时器不超时，则取消定时器
         }
@@ -85,7 +229,7 @@ inline ssize_t CoRead(int fd, void *buf, size_t size, bool useInnerEventData = t
         if (EINTR == errno)
             continue; // 调用被中断，则直接重启read调用
         if (EAGAIN == errno or EWOULDBLOCK == errno) { // 暂时不可读
-            MyCoroutine::CoroutineYield(SCHEDULE);     // 让出cpu，切换到主协程，等待下一次数据可读
+            waitIoReady(eventData, connEventData, EPOLLIN); // 让出cpu，切换到主协程，等待下一次数据可读
             if (timeOutData.time_out_) { // 读超时了
                 errno = EAGAIN;
                 return -1; // 读超时，返回-1，并把errno设置为EAGAIN
@@ -98,34 +242,30 @@ inline ssize_t CoRead(int fd, void *buf, size_t size, bool useInnerEventData = t
 
 /*
 CoWrite 协程写操作的流程说明：
-1. 创建 epoll 事件对象（EventData），记录当前协程 ID。
-2. 如果启用了内部事件监听（useInnerEventData，则将写事件加入到 epoll，等待 fd 可写。
-3. 注册一个写操作的超时定时器（写超时配置来自 RpcTimeOut）。
-4. 使用 Defer 机制确保协程结束时做清理操作： - 清除 epoll 写事件（如果启用）- 如果没有超时，则取消定时器
-5. 进入写循环：
-   a. 尝试直接 write，如果成功，直接返回写入字节数。
+1. 准备等待IO时使用的事件对象（EventData），记录当前协程 ID。
+2. 注册一个写操作的超时定时器（写超时配置来自 RpcTimeOut）。
+3. 使用 Defer 机制确保协程结束时做清理操作： - 清除临时注册的 epoll 写事件（如果有）- 如果没有超时，则取消定时器
+4. 进入写循环：
+   a. 尝试直接 write，如果成功，直接返回写入字节数，这时不需要任何 epoll_ctl 调用。
    b. 如果被中断（EINTR），重试。
    c. 如果暂时不可写（EAGAIN/EWOULDBLOCK）：
-      - 调用 CoroutineYield 让出 CPU，挂起当前协程
+      - 调用 waitIoReady 注册（或者重新激活）可写事件，并让出 CPU，挂起当前协程
       - 等待 epoll 通知或者定时器触发
       - 如果是超时唤醒，则设置 errno 为 EAGAIN 并返回 -1。
    d. 其他错误，直接返回 write 的错误码。
 */
-inline ssize_t CoWrite(int fd, const void *buf, size_t size, bool useInnerEventData = true) {
+inline ssize_t CoWrite(int fd, const void *buf, size_t size, EventData *connEventData = nullptr) {
+    if (URING.Enabled())
+        return uringIo(IORING_OP_SEND, fd, buf, size, 0, RpcTimeOut.Get().write_time_out_ms_);
     // 准备事件监听数据
-    EventData eventData(fd, EpollFd.Get(), RPC_CLIENT);
-    eventData.cid_ = MyCoroutine::ScheduleGetRunCid(SCHEDULE);
-    if (useInnerEventData)
-        EpollCtl::AddWriteEvent(eventData.epoll_fd_, eventData.fd_, &eventData);
-        
-    TimeOutData timeOutData;
-    timeOutData.cid_ = MyCoroutine::ScheduleGetRunCid(SCHEDULE);
+    IoWait ioWait(fd);
+    EventData &eventData = ioWait.Event();
+    TimeOutData &timeOutData = ioWait.TimeOut();
     int64_t timerId = TIMER.Register(
         TimeOutCallBack, &timeOutData, RpcTimeOut.Get().write_time_out_ms_);
     
-    Common::Defer defer([&timeOutData, &eventData, useInnerEventData, timerId]() {
-        if (useInnerEventData) 
-            EpollCtl::ClearEvent(eventData.epoll_fd_, eventData.fd_, false);
+    Common::Defer defer([&timeOutData, &eventData, timerId]() {
+        EpollCtl::RemoveEvent(&eventData, false); // 只有临时注册过才需要EPOLL_CTL_DEL
         if (not timeOutData.time_out_) 
             TIMER.Cancel(timerId);  // 定时器不超时，则取消定时器 
     });
@@ -136,7 +276,7 @@ inline ssize_t CoWrite(int fd, const void *buf, size_t size, bool useInnerEventD
         if (EINTR == errno)
             continue; // 调用被中断，则直接重启write调用
         if (EAGAIN == errno or EWOULDBLOCK == errno) { // 暂时不可写
-            MyCoroutine::CoroutineYield(SCHEDULE);     // 让出cpu，切换到主协程，等待下一次数据可写
+            waitIoReady(eventData, connEventData, EPOLLOUT); // 让出cpu，切换到主协程，等待下一次数据可写
             if (timeOutData.time_out_) { // 写超时了
                 errno = EAGAIN;
                 return -1; // 写超时，返回-1，并把errno设置为EAGAIN
@@ -147,17 +287,48 @@ inline ssize_t CoWrite(int fd, const void *buf, size_t size, bool useInnerEventD
     }
 }
 
+// 协程写操作的聚集写版本，多个不连续的缓冲区一次系统调用写入，流程和CoWrite一样
+inline ssize_t CoWritev(int fd, const struct iovec *iov, int iovcnt, EventData *connEventData = nullptr) {
+    if (URING.Enabled())
+        return uringIo(IORING_OP_WRITEV, fd, iov, iovcnt, 0, RpcTimeOut.Get().write_time_out_ms_);
+    IoWait ioWait(fd);
+    EventData &eventData = ioWait.Event();
+    TimeOutData &timeOutData = ioWait.TimeOut();
+    int64_t timerId = TIMER.Register(TimeOutCallBack, &timeOutData, RpcTimeOut.Get().write_time_out_ms_);
+    Common::Defer defer([&timeOutData, &eventData, timerId]() {
+        EpollCtl::RemoveEvent(&eventData, false); // 只有临时注册过才需要EPOLL_CTL_DEL
+        if (not timeOutData.time_out_)
+            TIMER.Cancel(timerId); // 定时器不超时，则取消定时器
+    });
+    while (true) {
+        ssize_t ret = SYSTEM.writev(fd, iov, iovcnt);
+        if (ret >= 0)
+            return ret; // 写成功，可能只写入了一部分
+        if (EINTR == errno)
+            continue; // 调用被中断，则直接重启writev调用
+        if (EAGAIN == errno or EWOULDBLOCK == errno) { // 暂时不可写
+            waitIoReady(eventData, connEventData, EPOLLOUT); // 让出cpu，切换到主协程，等待下一次数据可写
+            if (timeOutData.time_out_) { // 写超时了
+                errno = EAGAIN;
+                return -1;
+            }
+            continue;
+        }
+        return ret; // 写失败
+    }
+}
+
 inline int CoConnect(int fd, const struct sockaddr *addr, socklen_t size)
 {
-    EventData eventData(fd, EpollFd.Get(), RPC_CLIENT);
-    eventData.cid_ = MyCoroutine::ScheduleGetRunCid(SCHEDULE);
-    EpollCtl::AddWriteEvent(eventData.epoll_fd_, eventData.fd_, &eventData); // 监听可写事件
-    TimeOutData timeOutData;
-    timeOutData.cid_ = MyCoroutine::ScheduleGetRunCid(SCHEDULE);
+    if (URING.Enabled()) // addr在提交时被内核拷贝，size通过addr2（和off共用）传递
+        return (int)uringIo(IORING_OP_CONNECT, fd, addr, 0, size, RpcTimeOut.Get().connect_time_out_ms_);
+    IoWait ioWait(fd);
+    EventData &eventData = ioWait.Event();
+    TimeOutData &timeOutData = ioWait.TimeOut();
     int64_t timerId = TIMER.Register(TimeOutCallBack, &timeOutData, RpcTimeOut.Get().connect_time_out_ms_);
     Common::Defer defer([&timeOutData, &eventData, timerId]()
                         {
-EpollCtl::ClearEvent(eventData.epoll_fd_, eventData.fd_, false);
+EpollCtl::RemoveEvent(&eventData, false);
 if (not timeOutData.time_out_) {
     TIMER.Cancel(timerId);  // 定时器不超时，则取消定时器
 } });
@@ -169,8 +340,9 @@ if (not timeOutData.time_out_) {
         if (errno == EINTR)
             continue; // 调用被中断，则直接重启connect调用
         if (errno == EINPROGRESS)
-        {                                          // 三次握手进行中
-            MyCoroutine::CoroutineYield(SCHEDULE); // 让出cpu，切换到主协程，等待下一次数据可写
+        {                                                 // 三次握手进行中
+            EpollCtl::SetEvent(&eventData, EPOLLOUT);     // 监听可写事件
+            MyCoroutine::CoroutineYield(SCHEDULE);        // 让出cpu，切换到主协程，等待下一次数据可写
             if (timeOutData.time_out_)
             { // connect超时了
                 TRACE("connect_time_out, connect_time_out_ms[%d]", RpcTimeOut.Get().connect_time_out_ms_);
@@ -183,4 +355,19 @@ if (not timeOutData.time_out_) {
     }
 }
 
+// 让当前协程睡眠ms毫秒，期间subReactor继续处理其他协程，只能在从协程中调用
+inline void CoSleep(int64_t ms)
+{
+    TimeOutData stackData;
+    TimeOutData *timeOutData = &stackData;
+    if (MyCoroutine::ScheduleIsSharedStack(SCHEDULE))
+        timeOutData = new TimeOutData; // 原因见IoWait
+    timeOutData->cid_ = MyCoroutine::ScheduleGetRunCid(SCHEDULE);
+    TIMER.Register(TimeOutCallBack, timeOutData, ms > 0 ? ms : 0);
+    while (not timeOutData->time_out_)
+        MyCoroutine::CoroutineYield(SCHEDULE); // 被其他方式唤醒时继续睡眠
+    if (timeOutData != &stackData)
+        delete timeOutData;
+}
+
 } // namespace Core
@@ -4,29 +4,37 @@
 // 该类的功能是为每个协程提供独立的局部变量，类似于线程局部存储（TLS）。
 // 每个协程都有自己的数据副本，避免了多个协程之间的冲突。
 
+#include <assert.h>
+#include <utility>
 #include "coroutine.h"
 namespace Core { // 协程本地变量模版类
 template <class Type>
 class CoroutineLocal {
 public:
+    // 构造时分配固定的槽位，Get只需要按槽位下标读取一次
+    CoroutineLocal() : slot_(MyCoroutine::CoroutineLocalSlotAlloc()) {}
     static void FreeLocal(void *data) {
         if (data)
             delete (Type *)data;
     }
     void Set(Type value) {
-        Type *temp = new Type;
-        *temp = value;
-        MyCoroutine::LocalData localData {
-            .data = temp,
-            .freeEntry = FreeLocal,
-        };
-        MyCoroutine::CoroutineLocalSet(SCHEDULE, this, localData);
+        MyCoroutine::LocalData &localData = MyCoroutine::CoroutineLocalSet(SCHEDULE, slot_);
+        if (nullptr == localData.data) { // 协程第一次设置时才分配内存，之后原地赋值
+            localData.data = new Type(std::move(value));
+            localData.freeEntry = FreeLocal;
+            return;
+        }
+        *(Type *)localData.data = std::move(value);
     }
+    // 当前协程（或者插入batch卡点的协程）是否设置过
+    bool IsSet() { return MyCoroutine::CoroutineLocalGet(SCHEDULE, slot_) != nullptr; }
     Type &Get() {
-        MyCoroutine::LocalData localData;
-        bool result = MyCoroutine::CoroutineLocalGet(SCHEDULE, this, localData);
-        assert(result == true);
-        return *(Type *)localData.data;
+        void *data = MyCoroutine::CoroutineLocalGet(SCHEDULE, slot_);
+        assert(data != nullptr);
+        return *(Type *)data;
     }
+
+private:
+    int slot_; // 协程本地变量在协程中的槽位
 };
 } // namespace Core
\ No newline at end of file
@@ -0,0 +1,169 @@
+#pragma once
+// 协程级别的同步原语：互斥锁（CoMutex）、信号量（CoSemaphore）和条件变量（CoCondVar）。
+// 等待时只挂起当前协程，不会阻塞整个subReactor线程，只能在同一个线程的协程之间使用。
+// 等待者按先进先出的顺序排队，释放时把锁或者许可直接交给队首的等待者，避免后来的协程插队导致饿死。
+// 共享栈模式下，这些对象需要分配在堆上或者是全局的。
+
+#include <assert.h>
+#include <stdint.h>
+#include <algorithm>
+#include <deque>
+#include "coroutine.h"
+#include "timer.hpp"
+
+namespace Core {
+// 协程等待队列，唤醒时标记等待者已经被授予了资源，被唤醒的协程不需要再去竞争
+class CoWaitQueue {
+public:
+    // 挂起当前协程直到被授予资源或者超时，timeOutMs小于0表示一直等待，返回是否被授予了资源，只能在从协程中调用
+    bool Wait(int64_t timeOutMs = -1) {
+        if (0 == timeOutMs)
+            return false;
+        // 分配在堆上，原因见IoWait
+        Waiter *waiter = new Waiter{MyCoroutine::ScheduleGetRunCid(SCHEDULE), false, false};
+        uint64_t timerId = 0;
+        if (timeOutMs > 0)
+            timerId = TIMER.Register(onTimeOut, waiter, timeOutMs);
+        waiters_.push_back(waiter);
+        while (not waiter->is_granted_ && not waiter->is_timeout_) // 被其他方式唤醒时继续等待
+            MyCoroutine::CoroutineYield(SCHEDULE);
+        if (timeOutMs > 0 && not waiter->is_timeout_)
+            TIMER.Cancel(timerId);
+        if (not waiter->is_granted_) // 超时的等待者还在队列中
+            waiters_.erase(std::find(waiters_.begin(), waiters_.end(), waiter));
+        bool isGranted = waiter->is_granted_;
+        delete waiter;
+        return isGranted;
+    }
+    // 把资源授予队首的等待者并唤醒它，没有等待者返回false
+    bool NotifyOne() {
+        if (waiters_.empty())
+            return false;
+        Waiter *waiter = waiters_.front();
+        waiters_.pop_front();
+        waiter->is_granted_ = true;
+        MyCoroutine::CoroutineWakeUp(SCHEDULE, waiter->cid_);
+        return true;
+    }
+    void NotifyAll() {
+        while (NotifyOne()) {
+        }
+    }
+    bool Empty() const { return waiters_.empty(); }
+    size_t Size() const { return waiters_.size(); }
+
+private:
+    typedef struct Waiter {
+        int cid_;          // 等待的协程id
+        bool is_granted_;  // 是否被授予了资源
+        bool is_timeout_;  // 是否已经超时
+    } Waiter;
+    static void onTimeOut(void *data) {
+        Waiter *waiter = (Waiter *)data;
+        waiter->is_timeout_ = true;
+        MyCoroutine::CoroutineWakeUp(SCHEDULE, waiter->cid_);
+    }
+
+private:
+    std::deque<Waiter *> waiters_;
+};
+
+class CoMutex {
+public:
+    bool TryLock() {
+        if (locked_)
+            return false;
+        locked_ = true;
+        return true;
+    }
+    void Lock() {
+        if (not TryLock())
+            wait_queue_.Wait(); // 被唤醒时锁已经交给了当前协程
+    }
+    // 带超时的加锁，超时返回false
+    bool LockFor(int64_t timeOutMs) { return TryLock() || wait_queue_.Wait(timeOutMs); }
+    void Unlock() {
+        assert(locked_);
+        if (not wait_queue_.NotifyOne()) // 有等待者时锁直接交给队首的等待者，保持加锁状态
+            locked_ = false;
+    }
+    bool IsLocked() const { return locked_; }
+
+private:
+    bool locked_{false};
+    CoWaitQueue wait_queue_;
+};
+
+class CoLockGuard {
+public:
+    explicit CoLockGuard(CoMutex &mutex) : mutex_(mutex) { mutex_.Lock(); }
+    ~CoLockGuard() { mutex_.Unlock(); }
+
+private:
+    CoMutex &mutex_;
+};
+
+// 信号量，也可以用作下游调用的并发限制，比如限制同一个rpc同时发往某个下游的请求数
+class CoSemaphore {
+public:
+    explicit CoSemaphore(int64_t count) : count_(count) {}
+    bool TryAcquire() {
+        if (count_ <= 0 || not wait_queue_.Empty()) // 有排队的等待者时不能插队
+            return false;
+        count_--;
+        return true;
+    }
+    void Acquire() {
+        if (not TryAcquire())
+            wait_queue_.Wait(); // 被唤醒时许可已经交给了当前协程
+    }
+    // 带超时的获取许可，超时返回false，用作并发限制时可以快速失败
+    bool AcquireFor(int64_t timeOutMs) { return TryAcquire() || wait_queue_.Wait(timeOutMs); }
+    void Release() {
+        if (not wait_queue_.NotifyOne()) // 有等待者时许可直接交给队首的等待者
+            count_++;
+    }
+    int64_t Available() const { return count_; }
+    size_t Waiting() const { return wait_queue_.Size(); }
+
+private:
+    int64_t count_;
+    CoWaitQueue wait_queue_;
+};
+
+class CoSemaphoreGuard {
+public:
+    explicit CoSemaphoreGuard(CoSemaphore &semaphore) : semaphore_(semaphore) { semaphore_.Acquire(); }
+    ~CoSemaphoreGuard() { semaphore_.Release(); }
+
+private:
+    CoSemaphore &semaphore_;
+};
+
+class CoCondVar {
+public:
+    // 释放锁并挂起当前协程，被唤醒后重新加锁。协程是协作式调度的，释放锁和进入等待队列之间不会有其他协程运行
+    void Wait(CoMutex &mutex) {
+        mutex.Unlock();
+        wait_queue_.Wait();
+        mutex.Lock();
+    }
+    // 带超时的等待，超时返回false，返回时都已经重新加锁
+    bool WaitFor(CoMutex &mutex, int64_t timeOutMs) {
+        mutex.Unlock();
+        bool isNotified = wait_queue_.Wait(timeOutMs);
+        mutex.Lock();
+        return isNotified;
+    }
+    template <class Predicate>
+    void Wait(CoMutex &mutex, Predicate predicate) {
+        while (not predicate())
+            Wait(mutex);
+    }
+    void NotifyOne() { wait_queue_.NotifyOne(); }
+    void NotifyAll() { wait_queue_.NotifyAll(); }
+
+private:
+    CoWaitQueue wait_queue_;
+};
+} // namespace Core
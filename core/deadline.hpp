@@ -0,0 +1,63 @@
+#pragma once
+// 请求截止时间的传递：调用方把请求的绝对截止时间（unix时间戳，单位毫秒）放在Context的deadline_ms中传给下游，
+// 下游收到已经过期的请求直接拒绝，不再做无用的业务处理；发起下游调用时把超时缩短到请求剩余的时间内。
+// 使用绝对时间可以把请求在网络和队列中等待的时间也算进去，依赖各个节点的时钟同步。
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include "../common/clock.hpp"
+#include "../protocol/base.pb.h"
+#include "coroutinelocal.hpp"
+#include "routeinfo.hpp"
+
+extern Core::CoroutineLocal<MySvr::Base::Context> ReqCtx;
+
+namespace Core {
+class Deadline {
+public:
+    static int64_t NowMs() { return Common::Clock::WallMs(); } // 事件循环中使用每轮epoll_wait之后缓存的墙上时间
+    // 当前请求的截止时间，0表示没有截止时间
+    static int64_t Get() {
+        if (not ReqCtx.IsSet())
+            return 0;
+        return ReqCtx.Get().deadline_ms();
+    }
+    // 入口服务没有上游传递的截止时间时，可以在handler中为当前请求设置截止时间
+    static void Set(int64_t timeOutMs) { ReqCtx.Get().set_deadline_ms(NowMs() + timeOutMs); }
+    static bool IsExpired(int64_t deadlineMs) { return deadlineMs > 0 && NowMs() >= deadlineMs; }
+    // 当前请求剩余的时间，单位毫秒，-1表示没有截止时间
+    static int64_t RemainMs() {
+        int64_t deadlineMs = Get();
+        if (deadlineMs <= 0)
+            return -1;
+        return std::max(deadlineMs - NowMs(), (int64_t)0);
+    }
+    // 调用下游时传递的截止时间，取当前请求的截止时间和本次调用超时时间的较小值
+    static int64_t ForCall(const TimeOut &timeOut) {
+        int64_t callDeadlineMs = NowMs() + timeOut.write_time_out_ms_ + timeOut.read_time_out_ms_;
+        int64_t deadlineMs = Get();
+        if (deadlineMs <= 0)
+            return callDeadlineMs;
+        return std::min(deadlineMs, callDeadlineMs);
+    }
+    // 把读写和连接超时缩短到当前请求剩余的时间内，最少保留1毫秒
+    static void ShrinkTimeOut(TimeOut &timeOut) {
+        int64_t remainMs = RemainMs();
+        if (remainMs < 0)
+            return;
+        remainMs = std::max(remainMs, (int64_t)1);
+        timeOut.connect_time_out_ms_ = std::min(timeOut.connect_time_out_ms_, remainMs);
+        timeOut.write_time_out_ms_ = std::min(timeOut.write_time_out_ms_, remainMs);
+        timeOut.read_time_out_ms_ = std::min(timeOut.read_time_out_ms_, remainMs);
+    }
+    // 因为超过截止时间而被拒绝的请求数，所有subReactor共用
+    static void AddShed() { shedCount()++; }
+    static int64_t ShedCount() { return shedCount().load(); }
+
+private:
+    static std::atomic<int64_t> &shedCount() {
+        static std::atomic<int64_t> count{0};
+        return count;
+    }
+};
+} // namespace Core
@@ -1,5 +1,6 @@
 #pragma once
 #include <assert.h>
+#include <stdint.h>
 #include <sys/epoll.h>
 #include <unistd.h>
 #include <map>
@@ -11,6 +12,8 @@ enum EventType {    // 监听的逻辑类型
     LISTEN = 1,     // listen fd的事件监听
     CLIENT = 2,     // 客户端事件的监听
     RPC_CLIENT = 3, // rpc客户端读写的监听
+    IO_URING = 4,   // io_uring完成事件的监听
+    WAKE_UP = 5,    // subReactor之间唤醒通知（eventfd）的监听
 };
 struct EventData {
     EventData(int fd, int epoll_fd, int type) : fd_(fd), epoll_fd_(epoll_fd), type_(type) {}
@@ -21,6 +24,9 @@ struct EventData {
     int cid_{-1};            // 关联的协程id
     int64_t timer_id_{-1};   // mainReactor中用于关联空闲连接超时定时器的id
     void *handler_{nullptr}; // 客户端初始事件的处理入口
+    void *conn_{nullptr};    // 客户端连接上持久保存的状态（Core::ConnState），包括编解码器和还没有写完的应答
+    int registered_epoll_fd_{-1}; // fd当前注册在哪个epoll实例中，-1表示没有注册
+    uint32_t interest_{0};        // 缓存的当前生效的监听事件，ONESHOT事件触发之后内核会禁用监听，这时为0
 };
 
 class EpollCtl {
@@ -38,10 +44,48 @@ public:
         opEvent(epollFd, fd, userData, EPOLL_CTL_MOD, EPOLLOUT);
     }
     static void ClearEvent(int epollFd, int fd, bool isClose = true) {
+        CtlCount()++;
         assert(epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr) != -1);
         if (isClose)
             close(fd); // close操作需要EPOLL_CTL_DEL之后调用，否则调用epoll_ctl()删除fd会失败
     }
+    // 按需更新fd在epoll实例中的注册，fd在整个生命周期内保持注册，只有监听的事件真正变化时才调用epoll_ctl：
+    // 没有注册过则ADD，注册在其他epoll实例中（连接迁移到其他subReactor）则先DEL再ADD，监听事件变化了则MOD。
+    // ADD/MOD之后事件可能马上在其他线程的epoll_wait中返回并处理这个EventData，所以缓存的字段要在epoll_ctl之前更新
+    static void SetEvent(EventData *eventData, uint32_t events) {
+        if (eventData->registered_epoll_fd_ == eventData->epoll_fd_) {
+            if (eventData->interest_ == events)
+                return;
+            eventData->interest_ = events;
+            opEvent(eventData->epoll_fd_, eventData->fd_, eventData, EPOLL_CTL_MOD, events);
+            return;
+        }
+        if (eventData->registered_epoll_fd_ >= 0)
+            ClearEvent(eventData->registered_epoll_fd_, eventData->fd_, false);
+        eventData->registered_epoll_fd_ = eventData->epoll_fd_;
+        eventData->interest_ = events;
+        opEvent(eventData->epoll_fd_, eventData->fd_, eventData, EPOLL_CTL_ADD, events);
+    }
+    // 取消fd的注册，关闭fd时内核会自动把fd从所有epoll实例中移除，所以isClose为true时不需要EPOLL_CTL_DEL
+    static void RemoveEvent(EventData *eventData, bool isClose = true) {
+        if (not isClose && eventData->registered_epoll_fd_ >= 0)
+            ClearEvent(eventData->registered_epoll_fd_, eventData->fd_, false);
+        eventData->registered_epoll_fd_ = -1;
+        eventData->interest_ = 0;
+        if (isClose)
+            close(eventData->fd_);
+    }
+    // epoll_wait返回事件之后调用，ONESHOT的事件触发之后内核已经禁用了监听，同步更新缓存的监听事件
+    static void Triggered(EventData *eventData, uint32_t events) {
+        eventData->events_ = events;
+        if (eventData->interest_ & EPOLLONESHOT)
+            eventData->interest_ = 0;
+    }
+    // 当前线程调用epoll_ctl的次数，用于评估每个请求的系统调用开销
+    static int64_t &CtlCount() {
+        static thread_local int64_t count = 0;
+        return count;
+    }
     static std::string EventReadable(int events) {
         static std::map<uint32_t, std::string> event2Str = {
             {EPOLLIN, "EPOLLIN"},   {EPOLLOUT, "EPOLLOUT"}, {EPOLLRDHUP, "EPOLLRDHUP"}, 
@@ -68,6 +112,7 @@ private:
         epoll_event event;
         event.data.ptr = userData;
         event.events = events;
+        CtlCount()++;
         assert(epoll_ctl(epollFd, op, fd, &event) != -1);
     }
 };
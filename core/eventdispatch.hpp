@@ -1,25 +1,59 @@
 #pragma once
 #include <sys/epoll.h>
 #include <condition_variable>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <thread>
+#include <vector>
+#include "../common/bufferpool.hpp"
 #include "../common/log.hpp"
 #include "../common/utils.hpp"
+#include "admission.hpp"
 #include "connmanager.hpp"
 #include "coroutinelocal.hpp"
 #include "epollctl.hpp"
 #include "handler.hpp"
+#include "periodictask.hpp"
 #include "timer.hpp"
+#include "workstealdeque.hpp"
 
 extern Core::CoroutineLocal<int> EpollFd;
 
 namespace Core {
+// 协程池的配置，对应配置文件[MyRPC]中的同名配置项
+typedef struct CoroutinePoolConf {
+    int64_t coroutine_count_{1024};  // 每个subReactor的协程池的大小
+    int64_t stack_size_{64 * 1024};  // 协程栈的大小，单位字节
+    int64_t shared_stack_count_{0};  // 大于0时开启共享栈模式
+    int64_t stack_profile_{0};       // 栈使用量统计的模式，取值见MyCoroutine::StackProfileMode
+    int64_t admission_queue_size_{1024};  // 协程池满了之后，等待协程的连接队列的容量
+    int64_t admission_queue_time_ms_{100}; // 请求等待协程的时间上限，单位毫秒
+} CoroutinePoolConf;
+
 class EventDispatch {
 public:
-    void Run(std::string listenIf, int64_t port, int64_t coroutineCount) {
-        // 启动subReactor,这里需要调用detach，让创建的线程独立运行
-        std::thread(subHandler, coroutineCount, this).detach(); 
+    void Run(std::string listenIf, int64_t port, int64_t subReactorCount, CoroutinePoolConf poolConf,
+             bool workStealing = false, bool reusePortAccept = false, bool ioUring = false) {
+        assert(subReactorCount > 0);
+        sub_epoll_fds_.resize(subReactorCount, -1);
+        work_stealing_ = workStealing && subReactorCount > 1;
+        for (int64_t i = 0; work_stealing_ && i < subReactorCount; i++)
+            request_queues_.emplace_back(new WorkStealDeque<EventData>());
+        if (work_stealing_)
+            idle_waker_.reset(new IdleWaker((int)subReactorCount));
+        listen_if_ = listenIf;
+        port_ = (int)port;
+        reuse_port_accept_ = reusePortAccept;
+        io_uring_ = ioUring;
+        // 启动subReactor,这里需要调用detach，让创建的线程独立运行。
+        // 每个subReactor线程有自己的epoll实例，以及线程级的协程调度器、定时器和连接池
+        for (int64_t i = reusePortAccept ? 1 : 0; i < subReactorCount; i++)
+            std::thread(subHandler, poolConf, (int)i, this).detach();
+        if (reusePortAccept) { // 各个subReactor自己接受连接，不需要mainReactor，当前线程直接作为第0个subReactor
+            subHandler(poolConf, 0, this);
+            return;
+        }
         mainHandler(listenIf, port);                            
     }
     void RegHandler(MyHandler *handler) { 
@@ -30,17 +64,18 @@ private:
     void waitSubReactor() {
         std::unique_lock<std::mutex> locker(mutex_);
         cond_.wait(locker, [this]() -> bool {
-             return sub_reactor_run_; 
+             return sub_reactor_run_cnt_ == sub_epoll_fds_.size(); 
         });
     }
     void subReactorNotify() {
         std::unique_lock<std::mutex> locker(mutex_);
-        sub_reactor_run_ = true;
+        sub_reactor_run_cnt_++;
         cond_.notify_one();
     }
     static void clearEventAndDelete(void *data) {
         EventData *eventData = (EventData *)data;
-        EpollCtl::ClearEvent(eventData->epoll_fd_, eventData->fd_); // 超时清除事件的监听，关闭连接
+        EpollCtl::RemoveEvent(eventData); // 超时关闭连接，同时清除事件的监听
+        MyHandler::DeleteConn(eventData);
         delete eventData;                                           // 释放空间
     }
     
@@ -54,7 +89,6 @@ private:
         assert(main_epoll_fd_ > 0);
         
         EventData eventData(listen_sock_fd_, main_epoll_fd_, LISTEN);
-        Common::Utils::SetNotBlock(listen_sock_fd_);
         EpollCtl::AddReadEvent(main_epoll_fd_, listen_sock_fd_, &eventData);
         int msec = -1;
         TimerData timerData;
@@ -64,6 +98,7 @@ private:
             if (oneTimer)
                 msec = idle_connection_timer_.TimeOutMs(timerData);
             int num = epoll_wait(main_epoll_fd_, events, 2048, msec);
+            Common::Clock::Update(); // 本轮事件处理中的定时器、耗时统计等使用同一个缓存的时间
             if (num < 0) {
                 ERROR("epoll_wait failed, errMsg[%s]", strerror(errno));
                 continue;
@@ -78,7 +113,7 @@ private:
 
             for (int i = 0; i < num; i++) {
                 EventData *data = (EventData *)events[i].data.ptr;
-                data->events_ = events[i].events;
+                EpollCtl::Triggered(data, events[i].events);
                 mainEventHandler(data);
             }
             if (oneTimer)
@@ -86,12 +121,88 @@ private:
         }
     }
     
-    static void subHandler(int coroutineCount, EventDispatch *eventDispatch){
+    // 定时把按rpc统计的栈使用量打印到日志中，用于评估服务需要的协程栈大小
+    static void stackProfileReport(void *data) {
+        for (auto &item : MyCoroutine::ScheduleStackProfile(SCHEDULE)) {
+            const MyCoroutine::StackUsage &usage = item.second;
+            INFO("stack usage tag[%s] count[%ld] p50[%d] p99[%d] p99.9[%d] max[%d]", item.first.c_str(), usage.count,
+                 MyCoroutine::StackUsagePercentile(usage, 0.5), MyCoroutine::StackUsagePercentile(usage, 0.99),
+                 MyCoroutine::StackUsagePercentile(usage, 0.999), usage.max);
+        }
+        TIMER.Register(stackProfileReport, nullptr, 60 * 1000);
+    }
+
+    // 定时把每个subReactor的缓冲区池的命中率和持有的空闲内存打印到日志中，data是subReactor的编号
+    static void bufferPoolReport(void *data) {
+        Common::BufferPool &pool = BUFFER_POOL;
+        INFO("buffer pool index[%ld] alloc[%ld] hit_rate[%.4f] bytes_held[%ld]", (long)(intptr_t)data,
+             pool.AllocCount(), pool.HitRate(), pool.BytesHeld());
+        TIMER.Register(bufferPoolReport, data, 60 * 1000);
+    }
+
+    // 定时把因为超过截止时间而被拒绝的请求数打印到日志中，只在第0个subReactor上注册
+    static void deadlineShedReport(void *data) {
+        static int64_t lastShedCount = 0;
+        int64_t shedCount = Deadline::ShedCount();
+        if (shedCount != lastShedCount)
+            INFO("deadline exceeded shed total[%ld] last_60s[%ld]", shedCount, shedCount - lastShedCount);
+        lastShedCount = shedCount;
+        TIMER.Register(deadlineShedReport, nullptr, 60 * 1000);
+    }
+    // 定时把准入等待队列的深度和因为过载而被拒绝的请求数打印到日志中，只在第0个subReactor上注册
+    static void admissionReport(void *data) {
+        static int64_t lastShedCount = 0;
+        int64_t shedCount = Admission::ShedCount();
+        int64_t queueDepth = Admission::QueueDepth();
+        if (shedCount != lastShedCount || queueDepth > 0)
+            INFO("admission queue depth[%ld] overload shed total[%ld] last_60s[%ld]", queueDepth, shedCount,
+                 shedCount - lastShedCount);
+        lastShedCount = shedCount;
+        TIMER.Register(admissionReport, nullptr, 60 * 1000);
+    }
+
+    static void subHandler(CoroutinePoolConf poolConf, int index, EventDispatch *eventDispatch){
         epoll_event events[2048];
-        eventDispatch->sub_epoll_fd_ = epoll_create(1);
-        assert(eventDispatch->sub_epoll_fd_ > 0);
+        int subEpollFd = epoll_create(1);
+        assert(subEpollFd > 0);
+        eventDispatch->sub_epoll_fds_[index] = subEpollFd;
+        if (eventDispatch->work_stealing_) { // 其他subReactor的请求队列积压时，通过eventfd唤醒空闲的subReactor
+            int wakeUpFd = eventDispatch->idle_waker_->Fd(index);
+            EpollCtl::AddReadEvent(subEpollFd, wakeUpFd, new EventData(wakeUpFd, subEpollFd, WAKE_UP));
+        }
         eventDispatch->subReactorNotify();
-        MyCoroutine::ScheduleInit(SCHEDULE, coroutineCount, 64 * 1024);
+        MyCoroutine::ScheduleInit(SCHEDULE, poolConf.coroutine_count_, poolConf.stack_size_,
+                                  MyCoroutine::DEFAULT_SWITCH_MODE, poolConf.shared_stack_count_);
+        if (poolConf.stack_profile_ != MyCoroutine::StackProfileOff) {
+            MyCoroutine::ScheduleSetStackProfile(SCHEDULE, (MyCoroutine::StackProfileMode)poolConf.stack_profile_);
+            TIMER.Register(stackProfileReport, nullptr, 60 * 1000);
+        }
+        PERIODIC_TASK.Start(index); // 启动注册的周期任务
+        ADMISSION.Init(poolConf.admission_queue_size_, poolConf.admission_queue_time_ms_);
+        TIMER.Register(bufferPoolReport, (void *)(intptr_t)index, 60 * 1000);
+        if (0 == index) {
+            TIMER.Register(deadlineShedReport, nullptr, 60 * 1000);
+            TIMER.Register(admissionReport, nullptr, 60 * 1000);
+        }
+        if (eventDispatch->io_uring_) { // 共享栈模式下IO的缓冲区可能在被换出的协程栈上，不能交给内核异步读写
+            if (poolConf.shared_stack_count_ > 0 || not URING.Init(1024))
+                WARN("io_uring disabled, fall back to epoll. index[%d]", index);
+            else // ring有完成事件时fd可读，和其他事件一起由epoll_wait等待
+                EpollCtl::AddReadEvent(subEpollFd, URING.Fd(), new EventData(URING.Fd(), subEpollFd, IO_URING));
+        }
+        if (eventDispatch->reuse_port_accept_) { // 每个subReactor有自己的监听socket，由内核在它们之间均衡新连接
+            int listenFd = createListenSocket(eventDispatch->listen_if_, eventDispatch->port_);
+            assert(listenFd > 0);
+            EventData *listenData = new EventData(listenFd, subEpollFd, LISTEN);
+            listenData->handler_ = eventDispatch->handler_;
+            if (URING.Enabled()) {
+                UringRequest *acceptRequest = new UringRequest;
+                acceptRequest->callback_ = uringAcceptCallBack;
+                acceptRequest->arg_ = listenData;
+                submitUringAccept(acceptRequest);
+            } else
+                EpollCtl::AddReadEvent(subEpollFd, listenFd, listenData);
+        }
         int msec = -1;
         TimerData timerData;
         bool oneTimer = false;
@@ -100,7 +211,19 @@ private:
             oneTimer = TIMER.GetLastTimer(timerData);
             if (oneTimer)
                 msec = TIMER.TimeOutMs(timerData);
-            int num = epoll_wait(eventDispatch->sub_epoll_fd_, events, 2048, msec);
+            if (not ADMISSION.Empty() && (msec < 0 || msec > 1))
+                msec = 1; // 有等待协程的请求时，需要定期检查排队超时的请求
+            bool idle = msec != 0 && eventDispatch->work_stealing_;
+            if (idle && not eventDispatch->prepareIdle(index)) { // 标记空闲之后发现有积压的请求，不挂起，直接去窃取
+                idle = false;
+                msec = 0;
+            }
+            if (URING.Enabled())
+                URING.Submit(); // 挂起之前批量提交本轮所有协程的io_uring请求
+            int num = epoll_wait(subEpollFd, events, 2048, msec);
+            Common::Clock::Update();
+            if (idle)
+                eventDispatch->idle_waker_->SetIdle(index, false);
             if (num < 0) {
                 ERROR("epoll_wait failed, errMsg[%s]", strerror(errno));
                 continue;
@@ -114,12 +237,19 @@ private:
                 msec = 0; // 下次大概率还有事件，故msec设置为0
             for (int i = 0; i < num; i++) {
                 EventData *eventData = (EventData *)events[i].data.ptr;
-                eventData->events_ = events[i].events;
-                eventDispatch->subEventHandler(eventData);
+                EpollCtl::Triggered(eventData, events[i].events);
+                eventDispatch->subEventHandler(eventData, index);
             }
-            if (oneTimer)
-                TIMER.Run(timerData);                        // 处理定时器
+            if (eventDispatch->work_stealing_)
+                eventDispatch->runQueuedRequests(index); // 处理排队的请求
+            if (oneTimer) { // 定时器回调直接恢复的协程可能是batch中最后执行完的，需要恢复等待batch的协程
+                TIMER.Run(timerData);
+                MyCoroutine::CoroutineResumeBatchFinish(SCHEDULE);
+            }
+            MyCoroutine::CoroutineResumeWakeUp(SCHEDULE);   // 唤醒被channel或者定时器标记的协程
+            runAdmission();                                 // 协程释放之后处理等待协程的请求
             MyCoroutine::ScheduleTryReleaseMemory(SCHEDULE); // 尝试释放协程池的内存
+            BUFFER_POOL.TryTrim();                           // 按高水位释放缓冲区池中多余的空闲缓冲区
         }
     }
     
@@ -129,47 +259,150 @@ private:
         EpollFd.Set(eventData->epoll_fd_); // 把epoll实例fd，设置为协程本地变量
         handler->HandlerEntry(eventData);
     }
-    void subEventHandler(EventData *eventData) {
+    // 为连接上新到来的请求创建处理的协程。协程满了则放入准入等待队列，等待队列也满了则拒绝请求
+    static int createHandlerCoroutine(EventData *eventData) {
+        if (MyCoroutine::CoroutineCanCreate(SCHEDULE) && ADMISSION.Empty()) { // 有排队的请求时不能插队
+            eventData->cid_ = MyCoroutine::CoroutineCreate(
+                SCHEDULE, coroutineEventEntry, eventData, 0); // 创建协程
+            return eventData->cid_;
+        }
+        if (not ADMISSION.Push(eventData)) {
+            WARN("MyCoroutine is full and admission queue is full");
+            shedRequest(eventData);
+        }
+        return MyCoroutine::INVALID_ROUTINE_ID;
+    }
+    // 按先进先出的顺序为等待队列中的请求创建协程，排队超时的请求直接拒绝
+    static void runAdmission() {
+        while (not ADMISSION.Empty()) {
+            if (ADMISSION.FrontExpired()) {
+                shedRequest(ADMISSION.Pop());
+                continue;
+            }
+            if (not MyCoroutine::CoroutineCanCreate(SCHEDULE))
+                break;
+            EventData *eventData = ADMISSION.Pop();
+            eventData->cid_ = MyCoroutine::CoroutineCreate(SCHEDULE, coroutineEventEntry, eventData, 0);
+            MyCoroutine::CoroutineResumeById(SCHEDULE, eventData->cid_);
+            MyCoroutine::CoroutineResumeBatchFinish(SCHEDULE);
+        }
+    }
+    // 因为过载拒绝请求，回复过载的错误之后保留连接，等待连接上的下一个请求；对端已经关闭或者无法回复时关闭连接
+    static void shedRequest(EventData *eventData) {
+        MyHandler *handler = (MyHandler *)eventData->handler_;
+        if (handler->RejectOverloaded(eventData)) {
+            Admission::AddShed();
+            // 应答没有写完时同时监听可写事件，可写之后由处理连接的协程或者下一次拒绝继续写回
+            EpollCtl::SetEvent(eventData, MyHandler::HasPendingResp(eventData) ? EPOLLIN | EPOLLOUT | EPOLLONESHOT
+                                                                                : EPOLLIN | EPOLLONESHOT);
+            return;
+        }
+        clearEventAndDelete(eventData);
+    }
+    void subEventHandler(EventData *eventData, int index) {
         int cid = eventData->cid_;
-        if (RPC_CLIENT == eventData->type_)
-            MyCoroutine::CoroutineResumeById(SCHEDULE, eventData->cid_); // 唤醒之前主动让出cpu的协程
-        else if (CLIENT == eventData->type_) {
+        if (LISTEN == eventData->type_)
+            return subLoopAccept(eventData, 2048); // 每个subReactor自己接受连接的模式
+        if (WAKE_UP == eventData->type_)
+            return idle_waker_->Drain(index); // 窃取在本轮事件处理完之后统一进行
+        if (IO_URING == eventData->type_) {
+            for (int uringCid : URING.Reap()) { // 唤醒io_uring请求已经完成的协程
+                MyCoroutine::CoroutineResumeById(SCHEDULE, uringCid);
+                MyCoroutine::CoroutineResumeInBatch(SCHEDULE, uringCid);
+            }
+            MyCoroutine::CoroutineResumeBatchFinish(SCHEDULE);
+            return;
+        }
+        if (RPC_CLIENT == eventData->type_) {
+            if (MyCoroutine::INVALID_ROUTINE_ID == cid)
+                return; // 连接池中空闲连接上边缘触发的事件，没有等待的协程，直接忽略
+            MyCoroutine::CoroutineResumeById(SCHEDULE, cid); // 唤醒之前主动让出cpu的协程
+        } else if (CLIENT == eventData->type_) {
             if (eventData->cid_ == MyCoroutine::INVALID_ROUTINE_ID) { // 没有运行的协程关联，则创建协程
-                if (MyCoroutine::CoroutineCanCreate(SCHEDULE)) {
-                    eventData->cid_ = MyCoroutine::CoroutineCreate(
-                        SCHEDULE, coroutineEventEntry, eventData, 0); // 创建协程
-                    cid = eventData->cid_;
+                if (eventData->timer_id_ >= 0) { // 连接上的第一个请求到来，取消空闲连接超时定时器
+                    TIMER.Cancel(eventData->timer_id_);
+                    eventData->timer_id_ = -1;
                 }
-                else { // 协程满之后，直接清除事件监听，关闭连接，释放空间
-                    WARN("MyCoroutine is full");
-                    clearEventAndDelete(eventData);
+                if (work_stealing_ && queueRequest(eventData, index))
+                    return; // 开启工作窃取时，新请求先排队，可能被空闲的subReactor窃取
+                cid = createHandlerCoroutine(eventData);
+                if (MyCoroutine::INVALID_ROUTINE_ID == cid)
                     return;
-                }
             }
             MyCoroutine::CoroutineResumeById(SCHEDULE, cid); // 唤醒协程
         }
         MyCoroutine::CoroutineResumeInBatch(SCHEDULE, cid); // 如果有插入batch卡点，则唤醒batch卡点关联的协程
         MyCoroutine::CoroutineResumeBatchFinish(SCHEDULE);  // 尝试唤醒batch都已经执行完的协程。
     }
+
+    // 新请求在还没有创建协程之前放入所属subReactor的队列中。连接以ONESHOT方式注册，事件触发之后内核已经禁用了监听，
+    // 不需要从epoll实例中移除，处理请求的协程只有一个IO事件唤醒点。队列满了则在当前subReactor直接处理。
+    // 队列中已经有积压的请求时唤醒一个空闲的subReactor来窃取，只有一个请求时当前subReactor马上就会处理
+    bool queueRequest(EventData *eventData, int index) {
+        if (not request_queues_[index]->Push(eventData))
+            return false;
+        if (request_queues_[index]->Size() > 1)
+            idle_waker_->WakeOne(index);
+        return true;
+    }
+    // 挂起之前标记当前subReactor空闲，再检查一次所有的队列，有积压的请求时取消空闲标记并返回false
+    bool prepareIdle(int index) {
+        idle_waker_->SetIdle(index, true);
+        for (auto &queue : request_queues_) {
+            if (queue->Size() > 0) {
+                idle_waker_->SetIdle(index, false);
+                return false;
+            }
+        }
+        return true;
+    }
+    // 在当前subReactor中处理排队的请求，连接迁移到当前subReactor的epoll实例中，之后的请求也由当前subReactor处理。
+    // 下一次激活监听时EpollCtl::SetEvent发现epoll实例变化了，才把连接重新注册到当前subReactor的epoll实例中
+    void runRequest(EventData *eventData, int index) {
+        eventData->epoll_fd_ = sub_epoll_fds_[index];
+        int cid = createHandlerCoroutine(eventData);
+        if (MyCoroutine::INVALID_ROUTINE_ID == cid)
+            return;
+        MyCoroutine::CoroutineResumeById(SCHEDULE, cid);
+        MyCoroutine::CoroutineResumeBatchFinish(SCHEDULE);
+    }
+    // 先按先进先出的顺序处理自己队列中的请求，自己的队列空了再从其他subReactor的队列中窃取
+    void runQueuedRequests(int index) {
+        EventData *eventData = nullptr;
+        while ((eventData = request_queues_[index]->Steal()) != nullptr)
+            runRequest(eventData, index);
+        int stealCnt = 0;
+        for (size_t i = 1; i < request_queues_.size() && stealCnt < 16; i++) { // 每轮最多窃取16个，避免饿死自己的连接
+            WorkStealDeque<EventData> *victim = request_queues_[(index + i) % request_queues_.size()].get();
+            while (stealCnt < 16 && (eventData = victim->Steal()) != nullptr) {
+                runRequest(eventData, index);
+                stealCnt++;
+            }
+        }
+    }
     
     void mainEventHandler(EventData *eventData) {
         if (LISTEN == eventData->type_)
             return loopAccept(2048); // 执行到这里就是有客户端的连接到来了，循环接受客户端的连接
 
-        // 客户端有可读事件，把客户端连接读写事件监听迁移到sub_epoll_fd_中，并取消超时定时器
+        // 客户端有可读事件，把客户端连接读写事件监听轮流迁移到各个subReactor的epoll实例中，并取消超时定时器
         idle_connection_timer_.Cancel(eventData->timer_id_);
-        EpollCtl::ClearEvent(main_epoll_fd_, eventData->fd_, false);
+        eventData->timer_id_ = -1;
+        int subEpollFd = sub_epoll_fds_[next_sub_reactor_];
+        next_sub_reactor_ = (next_sub_reactor_ + 1) % sub_epoll_fds_.size();
         eventData->handler_ = handler_;
-        eventData->epoll_fd_ = sub_epoll_fd_;
-        EpollCtl::AddReadEvent(sub_epoll_fd_, eventData->fd_, eventData); // 监听可读事件，添加到sub_epoll_fd_中
+        eventData->epoll_fd_ = subEpollFd;
+        // 从main_epoll_fd_中移除，以ONESHOT方式添加到subReactor的epoll实例中，之后连接一直注册在subReactor中
+        EpollCtl::SetEvent(eventData, EPOLLIN | EPOLLONESHOT);
     }
 
-    int createListenSocket(std::string listenIf, int port) {
+    // 监听socket都开启SO_REUSEPORT，多个worker进程（以及reuse_port_accept模式下的多个subReactor）监听同一个端口
+    static int createListenSocket(std::string listenIf, int port) {
         sockaddr_in addr;
         addr.sin_family = AF_INET;
         addr.sin_port = htons(port);
         addr.sin_addr.s_addr = Common::Utils::GetAddr(listenIf);
-        int sockFd = socket(AF_INET, SOCK_STREAM, 0);
+        int sockFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
         int reuse = 1;
         if (sockFd < 0) {
             ERROR("socket failed. errMsg[%s]", strerror(errno)); return -1;
@@ -188,16 +421,15 @@ private:
     
     void loopAccept(int maxConn) { // 调用本函数之前需要把sockFd设置成非阻塞的
         while (maxConn--) {
-            int clientFd = accept(listen_sock_fd_, NULL, 0);
+            int clientFd = accept4(listen_sock_fd_, NULL, 0, SOCK_NONBLOCK); // 接受连接的同时设置成非阻塞的
             if (clientFd > 0) {
-                Common::Utils::SetNotBlock(clientFd);
                 Common::SockOpt::DisableNagle(clientFd);
                 Common::SockOpt::EnableKeepAlive(clientFd, 300, 12, 5);
                 EventData *eventData = new EventData(clientFd, main_epoll_fd_, CLIENT);
                 // 注册定时器，30秒超时
                 eventData->timer_id_ = idle_connection_timer_.Register(
                     clearEventAndDelete, eventData, 30000);
-                EpollCtl::AddReadEvent(main_epoll_fd_, clientFd, eventData); // 监听可读事件，添加到main_epoll_fd_中
+                EpollCtl::SetEvent(eventData, EPOLLIN); // 监听可读事件，添加到main_epoll_fd_中
                 continue;
             }
             if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
@@ -205,16 +437,77 @@ private:
             break;
         }
     }
+    // 在subReactor中直接接受连接，连接从一开始就注册在当前subReactor的epoll实例中，不需要mainReactor迁移，
+    // 空闲连接超时定时器也注册在当前subReactor的线程级定时器中
+    void subLoopAccept(EventData *listenData, int maxConn) {
+        while (maxConn--) {
+            int clientFd = accept4(listenData->fd_, NULL, 0, SOCK_NONBLOCK);
+            if (clientFd > 0) {
+                newSubConnection(clientFd, listenData);
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                ERROR("accept failed. errMsg[%s]", strerror(errno));
+            break;
+        }
+    }
+    static void newSubConnection(int clientFd, EventData *listenData) {
+        Common::SockOpt::DisableNagle(clientFd);
+        Common::SockOpt::EnableKeepAlive(clientFd, 300, 12, 5);
+        EventData *eventData = new EventData(clientFd, listenData->epoll_fd_, CLIENT);
+        eventData->handler_ = listenData->handler_;
+        eventData->timer_id_ = TIMER.Register(clearEventAndDelete, eventData, 30000); // 30秒超时
+        EpollCtl::SetEvent(eventData, EPOLLIN | EPOLLONESHOT); // 连接整个生命周期都注册在当前subReactor中
+    }
+    // io_uring后端使用multishot accept，一次提交持续接受新连接，每个新连接产生一个完成事件
+    static void submitUringAccept(UringRequest *acceptRequest) {
+        EventData *listenData = (EventData *)acceptRequest->arg_;
+        io_uring_sqe *sqe = URING.GetSqe();
+        if (nullptr == sqe)
+            return uringAcceptFallBack(acceptRequest);
+        sqe->opcode = IORING_OP_ACCEPT;
+        sqe->fd = listenData->fd_;
+        sqe->accept_flags = SOCK_NONBLOCK; // 接受连接的同时设置成非阻塞的
+        sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+        sqe->user_data = (uint64_t)acceptRequest;
+    }
+    static void uringAcceptCallBack(UringRequest *acceptRequest, int32_t res, uint32_t flags) {
+        if (res >= 0)
+            newSubConnection(res, (EventData *)acceptRequest->arg_);
+        else
+            ERROR("accept failed. errMsg[%s]", strerror(-res));
+        if (flags & IORING_CQE_F_MORE)
+            return;
+        if (res >= 0) // multishot被内核终止了（例如完成队列溢出），需要重新提交
+            return submitUringAccept(acceptRequest);
+        // 出错终止的不再重新提交：5.19之前的内核不支持multishot accept，每次提交都会返回EINVAL，
+        // 其他错误马上重新提交也大概率再次失败，都改用epoll接受连接
+        uringAcceptFallBack(acceptRequest);
+    }
+    static void uringAcceptFallBack(UringRequest *acceptRequest) {
+        EventData *listenData = (EventData *)acceptRequest->arg_;
+        WARN("uring accept disabled, fall back to epoll. fd[%d]", listenData->fd_);
+        delete acceptRequest;
+        EpollCtl::AddReadEvent(listenData->epoll_fd_, listenData->fd_, listenData);
+    }
 
 private:
     MyHandler *handler_;          // 业务处理的handler
-    int sub_epoll_fd_;            // epoll实例的fd，用于监听客户端的读写
+    std::vector<int> sub_epoll_fds_; // 每个subReactor的epoll实例的fd，用于监听客户端的读写
+    size_t next_sub_reactor_{0};     // 下一个迁移的连接分配给哪个subReactor
+    bool work_stealing_{false};      // 是否开启subReactor之间的工作窃取
+    bool reuse_port_accept_{false};  // 是否由每个subReactor通过自己的SO_REUSEPORT监听socket直接接受连接
+    bool io_uring_{false};           // 是否使用io_uring后端执行协程的读写、连接和接受连接
+    std::string listen_if_;          // 监听的网卡
+    int port_{0};                    // 监听的端口
+    std::vector<std::unique_ptr<WorkStealDeque<EventData>>> request_queues_; // 每个subReactor排队等待创建协程的请求
+    std::unique_ptr<IdleWaker> idle_waker_; // 开启工作窃取时，用于唤醒空闲的subReactor
     int main_epoll_fd_;           // epoll实例的fd，用于监听客户端连接
     int listen_sock_fd_;          // 开启网络监听的fd
     Timer idle_connection_timer_; // 空闲连接定时器
 
     std::mutex mutex_;
     std::condition_variable cond_;
-    bool sub_reactor_run_{false};
+    size_t sub_reactor_run_cnt_{0}; // 已经启动的subReactor个数
 };
 } // namespace Core
\ No newline at end of file
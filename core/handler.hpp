@@ -5,6 +5,7 @@
 #include "../protocol/mixedcodec.hpp"
 #include "coroutineio.hpp"
 #include "coroutinelocal.hpp"
+#include "deadline.hpp"
 #include "distributedtrace.hpp"
 #include "epollctl.hpp"
 
@@ -35,66 +36,99 @@ extern Core::CoroutineLocal<Core::TimeOut> RpcTimeOut;
 extern Core::CoroutineLocal<MySvr::Base::Context> ReqCtx;
 
 namespace Core {
+constexpr int MAX_PIPELINE_READS = 32;          // 一次可读事件中最多从socket连续读取的请求数
+constexpr size_t CONN_READ_BUFFER_LEN = 16 * 1024; // 客户端连接批量读取的缓冲区大小
+constexpr size_t MAX_PENDING_RESP_LEN = 64 * 1024; // pipeline请求的应答最多累积的长度，超过之后立即写回
+constexpr int MAX_WRITE_IOVECS = 64;               // 一次writev最多写入的片段数
+
+// 客户端连接上持久保存的状态
+typedef struct ConnState {
+    explicit ConnState(size_t bulkLen) : codec_(bulkLen) {}
+    Protocol::MixedCodec codec_; // 编解码器，请求之间读取了但还没有处理的数据不会丢失
+    Protocol::IOBuf pending_;    // 还没有写回的应答，过载拒绝时没有写完的应答也留在这里，由后续的写操作按顺序写回
+} ConnState;
+
 class MyHandler {
 public:
     void HandlerEntry(EventData *eventData) {
         auto releaseConn = [eventData](const std::string &error) {
             WARN("releaseConn %s, events=%s", 
                     error.c_str(), EpollCtl::EventReadable(eventData->events_).c_str());
-            EpollCtl::ClearEvent(eventData->epoll_fd_, eventData->fd_);
+            EpollCtl::RemoveEvent(eventData);
+            DeleteConn(eventData);
             delete eventData; 
         };
 
-        Common::TimeStat timeStat;
-        Protocol::MixedCodec codec;
+        ConnState &conn = *getConn(eventData);
+        Protocol::MixedCodec &codec = conn.codec_;
+        Protocol::IOBuf &pending = conn.pending_;
         void *req = nullptr;   // 请求的指针
-        void *resp = nullptr;  // 响应对象的指针
-        
+        if (not writeRespMessage(eventData, pending, releaseConn)) // 先写完过载拒绝时没有写完的应答
+            return;
         if (not readReqMessage(eventData, codec, &req, releaseConn))
             return;
-        auto codecType = codec.GetCodecType();
-        Common::Defer defer([&req, &resp, codecType, this]() {
-            release(req, resp, codecType);
-        });
-        
-        Protocol::Packet pkt;
-        resp = createResp(req, codecType);
-        if (isFastResp(req, codecType)) { // fast-resp模式先回包，再做业务处理
-            setFastRespContext(req, resp, timeStat);
-            codec.Encode(resp, pkt);
-            EpollCtl::ModToWriteEvent(eventData->epoll_fd_, eventData->fd_, eventData); // 监听可写事件
-            if (not writeRespMessage(eventData, pkt, releaseConn)) {
+        // 连接上的请求按顺序处理，应答也按请求的顺序写回。处理完一个请求之后，先解析缓冲区中剩余的数据，
+        // 再非阻塞地读取内核中已经到达的数据，客户端pipeline发送的多个请求在同一个协程中连续处理，
+        // 不需要每个请求都重新激活监听和创建协程。每次最多从socket连续读取MAX_PIPELINE_READS个请求，避免饿死其他连接。
+        // 已经读取到缓冲区中的请求的应答先累积在pending中，缓冲区中的请求都处理完或者累积的应答足够多时，再一次writev写回
+        for (int count = 1; req != nullptr; count++) {
+            if (not handleRequest(eventData, codec, req, pending, releaseConn))
                 return;
-            }
-        }
-        // 每个从协程都只能有一个IO事件唤醒点，在handler可能存在其他IO的唤醒点（调用其他rpc时），
-        // 所以这里暂时清空对客户端IO事件的监听。
-        EpollCtl::ClearEvent(eventData->epoll_fd_, eventData->fd_, false);
-        handler(req, resp, codecType, timeStat); // 业务处理，由具体的业务实现
-        if (isReqResp(req, codecType)) { // req-resp模式需要在handler之后再回包
-            codec.Encode(resp, pkt);
-            EpollCtl::AddWriteEvent(eventData->epoll_fd_, eventData->fd_, eventData); // 监听可写事件
-            if (not writeRespMessage(eventData, pkt, releaseConn)){
+            if (pending.Length() >= MAX_PENDING_RESP_LEN && not writeRespMessage(eventData, pending, releaseConn))
+                return;
+            req = nullptr;
+            if (not nextReqMessage(eventData, codec, &req, count < MAX_PIPELINE_READS, pending, releaseConn))
                 return;
-            }
-            // req-resp模式是从可写事件切换成可读事件的监听
-            EpollCtl::ModToReadEvent(eventData->epoll_fd_, eventData->fd_, eventData);
-        }
-        else { // oneway和fast-resp模式是重启监听可读事件
-            EpollCtl::AddReadEvent(eventData->epoll_fd_, eventData->fd_, eventData);
         }
+        if (not writeRespMessage(eventData, pending, releaseConn))
+            return;
+        // 重新激活可读事件的监听，等待连接上的下一个请求，每次激活只需要这一次epoll_ctl调用
+        EpollCtl::SetEvent(eventData, EPOLLIN | EPOLLONESHOT);
         // 请求处理完，关联协程id设置无效的id，连接上后续请求才能再创建新的协程来处理
         eventData->cid_ = MyCoroutine::INVALID_ROUTINE_ID;
     }
     virtual void MySvrHandler(Protocol::MySvrMessage &req, Protocol::MySvrMessage &resp) = 0;
 
+    // 过载时没有协程可用，在subReactor线程中同步地非阻塞读取请求，回复过载的错误：MySvr协议回复OVERLOADED状态码，
+    // HTTP协议回复503。连接上已经到达的请求都会被拒绝，不完整的请求保留在连接的编解码器中。
+    // 应答累积之后一次非阻塞地写回，socket缓冲区满了写不完的部分留在连接的pending_中，不关闭连接。
+    // 对端关闭连接、解码失败或者写失败时返回false，由调用方关闭连接
+    bool RejectOverloaded(EventData *eventData) {
+        ConnState &conn = *getConn(eventData);
+        Protocol::MixedCodec &codec = conn.codec_;
+        for (int count = 0; ; ) {
+            if (not codec.Decode(0))
+                return false;
+            void *req = codec.GetMessage();
+            if (req) {
+                rejectRequest(codec, req, conn.pending_);
+                continue;
+            }
+            if (count++ >= MAX_PIPELINE_READS) // 缓冲区中的请求都已经拒绝，剩余的数据等下次可读事件再处理
+                return flushPending(eventData, conn.pending_);
+            ssize_t ret = SYSTEM.read(eventData->fd_, codec.Data(), codec.Len());
+            if (ret < 0 && (EAGAIN == errno || EWOULDBLOCK == errno))
+                return flushPending(eventData, conn.pending_);
+            if (ret <= 0 || not codec.Decode(ret))
+                return false;
+        }
+    }
+    // 连接上是否还有没有写完的应答，有则需要同时监听可写事件
+    static bool HasPendingResp(EventData *eventData) {
+        return eventData->conn_ != nullptr && not((ConnState *)eventData->conn_)->pending_.Empty();
+    }
+    static void DeleteConn(EventData *eventData) {
+        delete (ConnState *)eventData->conn_;
+        eventData->conn_ = nullptr;
+    }
+
 private:
     // 该函数用于从指定的文件描述符中读取请求消息，解码后将其存储在 req 中， 如果出现错误则释放连接并返回 false。
     bool readReqMessage(EventData *eventData, Protocol::MixedCodec &codec, void **req,
                         std::function<void(const std::string &error)> releaseConn) {
         RpcTimeOut.Set(TimeOut()); // 这里需要重新设置，因为在handler中可能存在rpc调用会覆盖超时配置
         while (true) {
-            ssize_t ret = Core::CoRead(eventData->fd_, codec.Data(), codec.Len(), false);
+            ssize_t ret = Core::CoRead(eventData->fd_, codec.Data(), codec.Len(), eventData);
             if (0 == ret) {
                 releaseConn("peer close connection");
                 return false;
@@ -113,20 +147,129 @@ private:
                 return true;
         }
     }
-    bool writeRespMessage(EventData *eventData, Protocol::Packet &pkt,
+    // 处理完一个请求之后获取连接上的下一个请求：先解析缓冲区中剩余的数据，允许读取时再非阻塞地读取socket，
+    // 读到了不完整的请求说明客户端正在发送，等待剩余的数据。没有下一个请求时*req为nullptr
+    bool nextReqMessage(EventData *eventData, Protocol::MixedCodec &codec, void **req, bool allowRead,
+                        Protocol::IOBuf &pending, std::function<void(const std::string &error)> releaseConn) {
+        if (not codec.Decode(0)) {
+            releaseConn("decode failed.");
+            return false;
+        }
+        *req = codec.GetMessage();
+        if (*req || not allowRead)
+            return true;
+        // 缓冲区中的请求都处理完了，先写回累积的应答，客户端收到应答之后才可能发送下一个请求
+        if (not writeRespMessage(eventData, pending, releaseConn))
+            return false;
+        ssize_t ret = SYSTEM.read(eventData->fd_, codec.Data(), codec.Len());
+        if (ret < 0 && (EAGAIN == errno || EWOULDBLOCK == errno))
+            return true; // 内核中还没有下一个请求的数据
+        if (0 == ret) {
+            releaseConn("peer close connection");
+            return false;
+        }
+        if (ret < 0) {
+            releaseConn(Common::Strings::StrFormat((char *)"read failed. errMsg[%s]", strerror(errno)));
+            return false;
+        }
+        if (not codec.Decode(ret)) {
+            releaseConn("decode failed.");
+            return false;
+        }
+        *req = codec.GetMessage();
+        if (*req)
+            return true;
+        return readReqMessage(eventData, codec, req, releaseConn);
+    }
+    // 处理一个请求，应答追加到pending中，连接被释放时返回false
+    bool handleRequest(EventData *eventData, Protocol::MixedCodec &codec, void *req, Protocol::IOBuf &pending,
+                       std::function<void(const std::string &error)> releaseConn) {
+        Common::TimeStat timeStat;
+        void *resp = nullptr;  // 响应对象的指针
+        auto codecType = codec.GetCodecType();
+        Common::Defer defer([&req, &resp, codecType, this]() {
+            release(req, resp, codecType);
+        });
+        
+        Protocol::Packet pkt;
+        resp = createResp(req, codecType);
+        if (isFastResp(req, codecType)) { // fast-resp模式先回包，再做业务处理
+            setFastRespContext(req, resp, timeStat);
+            codec.Encode(resp, pkt);
+            pkt.ShareTo(pending);
+            if (not writeRespMessage(eventData, pending, releaseConn)) { // 先回包的应答需要立即写回
+                return false;
+            }
+        }
+        // 每个从协程都只能有一个IO事件唤醒点，在handler可能存在其他IO的唤醒点（调用其他rpc时）。
+        // 客户端连接以ONESHOT方式注册，事件触发之后内核已经禁用了监听，所以这里不需要从epoll中移除连接。
+        handler(req, resp, codecType, timeStat); // 业务处理，由具体的业务实现
+        if (isReqResp(req, codecType)) { // req-resp模式需要在handler之后再回包
+            codec.Encode(resp, pkt);
+            pkt.ShareTo(pending); // 只增加引用计数，不拷贝应答
+        }
+        return true;
+    }
+    // 回复一个过载的错误，应答追加到pending中，oneway请求不需要回包
+    void rejectRequest(Protocol::MixedCodec &codec, void *req, Protocol::IOBuf &pending) {
+        void *resp = nullptr;
+        auto codecType = codec.GetCodecType();
+        Common::Defer defer([&req, &resp, codecType, this]() {
+            release(req, resp, codecType);
+        });
+        if (Protocol::HTTP == codecType) {
+            Protocol::HttpMessage *httpResp = new Protocol::HttpMessage;
+            resp = httpResp;
+            httpResp->SetStatusCode(Protocol::SERVICE_UNAVAILABLE);
+            httpResp->SetHeader("status_code", std::to_string(OVERLOADED));
+            httpResp->SetBody(R"({"message":")" + STATUS_CODE.Message(OVERLOADED) + R"("})");
+        } else {
+            Protocol::MySvrMessage *mySvrReq = (Protocol::MySvrMessage *)req;
+            if (mySvrReq->IsOneway())
+                return;
+            Protocol::MySvrMessage *mySvrResp = new Protocol::MySvrMessage;
+            resp = mySvrResp;
+            mySvrResp->head_.flag_ = mySvrReq->head_.flag_;
+            mySvrResp->context_.CopyFrom(mySvrReq->context_);
+            mySvrResp->context_.set_status_code(OVERLOADED);
+        }
+        Protocol::Packet pkt;
+        codec.Encode(resp, pkt);
+        pkt.ShareTo(pending);
+    }
+    // 在主协程中非阻塞地写回pending中的应答，socket缓冲区满了返回true，剩余的数据保留在pending中
+    static bool flushPending(EventData *eventData, Protocol::IOBuf &pending) {
+        struct iovec iov[MAX_WRITE_IOVECS];
+        while (not pending.Empty()) {
+            int iovcnt = pending.Iovecs(iov, MAX_WRITE_IOVECS);
+            ssize_t ret = SYSTEM.writev(eventData->fd_, iov, iovcnt);
+            if (ret < 0 && EINTR == errno)
+                continue;
+            if (ret < 0)
+                return EAGAIN == errno || EWOULDBLOCK == errno;
+            pending.Consume(ret);
+        }
+        return true;
+    }
+    static ConnState *getConn(EventData *eventData) {
+        if (nullptr == eventData->conn_)
+            eventData->conn_ = new ConnState(CONN_READ_BUFFER_LEN);
+        return (ConnState *)eventData->conn_;
+    }
+    // 把pending中累积的应答写回，多个应答的片段一次writev写入
+    bool writeRespMessage(EventData *eventData, Protocol::IOBuf &pending,
                             std::function<void(const std::string &error)> releaseConn) {
         RpcTimeOut.Set(TimeOut()); // 这里需要重新设置，因为在handler中可能存在rpc调用会覆盖超时配置
-        ssize_t sendLen = 0;
-        uint8_t *buf = pkt.DataRaw();
-        ssize_t needSendLen = pkt.UseLen();
-        while (sendLen != needSendLen) { // 写操作
-            ssize_t ret = Core::CoWrite(eventData->fd_, buf + sendLen, needSendLen - sendLen, false);
+        struct iovec iov[MAX_WRITE_IOVECS];
+        while (not pending.Empty()) { // 写操作
+            int iovcnt = pending.Iovecs(iov, MAX_WRITE_IOVECS);
+            ssize_t ret = Core::CoWritev(eventData->fd_, iov, iovcnt, eventData);
             if (ret < 0) {
                 releaseConn(Common::Strings::StrFormat(
                     (char *)"write failed. errMsg[%s]", strerror(errno)));
                 return false;
             }
-            sendLen += ret;
+            pending.Consume(ret);
         }
         return true;
     }
@@ -141,6 +284,7 @@ private:
                 return;
             Protocol::MySvrMessage mySvrReq, mySvrResp;
             Protocol::MixedCodec::Http2MySvr(*httpReq, mySvrReq);
+            MyCoroutine::CoroutineSetStackTag(SCHEDULE, mySvrReq.context_.rpc_name()); // 按rpc统计栈使用量
 
             DistributedTrace::InitTraceInfo(mySvrReq.context_);
             mySvrResp.head_.flag_ = mySvrReq.head_.flag_;
@@ -159,6 +303,12 @@ private:
             if (not mySvrRequestValidCheck(mySvrReq, mySvrResp)) {
                 return;
             }
+            if (Deadline::IsExpired(mySvrReq->context_.deadline_ms())) { // 调用方已经放弃等待，直接拒绝
+                Deadline::AddShed();
+                mySvrResp->context_.set_status_code(DEADLINE_EXCEEDED);
+                return;
+            }
+            MyCoroutine::CoroutineSetStackTag(SCHEDULE, mySvrReq->context_.rpc_name()); // 按rpc统计栈使用量
             DistributedTrace::InitTraceInfo(mySvrReq->context_);
             mySvrResp->head_.flag_ = mySvrReq->head_.flag_;
             MySvrHandler(*mySvrReq, *mySvrResp);
@@ -38,6 +38,7 @@ public:
         Protocol::MySvrCodec codec;
         mySvrMessage.context_.set_parent_stack_id(ReqCtx.Get().current_stack_id());
         mySvrMessage.context_.set_stack_alloc_id(ReqCtx.Get().stack_alloc_id());
+        mySvrMessage.context_.set_deadline_ms(Deadline::Get()); // 传递上游的截止时间
         if (not PushRetry(serviceName, codec, &mySvrMessage, sockErrorDeal))
             return;
     }
@@ -83,7 +84,12 @@ public:
         Protocol::MySvrMessage *respMessage = nullptr;
         req.context_.set_parent_stack_id(ReqCtx.Get().current_stack_id());
         req.context_.set_stack_alloc_id(ReqCtx.Get().stack_alloc_id());
-        if (not CallRetry(serviceName, codec, &req, (void **)&respMessage, nullptr, errorDeal))
+        // 下游的截止时间取上游截止时间和本次调用超时时间的较小值，超过之后调用方不会再等待应答
+        auto setDeadline = [&req](Conn *conn, std::string &error) {
+            req.context_.set_deadline_ms(Deadline::ForCall(conn->time_out_));
+            return true;
+        };
+        if (not CallRetry(serviceName, codec, &req, (void **)&respMessage, setDeadline, errorDeal))
             return;
         // 将响应消息内容复制到 resp 对象中，这样就完成了请求和响应的交互。
         resp.CopyFrom(*respMessage);
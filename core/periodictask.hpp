@@ -0,0 +1,120 @@
+#pragma once
+// 周期任务：在subReactor线程中按固定的间隔创建协程来执行后台任务，比如刷新本地缓存、上报统计、预热连接池，
+// 不需要额外的线程。上一次执行还没有结束时跳过本次执行；间隔上可以增加随机抖动，避免多个subReactor或者多个进程
+// 在同一时刻执行。任务在协程中执行，可以调用CoSleep、rpc调用等会让出cpu的函数。
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "../common/log.hpp"
+#include "../common/singleton.hpp"
+#include "coroutine.h"
+#include "timer.hpp"
+
+#define PERIODIC_TASK Common::Singleton<Core::PeriodicTask>::Instance()
+
+namespace Core {
+typedef struct PeriodicTaskConf {
+    std::string name_;         // 任务名，用于打印日志
+    int64_t interval_ms_;      // 执行的间隔
+    int64_t jitter_ms_;        // 每次间隔上增加[0, jitter_ms_]的随机抖动
+    MyCoroutine::Entry entry_; // 任务的入口函数，在新创建的协程中执行
+    void *arg_;                // 入口函数的参数，所有subReactor共用
+    bool all_sub_reactor_;     // 是否在每个subReactor上都执行，否则只在第0个subReactor上执行
+} PeriodicTaskConf;
+
+class PeriodicTask {
+public:
+    // 注册周期任务，需要在EventDispatch::Run之前调用
+    void Add(const std::string &name, int64_t intervalMs, MyCoroutine::Entry entry, void *arg, int64_t jitterMs = 0,
+             bool allSubReactor = false) {
+        assert(intervalMs > 0 && jitterMs >= 0);
+        std::lock_guard<std::mutex> guard(mutex_);
+        confs_.push_back(PeriodicTaskConf{name, intervalMs, jitterMs, entry, arg, allSubReactor});
+    }
+    // 清除注册的周期任务，已经启动的周期任务不受影响
+    void Clear() {
+        std::lock_guard<std::mutex> guard(mutex_);
+        confs_.clear();
+    }
+    // 在当前线程中启动周期任务的定时器，由subReactor线程在初始化调度器之后调用
+    void Start(int subReactorIndex) {
+        std::vector<PeriodicTaskConf> confs;
+        {
+            std::lock_guard<std::mutex> guard(mutex_);
+            confs = confs_;
+        }
+        for (auto &conf : confs) {
+            if (not conf.all_sub_reactor_ && subReactorIndex != 0)
+                continue;
+            TaskState *state = new TaskState;
+            state->conf_ = conf;
+            state->seed_ = time(nullptr) + subReactorIndex * 7919 + states().size();
+            schedule(state);
+            states().push_back(state);
+        }
+    }
+    // 停止当前线程中的所有周期任务，正在执行的任务会执行完
+    void Stop() {
+        for (TaskState *state : states()) {
+            TIMER.Cancel(state->timer_id_);
+            if (state->is_running_)
+                state->is_stopped_ = true; // 由执行任务的协程在结束时释放
+            else
+                delete state;
+        }
+        states().clear();
+    }
+
+private:
+    typedef struct TaskState {
+        PeriodicTaskConf conf_;
+        uint64_t timer_id_{0};   // 下一次执行的定时器id
+        bool is_running_{false}; // 上一次执行是否还没有结束
+        bool is_stopped_{false}; // 是否已经停止
+        unsigned int seed_{0};   // 随机抖动的种子
+    } TaskState;
+    // 每个subReactor线程各自的任务状态
+    static std::vector<TaskState *> &states() {
+        static thread_local std::vector<TaskState *> states;
+        return states;
+    }
+    static void schedule(TaskState *state) {
+        int64_t delayMs = state->conf_.interval_ms_;
+        if (state->conf_.jitter_ms_ > 0)
+            delayMs += rand_r(&state->seed_) % (state->conf_.jitter_ms_ + 1);
+        state->timer_id_ = TIMER.Register(onTimer, state, delayMs);
+    }
+    static void onTimer(void *data) {
+        TaskState *state = (TaskState *)data;
+        schedule(state); // 先注册下一次执行的定时器，执行的周期不受本次执行耗时的影响
+        if (state->is_running_) { // 上一次执行还没有结束，跳过本次执行
+            DEBUG("periodic task[%s] is still running, skip", state->conf_.name_.c_str());
+            return;
+        }
+        if (not MyCoroutine::CoroutineCanCreate(SCHEDULE)) {
+            WARN("periodic task[%s] skip, MyCoroutine is full", state->conf_.name_.c_str());
+            return;
+        }
+        state->is_running_ = true;
+        int cid = MyCoroutine::CoroutineCreate(SCHEDULE, taskEntry, state);
+        MyCoroutine::CoroutineResumeById(SCHEDULE, cid);
+        MyCoroutine::CoroutineResumeBatchFinish(SCHEDULE);
+    }
+    static void taskEntry(void *arg) {
+        TaskState *state = (TaskState *)arg;
+        state->conf_.entry_(state->conf_.arg_);
+        state->is_running_ = false;
+        if (state->is_stopped_)
+            delete state;
+    }
+
+private:
+    std::mutex mutex_;
+    std::vector<PeriodicTaskConf> confs_;
+};
+} // namespace Core
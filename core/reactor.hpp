@@ -9,11 +9,32 @@ public:
     void Run(Common::Config *config) {
         int64_t port;
         std::string listenIf;
-        int64_t coroutineCount;
+        int64_t subReactorCount;
+        int64_t workStealing;
+        int64_t reusePortAccept;
+        int64_t ioUring;
+        CoroutinePoolConf poolConf;
         config->GetIntValue("MyRPC", "port", port, 0);
         config->GetStrValue("MyRPC", "listen_if", listenIf, "eth0");
-        config->GetIntValue("MyRPC", "coroutine_count", coroutineCount, 1024);
-        event_dispatch_.Run(listenIf, port, coroutineCount); // 陷入事件监听和分发的死循环
+        // 每个worker进程中subReactor线程的个数，每个subReactor线程独立调度协程，可以使用多个cpu核
+        config->GetIntValue("MyRPC", "sub_reactor_count", subReactorCount, 1);
+        // 1表示开启subReactor之间的工作窃取，空闲的subReactor可以处理繁忙的subReactor上排队的新请求
+        config->GetIntValue("MyRPC", "work_stealing", workStealing, 0);
+        // 1表示每个subReactor用自己的SO_REUSEPORT监听socket直接接受连接，新连接不再经过mainReactor迁移
+        config->GetIntValue("MyRPC", "reuse_port_accept", reusePortAccept, 0);
+        // 1表示协程的读写、连接和接受连接使用io_uring后端，内核不支持或者开启了共享栈时回退到epoll
+        config->GetIntValue("MyRPC", "io_uring", ioUring, 0);
+        config->GetIntValue("MyRPC", "coroutine_count", poolConf.coroutine_count_, 1024);
+        config->GetIntValue("MyRPC", "stack_size", poolConf.stack_size_, 64 * 1024);
+        // 大于0时协程池使用共享栈模式，多个协程共用一个运行栈，切出时把实际使用的栈内容拷贝到私有缓冲区
+        config->GetIntValue("MyRPC", "shared_stack_count", poolConf.shared_stack_count_, 0);
+        // 1表示统计协程栈的使用量，2表示在统计的基础上按p99.9自动调整新协程的栈大小
+        config->GetIntValue("MyRPC", "stack_profile", poolConf.stack_profile_, 0);
+        // 协程池满了之后，新请求最多排队的连接数，以及请求排队的时间上限（毫秒），超过则回复过载的错误
+        config->GetIntValue("MyRPC", "admission_queue_size", poolConf.admission_queue_size_, 1024);
+        config->GetIntValue("MyRPC", "admission_queue_time_ms", poolConf.admission_queue_time_ms_, 100);
+        event_dispatch_.Run(listenIf, port, subReactorCount, poolConf, workStealing != 0,
+                            reusePortAccept != 0, ioUring != 0); // 陷入事件监听和分发的死循环
     }
 
     void RegHandler(MyHandler *handler) { 
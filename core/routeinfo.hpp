@@ -1,5 +1,6 @@
 #pragma once
 #include <map>
+#include <mutex>
 #include <string>
 #include <vector>
 #include "../common/config.hpp"
@@ -29,6 +30,7 @@ public:
     
     bool GetRoute(std::string serviceName, Route &route, TimeOut &timeOut, int index = 0) {
         Common::Strings::ToLower(serviceName);
+        std::lock_guard<std::mutex> locker(mutex_); // 路由缓存由所有subReactor线程共享
         int64_t currentTime = time(nullptr);   // 获取当前时间并检查更新
         auto update_time_iter = last_update_times_.find(serviceName);
         if (update_time_iter == last_update_times_.end() || 
@@ -89,5 +91,6 @@ private:
     std::map<std::string, TimeOut> time_outs_;              // 超时配置
     std::map<std::string, int64_t> last_update_times_;      // 最后更新时间，单位秒
     std::map<std::string, std::vector<Route>> route_infos_; // 各个模块的路由信息
+    std::mutex mutex_;
 };
 } // namespace Core
\ No newline at end of file
@@ -1,98 +1,304 @@
 #pragma once
 #include <assert.h>
 #include <stdint.h>
-#include <sys/time.h>
-#include <time.h>
-#include <queue>
-#include <unordered_set>
+#include <algorithm>
+#include <vector>
+#include "../common/clock.hpp"
 #include "../common/singleton.hpp"
 
-#define TIMER Common::Singleton<Core::Timer>::Instance()
+#define TIMER Common::ThreadLocalSingleton<Core::Timer>::Instance()
 
 namespace Core {
 typedef void (*TimerCallBack)(void *data);
 typedef struct TimerData {
-    friend bool operator<(const TimerData &left, const TimerData &right){
-        return left.abs_time_ms_ > right.abs_time_ms_;
-    }
     uint64_t id_;
     void *data_{nullptr};
     int64_t abs_time_ms_{0};
     TimerCallBack call_back_{nullptr};
 } TimerData;
 
+// 分层时间轮实现的定时器，精度为1毫秒。第0层256个槽，每槽1毫秒；之后4层每层64个槽，每层一个槽覆盖下一层一整圈。
+// 定时器节点放在节点池中，通过节点下标串成侵入式的双向链表，注册和取消都是O(1)，取消时直接从槽中摘除，不会残留失效的数据。
+// Register返回的id中低32位是节点下标，高位是节点的版本号，节点复用时版本号加1，用于识别已经失效的id。
 class Timer {
 public:
+    Timer() {
+        nodes_.resize(NODE_BASE);
+        for (int32_t i = 0; i < NODE_BASE; i++) // 每个槽和到期链表都有一个哨兵节点，链表为空时指向自己
+            nodes_[i].prev_ = nodes_[i].next_ = i;
+        for (int32_t i = 0; i < HIGH_SLOTS; i++)
+            high_min_expire_[i] = INT64_MAX;
+        current_tick_ = GetCurrentTimeMs();
+    }
     uint64_t Register(TimerCallBack callBack, void *data, int64_t timeOutMs) {
-        alloc_id_++;
-        TimerData timerData;
-        timerData.id_ = alloc_id_;
-        timerData.data_ = data;
-        timerData.abs_time_ms_ = GetCurrentTimeMs() + timeOutMs;
-        timerData.call_back_ = callBack;
-        timers_.push(timerData);
-        timer_ids_.insert(timerData.id_);
-        return alloc_id_;
+        int64_t now = GetCurrentTimeMs();
+        if (0 == live_count_ && current_tick_ < now)
+            current_tick_ = now; // 没有定时器时时间轮不需要转动，直接对齐到当前时间
+        int32_t index = allocNode();
+        TimerNode &node = nodes_[index];
+        node.data_ = data;
+        node.call_back_ = callBack;
+        node.expire_ = now + timeOutMs;
+        addNode(index);
+        live_count_++;
+        return ((uint64_t)node.version_ << 32) | (uint64_t)(index - NODE_BASE + 1);
     }
     void Cancel(uint64_t id) {
-        assert(timer_ids_.find(id) != timer_ids_.end()); // 取消的定时器，必须是存在的
-        cancel_ids_.insert(id);                          // 这里只是做一下记录
+        int32_t index = (int32_t)(id & 0xffffffff) + NODE_BASE - 1;
+        assert(index >= NODE_BASE && index < (int32_t)nodes_.size());
+        assert(nodes_[index].in_use_ && nodes_[index].version_ == (uint32_t)(id >> 32)); // 取消的定时器，必须是存在的
+        unlinkNode(index);
+        freeNode(index);
+        live_count_--;
     }
 
-    //获取下一个即将超时的定时器
+    // 获取最近一个定时器的超时时间点，时间轮中还有定时器时返回true
     bool GetLastTimer(TimerData &timerData) {
-        while (not timers_.empty()) {
-            timerData = timers_.top();
-            timers_.pop();
-            if (cancel_ids_.find(timerData.id_) != cancel_ids_.end())
-            { // 被取消的定时器不执行，直接删除
-                cancel_ids_.erase(timerData.id_);
-                timer_ids_.erase(timerData.id_);
-                continue;
-            }
-            return true;
-        }
-        return false;
+        if (0 == live_count_)
+            return false;
+        timerData.id_ = 0;
+        timerData.abs_time_ms_ = nearestExpire();
+        return true;
     }
 
-    //计算一个定时器超时还剩余的时间
+    //计算一个定时器超时还剩余的时间，结果用作epoll_wait的超时参数，不超过int的范围，提前醒来时Run不会执行未超时的定时器
     int64_t TimeOutMs(TimerData &timerData) {
         // 多1ms，确保后续的定时器必定能超时
-        int64_t temp = timerData.abs_time_ms_ + 1 - GetCurrentTimeMs(); 
+        int64_t temp = timerData.abs_time_ms_ + 1 - Common::Clock::RefreshMs();
         if (temp > 0)
-            return temp;
+            return std::min(temp, (int64_t)INT32_MAX);
         return 0;
     }
+    // 转动时间轮到当前时间，按槽批量执行所有已经超时的定时器
     void Run(TimerData &timerData) {
-        if (not isExpire(timerData)) { // 没有过期则重新塞入队列中去重新排队
-            timers_.push(timerData);
-            return;
-        }
-        
-        int64_t timerId = timerData.id_;
-        assert(timer_ids_.find(timerId) != timer_ids_.end()); // 要运行的定时器，必须是存在的
-        timer_ids_.erase(timerId);
-        if (cancel_ids_.find(timerId) != cancel_ids_.end()) { // 被取消的定时器不执行，直接删除
-            cancel_ids_.erase(timerId);
-            return;
+        int64_t now = Common::Clock::RefreshMs();
+        while (current_tick_ <= now && live_count_ > 0) {
+            int32_t slot = (int32_t)(current_tick_ & LEVEL0_MASK);
+            if (0 == slot)
+                cascade();
+            int64_t tick = nextTick();
+            if (tick != current_tick_) { // 中间的槽都是空的，直接跳过
+                current_tick_ = tick < now + 1 ? tick : now + 1;
+                continue;
+            }
+            spliceToExpired(slot);
+            current_tick_++; // 先转动时间轮，回调中注册的定时器不会落到正在执行的槽中
+            while (nodes_[EXPIRED].next_ != EXPIRED) {
+                int32_t index = nodes_[EXPIRED].next_;
+                TimerCallBack callBack = nodes_[index].call_back_;
+                void *data = nodes_[index].data_;
+                unlinkNode(index);
+                freeNode(index);
+                live_count_--;
+                callBack(data); // 回调中可能注册或者取消定时器，节点池可能扩容，之后不能再使用节点的引用
+            }
         }
-        timerData.call_back_(timerData.data_);
-    }
-    int64_t GetCurrentTimeMs(){
-        struct timeval current;
-        gettimeofday(&current, NULL);
-        return current.tv_sec * 1000 + current.tv_usec / 1000;
+        if (0 == live_count_ && current_tick_ <= now)
+            current_tick_ = now + 1;
     }
+    // 使用单调时钟，系统时间被调整时定时器不受影响。事件循环中使用每轮epoll_wait之后缓存的时间
+    int64_t GetCurrentTimeMs() { return Common::Clock::NowMs(); }
+    size_t Size() const { return live_count_; }
 
 private:
-    bool isExpire(TimerData &timerData) { 
-        return GetCurrentTimeMs() >= timerData.abs_time_ms_;
+    typedef struct TimerNode {
+        int32_t prev_{-1};
+        int32_t next_{-1};
+        int32_t bucket_{-1};       // 所在链表的哨兵节点下标
+        uint32_t version_{0};      // 节点每次复用加1
+        bool in_use_{false};
+        int64_t expire_{0};        // 超时的绝对时间，单位毫秒
+        void *data_{nullptr};
+        TimerCallBack call_back_{nullptr};
+    } TimerNode;
+
+    enum {
+        LEVEL0_BITS = 8,
+        LEVELN_BITS = 6,
+        LEVEL0_SIZE = 1 << LEVEL0_BITS,
+        LEVELN_SIZE = 1 << LEVELN_BITS,
+        LEVEL0_MASK = LEVEL0_SIZE - 1,
+        LEVELN_MASK = LEVELN_SIZE - 1,
+        LEVEL_COUNT = 5,                                    // 总共覆盖2^32毫秒，大约49天
+        HIGH_SLOTS = (LEVEL_COUNT - 1) * LEVELN_SIZE,       // 第1层及以上的槽数
+        EXPIRED = LEVEL0_SIZE + HIGH_SLOTS,                 // 到期链表的哨兵节点
+        NODE_BASE = EXPIRED + 1,                            // 定时器节点的起始下标
+    };
+    static constexpr int64_t WHEEL_RANGE = (int64_t)1 << (LEVEL0_BITS + (LEVEL_COUNT - 1) * LEVELN_BITS);
+
+    int32_t allocNode() {
+        int32_t index;
+        if (free_list_.empty()) {
+            index = (int32_t)nodes_.size();
+            nodes_.push_back(TimerNode());
+        } else {
+            index = free_list_.back();
+            free_list_.pop_back();
+        }
+        nodes_[index].in_use_ = true;
+        return index;
+    }
+    void freeNode(int32_t index) {
+        TimerNode &node = nodes_[index];
+        node.in_use_ = false;
+        node.version_ = (node.version_ + 1) & 0x7fffffff; // id保持为正数，可以存放在int64_t中
+        free_list_.push_back(index);
+    }
+    // 根据超时时间和当前时间的距离，把节点放到对应层的槽中
+    void addNode(int32_t index) {
+        TimerNode &node = nodes_[index];
+        if (node.expire_ < current_tick_)
+            node.expire_ = current_tick_;
+        int64_t delta = node.expire_ - current_tick_;
+        int32_t bucket;
+        if (delta < LEVEL0_SIZE) {
+            bucket = (int32_t)(node.expire_ & LEVEL0_MASK);
+            level0_bitmap_[bucket >> 6] |= (uint64_t)1 << (bucket & 63);
+        } else {
+            int level = 1;
+            while (level < LEVEL_COUNT - 1 && delta >= ((int64_t)1 << (LEVEL0_BITS + level * LEVELN_BITS)))
+                level++;
+            // 超过时间轮的范围时放在最远的槽，超时时间保持不变，cascade到这个槽时重新计算位置，还超出范围就再放到最远的槽
+            int64_t slotExpire = std::min(node.expire_, current_tick_ + WHEEL_RANGE - 1);
+            int shift = LEVEL0_BITS + (level - 1) * LEVELN_BITS;
+            int32_t slot = (int32_t)((slotExpire >> shift) & LEVELN_MASK);
+            bucket = LEVEL0_SIZE + (level - 1) * LEVELN_SIZE + slot;
+            high_bitmap_[level - 1] |= (uint64_t)1 << slot;
+            if (node.expire_ < high_min_expire_[bucket - LEVEL0_SIZE])
+                high_min_expire_[bucket - LEVEL0_SIZE] = node.expire_;
+            high_count_++;
+        }
+        linkNode(bucket, index);
+    }
+    void linkNode(int32_t bucket, int32_t index) {
+        TimerNode &node = nodes_[index];
+        node.bucket_ = bucket;
+        node.prev_ = nodes_[bucket].prev_;
+        node.next_ = bucket;
+        nodes_[node.prev_].next_ = index;
+        nodes_[bucket].prev_ = index;
+    }
+    void unlinkNode(int32_t index) {
+        TimerNode &node = nodes_[index];
+        nodes_[node.prev_].next_ = node.next_;
+        nodes_[node.next_].prev_ = node.prev_;
+        int32_t bucket = node.bucket_;
+        if (bucket < LEVEL0_SIZE) {
+            if (nodes_[bucket].next_ == bucket)
+                level0_bitmap_[bucket >> 6] &= ~((uint64_t)1 << (bucket & 63));
+        } else if (bucket != EXPIRED) {
+            high_count_--;
+            int32_t high = bucket - LEVEL0_SIZE;
+            if (nodes_[bucket].next_ == bucket) {
+                high_bitmap_[high / LEVELN_SIZE] &= ~((uint64_t)1 << (high & LEVELN_MASK));
+                high_min_expire_[high] = INT64_MAX;
+                high_min_dirty_[high] = false;
+            } else if (node.expire_ == high_min_expire_[high]) {
+                high_min_dirty_[high] = true; // 最小值被摘除，下次需要时再重新计算
+            }
+        }
+        node.prev_ = node.next_ = node.bucket_ = -1;
+    }
+    // 把第0层一个槽中的所有节点整体移到到期链表中
+    void spliceToExpired(int32_t slot) {
+        while (nodes_[slot].next_ != slot) {
+            int32_t index = nodes_[slot].next_;
+            unlinkNode(index);
+            linkNode(EXPIRED, index);
+        }
+    }
+    // 第0层转完一圈时，把上层对应槽中的定时器重新分配到下层
+    void cascade() {
+        for (int level = 1; level < LEVEL_COUNT; level++) {
+            int shift = LEVEL0_BITS + (level - 1) * LEVELN_BITS;
+            int32_t slot = (int32_t)((current_tick_ >> shift) & LEVELN_MASK);
+            int32_t bucket = LEVEL0_SIZE + (level - 1) * LEVELN_SIZE + slot;
+            while (nodes_[bucket].next_ != bucket) {
+                int32_t index = nodes_[bucket].next_;
+                unlinkNode(index);
+                addNode(index);
+            }
+            if (slot != 0) // 当前层没有转完一圈，不需要继续处理更上一层
+                break;
+        }
+    }
+    // 下一个需要处理的时间点：第0层中下一个非空的槽；上层还有定时器时，最晚是第0层转完一圈需要cascade的时间点
+    int64_t nextTick() {
+        int64_t base = current_tick_ & ~(int64_t)LEVEL0_MASK;
+        int32_t slot = (int32_t)(current_tick_ & LEVEL0_MASK);
+        int32_t found = findLevel0(slot, LEVEL0_SIZE);
+        if (found >= 0)
+            return base + found;
+        if (high_count_ > 0)
+            return base + LEVEL0_SIZE;
+        found = findLevel0(0, slot);
+        if (found >= 0)
+            return base + LEVEL0_SIZE + found; // 第0层绕回来的槽
+        return current_tick_;
+    }
+    // 最近一个定时器的超时时间：第0层中下一个非空的槽，和上层每一层中下一个非空的槽的最小超时时间，取最小值。
+    // 上层每一层的槽按顺序覆盖连续的时间范围，和当前位置相同的槽中只会有下一圈的定时器，所以按顺序第一个非空的槽包含该层最早的定时器。
+    int64_t nearestExpire() {
+        int64_t base = current_tick_ & ~(int64_t)LEVEL0_MASK;
+        int32_t slot = (int32_t)(current_tick_ & LEVEL0_MASK);
+        int64_t nearest = INT64_MAX;
+        int32_t found = findLevel0(slot, LEVEL0_SIZE);
+        if (found >= 0) {
+            nearest = base + found;
+        } else {
+            found = findLevel0(0, slot);
+            if (found >= 0)
+                nearest = base + LEVEL0_SIZE + found;
+        }
+        for (int level = 1; level < LEVEL_COUNT && high_count_ > 0; level++) {
+            uint64_t bits = high_bitmap_[level - 1];
+            if (0 == bits)
+                continue;
+            int shift = LEVEL0_BITS + (level - 1) * LEVELN_BITS;
+            int32_t start = (int32_t)(((current_tick_ >> shift) + 1) & LEVELN_MASK);
+            uint64_t rotated = start ? (bits >> start) | (bits << (LEVELN_SIZE - start)) : bits;
+            int32_t high = (level - 1) * LEVELN_SIZE + ((start + __builtin_ctzll(rotated)) & LEVELN_MASK);
+            int64_t expire = highMinExpire(high);
+            if (expire < nearest)
+                nearest = expire;
+        }
+        return nearest == INT64_MAX ? current_tick_ : nearest;
+    }
+    int64_t highMinExpire(int32_t high) {
+        if (high_min_dirty_[high]) {
+            int32_t bucket = LEVEL0_SIZE + high;
+            int64_t minExpire = INT64_MAX;
+            for (int32_t index = nodes_[bucket].next_; index != bucket; index = nodes_[index].next_) {
+                if (nodes_[index].expire_ < minExpire)
+                    minExpire = nodes_[index].expire_;
+            }
+            high_min_expire_[high] = minExpire;
+            high_min_dirty_[high] = false;
+        }
+        return high_min_expire_[high];
+    }
+    int32_t findLevel0(int32_t begin, int32_t end) {
+        for (int32_t word = begin >> 6; word < LEVEL0_SIZE / 64 && (word << 6) < end; word++) {
+            uint64_t bits = level0_bitmap_[word];
+            if ((word << 6) < begin)
+                bits &= ~(uint64_t)0 << (begin & 63);
+            if (0 == bits)
+                continue;
+            int32_t found = (word << 6) + __builtin_ctzll(bits);
+            return found < end ? found : -1;
+        }
+        return -1;
     }
 
 private:
-    uint64_t alloc_id_{0};
-    std::unordered_set<uint64_t> timer_ids_;
-    std::unordered_set<uint64_t> cancel_ids_;
-    std::priority_queue<TimerData> timers_;
+    std::vector<TimerNode> nodes_;    // 节点池，前NODE_BASE个是哨兵节点
+    std::vector<int32_t> free_list_;  // 空闲的节点下标
+    uint64_t level0_bitmap_[LEVEL0_SIZE / 64]{0}; // 第0层非空槽的位图
+    uint64_t high_bitmap_[LEVEL_COUNT - 1]{0};    // 上层每一层非空槽的位图
+    int64_t high_min_expire_[HIGH_SLOTS];         // 上层每个槽中最小的超时时间
+    bool high_min_dirty_[HIGH_SLOTS]{false};      // 最小值对应的定时器被摘除，需要重新计算
+    int64_t current_tick_{0};         // 下一个需要处理的时间点，单位毫秒
+    size_t live_count_{0};            // 时间轮中定时器的个数
+    size_t high_count_{0};            // 第1层及以上的定时器个数
 };
 } // namespace Core
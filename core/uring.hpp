@@ -0,0 +1,167 @@
+#pragma once
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <vector>
+#include "../common/singleton.hpp"
+
+#define URING Common::ThreadLocalSingleton<Core::Uring>::Instance() // 获取当前线程的 Core::Uring 实例
+
+namespace Core {
+// io_uring请求的上下文，SQE的user_data指向它。没有设置callback_时，完成事件填充结果并唤醒cid_关联的协程；
+// 设置了callback_时（例如multishot accept），每个完成事件都调用callback_。
+typedef struct UringRequest {
+    int cid_{-1};          // 等待完成事件的协程id
+    int32_t res_{0};       // 完成事件的结果，小于0时为-errno
+    bool done_{false};     // 完成事件是否已经到来
+    struct __kernel_timespec timeout_; // 链接到请求上的超时时间
+    void (*callback_)(UringRequest *request, int32_t res, uint32_t flags){nullptr};
+    void *arg_{nullptr};   // callback_使用的参数
+} UringRequest;
+
+// 每个subReactor线程一个io_uring实例，不依赖liburing，直接使用io_uring_setup/io_uring_enter系统调用。
+// 协程把请求放入提交队列之后就让出cpu，subReactor在调用epoll_wait之前批量提交，
+// ring的fd注册在subReactor的epoll实例中，有完成事件时epoll_wait返回，再收割完成事件并唤醒协程。
+class Uring {
+public:
+    ~Uring() { Exit(); }
+    bool Init(unsigned entries) {
+        io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        int fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+        if (fd < 0)
+            return false;
+        sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool singleMmap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (singleMmap)
+            sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+        sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                        IORING_OFF_SQ_RING);
+        cq_ring_ = singleMmap ? sq_ring_
+                              : mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                                     IORING_OFF_CQ_RING);
+        sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+        sqes_ = (io_uring_sqe *)mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                                     IORING_OFF_SQES);
+        if (MAP_FAILED == sq_ring_ || MAP_FAILED == cq_ring_ || MAP_FAILED == (void *)sqes_) {
+            ring_fd_ = fd;
+            Exit();
+            return false;
+        }
+        char *sq = (char *)sq_ring_;
+        char *cq = (char *)cq_ring_;
+        sq_head_ = (unsigned *)(sq + params.sq_off.head);
+        sq_tail_ = (unsigned *)(sq + params.sq_off.tail);
+        sq_mask_ = *(unsigned *)(sq + params.sq_off.ring_mask);
+        sq_entries_ = params.sq_entries;
+        sq_array_ = (unsigned *)(sq + params.sq_off.array);
+        cq_head_ = (unsigned *)(cq + params.cq_off.head);
+        cq_tail_ = (unsigned *)(cq + params.cq_off.tail);
+        cq_mask_ = *(unsigned *)(cq + params.cq_off.ring_mask);
+        cqes_ = (io_uring_cqe *)(cq + params.cq_off.cqes);
+        sqe_tail_ = *sq_tail_;
+        ring_fd_ = fd;
+        return true;
+    }
+    void Exit() {
+        if (ring_fd_ < 0)
+            return;
+        if (sqes_ && MAP_FAILED != (void *)sqes_)
+            munmap(sqes_, sqes_size_);
+        if (cq_ring_ && MAP_FAILED != cq_ring_ && cq_ring_ != sq_ring_)
+            munmap(cq_ring_, cq_ring_size_);
+        if (sq_ring_ && MAP_FAILED != sq_ring_)
+            munmap(sq_ring_, sq_ring_size_);
+        close(ring_fd_);
+        ring_fd_ = -1;
+        sq_ring_ = cq_ring_ = nullptr;
+        sqes_ = nullptr;
+    }
+    bool Enabled() const { return ring_fd_ >= 0; }
+    int Fd() const { return ring_fd_; }
+
+    // 获取一个清零的SQE，保证提交队列中至少还有reserve个空位，链接的请求需要一次预留，避免被拆到两次提交中。
+    // 提交队列满了先提交，内核没有取走足够的SQE时（例如io_uring_enter返回EBUSY）返回nullptr，不能覆盖还没提交的SQE
+    io_uring_sqe *GetSqe(unsigned reserve = 1) {
+        if (not hasSpace(reserve)) {
+            Submit();
+            if (not hasSpace(reserve))
+                return nullptr;
+        }
+        unsigned index = sqe_tail_ & sq_mask_;
+        io_uring_sqe *sqe = &sqes_[index];
+        memset(sqe, 0, sizeof(*sqe));
+        sq_array_[index] = index;
+        sqe_tail_++;
+        return sqe;
+    }
+    // 提交所有排队的SQE，一次系统调用提交多个协程的请求
+    int Submit() {
+        __atomic_store_n(sq_tail_, sqe_tail_, __ATOMIC_RELEASE);
+        unsigned toSubmit = sqe_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+        if (0 == toSubmit)
+            return 0;
+        EnterCount()++;
+        int ret = (int)syscall(__NR_io_uring_enter, ring_fd_, toSubmit, 0, 0, nullptr, 0);
+        return ret < 0 ? -errno : ret;
+    }
+    // 收割所有的完成事件，返回需要唤醒的协程id
+    const std::vector<int> &Reap() {
+        wake_up_cids_.clear();
+        unsigned head = *cq_head_;
+        while (head != __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+            io_uring_cqe *cqe = &cqes_[head & cq_mask_];
+            UringRequest *request = (UringRequest *)cqe->user_data;
+            int32_t res = cqe->res;
+            uint32_t flags = cqe->flags;
+            __atomic_store_n(cq_head_, ++head, __ATOMIC_RELEASE);
+            if (nullptr == request) // 链接的超时请求的完成事件，不需要处理
+                continue;
+            if (request->callback_) {
+                request->callback_(request, res, flags);
+                continue;
+            }
+            request->res_ = res;
+            request->done_ = true;
+            wake_up_cids_.push_back(request->cid_);
+        }
+        return wake_up_cids_;
+    }
+    // 当前线程调用io_uring_enter的次数，用于评估每个请求的系统调用开销
+    static int64_t &EnterCount() {
+        static thread_local int64_t count = 0;
+        return count;
+    }
+
+private:
+    bool hasSpace(unsigned reserve) {
+        return sqe_tail_ + reserve - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) <= sq_entries_;
+    }
+
+private:
+    int ring_fd_{-1};
+    void *sq_ring_{nullptr};
+    void *cq_ring_{nullptr};
+    io_uring_sqe *sqes_{nullptr};
+    size_t sq_ring_size_{0};
+    size_t cq_ring_size_{0};
+    size_t sqes_size_{0};
+    unsigned *sq_head_{nullptr};
+    unsigned *sq_tail_{nullptr};
+    unsigned *sq_array_{nullptr};
+    unsigned sq_mask_{0};
+    unsigned sq_entries_{0};
+    unsigned sqe_tail_{0}; // 本地的提交队列尾部，Submit时才发布给内核
+    unsigned *cq_head_{nullptr};
+    unsigned *cq_tail_{nullptr};
+    unsigned cq_mask_{0};
+    io_uring_cqe *cqes_{nullptr};
+    std::vector<int> wake_up_cids_;
+};
+} // namespace Core
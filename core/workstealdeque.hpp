@@ -0,0 +1,128 @@
+#pragma once
+#include <assert.h>
+#include <stdint.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace Core {
+// 固定容量的无锁工作窃取双端队列（Chase-Lev算法）。
+// 只有队列所属的线程可以调用Push和Pop，在队列底部操作；其他线程调用Steal，从队列顶部窃取。
+// 队列中只保存指针，指针指向的对象由使用方管理。
+template <class Type>
+class WorkStealDeque {
+public:
+    explicit WorkStealDeque(int64_t capacity = 4096) : mask_(capacity - 1), items_(capacity) {
+        assert(capacity > 0 && 0 == (capacity & (capacity - 1))); // 容量必须是2的幂
+    }
+    // 在队列底部插入，队列满了返回false，只能由所属线程调用
+    bool Push(Type *item) {
+        int64_t bottom = bottom_.load(std::memory_order_relaxed);
+        int64_t top = top_.load(std::memory_order_acquire);
+        if (bottom - top > mask_)
+            return false;
+        items_[bottom & mask_].store(item, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom_.store(bottom + 1, std::memory_order_relaxed);
+        return true;
+    }
+    // 从队列底部取出（后进先出），队列为空返回nullptr，只能由所属线程调用
+    Type *Pop() {
+        int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+        bottom_.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t top = top_.load(std::memory_order_relaxed);
+        if (top > bottom) { // 队列为空
+            bottom_.store(bottom + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        Type *item = items_[bottom & mask_].load(std::memory_order_relaxed);
+        if (top == bottom) { // 只剩最后一个元素，需要和窃取的线程竞争
+            if (not top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                item = nullptr;
+            bottom_.store(bottom + 1, std::memory_order_relaxed);
+        }
+        return item;
+    }
+    // 从队列顶部取出（先进先出），队列为空或者竞争失败返回nullptr，任意线程都可以调用
+    Type *Steal() {
+        int64_t top = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t bottom = bottom_.load(std::memory_order_acquire);
+        if (top >= bottom)
+            return nullptr;
+        Type *item = items_[top & mask_].load(std::memory_order_relaxed);
+        if (not top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            return nullptr;
+        return item;
+    }
+    // 队列中元素的个数，并发修改时只是一个近似值
+    int64_t Size() const {
+        int64_t size = bottom_.load(std::memory_order_relaxed) - top_.load(std::memory_order_relaxed);
+        return size > 0 ? size : 0;
+    }
+
+private:
+    int64_t mask_;
+    std::vector<std::atomic<Type *>> items_;
+    char pad0_[64]; // top_和bottom_分别被窃取线程和所属线程频繁修改，隔开在不同的cache line中，避免伪共享
+    std::atomic<int64_t> top_{0};
+    char pad1_[64];
+    std::atomic<int64_t> bottom_{0};
+};
+
+// 空闲subReactor的按需唤醒。每个subReactor一个eventfd，注册在自己的epoll实例中。
+// subReactor没有事件要处理、准备无限期挂起之前先标记自己空闲，其他subReactor的请求队列出现积压时，
+// 只唤醒一个空闲的subReactor去窃取，没有积压时空闲的subReactor一直挂起，不需要定期醒来检查队列。
+class IdleWaker {
+public:
+    explicit IdleWaker(int count) {
+        for (int i = 0; i < count; i++) {
+            slots_.emplace_back(new Slot);
+            slots_[i]->event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            assert(slots_[i]->event_fd_ >= 0);
+        }
+    }
+    ~IdleWaker() {
+        for (auto &slot : slots_)
+            close(slot->event_fd_);
+    }
+    int Fd(int index) const { return slots_[index]->event_fd_; }
+    // 标记空闲之后使用方还需要再检查一次所有的队列，和WakeOne中的内存屏障配合，
+    // 保证挂起之前入队的请求要么被检查到，要么入队的一方看到了空闲标记
+    void SetIdle(int index, bool idle) {
+        slots_[index]->idle_.store(idle, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+    // 唤醒一个除了from之外的空闲subReactor，被唤醒的subReactor清除空闲标记，没有空闲的subReactor时返回false
+    bool WakeOne(int from) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        for (size_t i = 1; i < slots_.size(); i++) {
+            Slot &slot = *slots_[(from + i) % slots_.size()];
+            if (not slot.idle_.load(std::memory_order_relaxed) || not slot.idle_.exchange(false))
+                continue;
+            uint64_t one = 1;
+            ssize_t ret = write(slot.event_fd_, &one, sizeof(one));
+            (void)ret; // 计数器溢出之前eventfd一定是可读的，写失败也不影响唤醒
+            return true;
+        }
+        return false;
+    }
+    // 读走唤醒通知，eventfd以水平触发的方式监听，不读走会一直触发
+    void Drain(int index) {
+        uint64_t value = 0;
+        ssize_t ret = read(slots_[index]->event_fd_, &value, sizeof(value));
+        (void)ret;
+    }
+
+private:
+    typedef struct Slot {
+        int event_fd_{-1};
+        std::atomic<bool> idle_{false};
+        char pad_[64]; // 各个subReactor频繁修改自己的空闲标记，隔开在不同的cache line中
+    } Slot;
+    std::vector<std::unique_ptr<Slot>> slots_;
+};
+} // namespace Core
@@ -123,6 +123,7 @@ const ::PROTOBUF_NAMESPACE_ID::uint32 TableStruct_base_2eproto::offsets[] PROTOB
   PROTOBUF_FIELD_OFFSET(::MySvr::Base::Context, parent_stack_id_),
   PROTOBUF_FIELD_OFFSET(::MySvr::Base::Context, stack_alloc_id_),
   PROTOBUF_FIELD_OFFSET(::MySvr::Base::Context, trace_stack_),
+  PROTOBUF_FIELD_OFFSET(::MySvr::Base::Context, deadline_ms_),
   ~0u,  // no _has_bits_
   PROTOBUF_FIELD_OFFSET(::MySvr::Base::OneWayResponse, _internal_metadata_),
   ~0u,  // no _extensions_
@@ -137,8 +138,8 @@ const ::PROTOBUF_NAMESPACE_ID::uint32 TableStruct_base_2eproto::offsets[] PROTOB
 static const ::PROTOBUF_NAMESPACE_ID::internal::MigrationSchema schemas[] PROTOBUF_SECTION_VARIABLE(protodesc_cold) = {
   { 0, -1, sizeof(::MySvr::Base::TraceStack)},
   { 13, -1, sizeof(::MySvr::Base::Context)},
-  { 26, -1, sizeof(::MySvr::Base::OneWayResponse)},
-  { 31, -1, sizeof(::MySvr::Base::FastRespResponse)},
+  { 27, -1, sizeof(::MySvr::Base::OneWayResponse)},
+  { 32, -1, sizeof(::MySvr::Base::FastRespResponse)},
 };
 
 static ::PROTOBUF_NAMESPACE_ID::Message const * const file_default_instances[] = {
@@ -154,16 +155,17 @@ const char descriptor_table_protodef_base_2eproto[] PROTOBUF_SECTION_VARIABLE(pr
   "ent_id\030\001 \001(\005\022\022\n\ncurrent_id\030\002 \001(\005\022\024\n\014serv"
   "ice_name\030\003 \001(\t\022\020\n\010rpc_name\030\004 \001(\t\022\023\n\013stat"
   "us_code\030\005 \001(\005\022\017\n\007message\030\006 \001(\t\022\020\n\010spend_"
-  "us\030\007 \001(\003\022\020\n\010is_batch\030\010 \001(\010\"\316\001\n\007Context\022\016"
+  "us\030\007 \001(\003\022\020\n\010is_batch\030\010 \001(\010\"\343\001\n\007Context\022\016"
   "\n\006log_id\030\001 \001(\t\022\024\n\014service_name\030\002 \001(\t\022\020\n\010"
   "rpc_name\030\003 \001(\t\022\023\n\013status_code\030\004 \001(\005\022\030\n\020c"
   "urrent_stack_id\030\005 \001(\005\022\027\n\017parent_stack_id"
   "\030\006 \001(\005\022\026\n\016stack_alloc_id\030\007 \001(\005\022+\n\013trace_"
-  "stack\030\010 \003(\0132\026.MySvr.Base.TraceStack\"\020\n\016O"
-  "neWayResponse\"\022\n\020FastRespResponse:/\n\004Por"
-  "t\022\037.google.protobuf.ServiceOptions\030\321\206\003 \001"
-  "(\005:4\n\nMethodMode\022\036.google.protobuf.Metho"
-  "dOptions\030\321\206\003 \001(\005b\006proto3"
+  "stack\030\010 \003(\0132\026.MySvr.Base.TraceStack\022\023\n\013d"
+  "eadline_ms\030\t \001(\003\"\020\n\016OneWayResponse\"\022\n\020Fa"
+  "stRespResponse:/\n\004Port\022\037.google.protobuf"
+  ".ServiceOptions\030\321\206\003 \001(\005:4\n\nMethodMode\022\036."
+  "google.protobuf.MethodOptions\030\321\206\003 \001(\005b\006p"
+  "roto3"
   ;
 static const ::PROTOBUF_NAMESPACE_ID::internal::DescriptorTable*const descriptor_table_base_2eproto_deps[1] = {
   &::descriptor_table_google_2fprotobuf_2fdescriptor_2eproto,
@@ -176,7 +178,7 @@ static ::PROTOBUF_NAMESPACE_ID::internal::SCCInfoBase*const descriptor_table_bas
 };
 static ::PROTOBUF_NAMESPACE_ID::internal::once_flag descriptor_table_base_2eproto_once;
 const ::PROTOBUF_NAMESPACE_ID::internal::DescriptorTable descriptor_table_base_2eproto = {
-  false, false, descriptor_table_protodef_base_2eproto, "base.proto", 584,
+  false, false, descriptor_table_protodef_base_2eproto, "base.proto", 605,
   &descriptor_table_base_2eproto_once, descriptor_table_base_2eproto_sccs, descriptor_table_base_2eproto_deps, 4, 1,
   schemas, file_default_instances, TableStruct_base_2eproto::offsets,
   file_level_metadata_base_2eproto, 4, file_level_enum_descriptors_base_2eproto, file_level_service_descriptors_base_2eproto,
@@ -635,8 +637,8 @@ Context::Context(const Context& from)
       GetArena());
   }
   ::memcpy(&status_code_, &from.status_code_,
-    static_cast<size_t>(reinterpret_cast<char*>(&stack_alloc_id_) -
-    reinterpret_cast<char*>(&status_code_)) + sizeof(stack_alloc_id_));
+    static_cast<size_t>(reinterpret_cast<char*>(&deadline_ms_) -
+    reinterpret_cast<char*>(&status_code_)) + sizeof(deadline_ms_));
   // @@protoc_insertion_point(copy_constructor:MySvr.Base.Context)
 }
 
@@ -646,8 +648,8 @@ void Context::SharedCtor() {
   service_name_.UnsafeSetDefault(&::PROTOBUF_NAMESPACE_ID::internal::GetEmptyStringAlreadyInited());
   rpc_name_.UnsafeSetDefault(&::PROTOBUF_NAMESPACE_ID::internal::GetEmptyStringAlreadyInited());
   ::memset(&status_code_, 0, static_cast<size_t>(
-      reinterpret_cast<char*>(&stack_alloc_id_) -
-      reinterpret_cast<char*>(&status_code_)) + sizeof(stack_alloc_id_));
+      reinterpret_cast<char*>(&deadline_ms_) -
+      reinterpret_cast<char*>(&status_code_)) + sizeof(deadline_ms_));
 }
 
 Context::~Context() {
@@ -689,8 +691,8 @@ void Context::Clear() {
   service_name_.ClearToEmpty(&::PROTOBUF_NAMESPACE_ID::internal::GetEmptyStringAlreadyInited(), GetArena());
   rpc_name_.ClearToEmpty(&::PROTOBUF_NAMESPACE_ID::internal::GetEmptyStringAlreadyInited(), GetArena());
   ::memset(&status_code_, 0, static_cast<size_t>(
-      reinterpret_cast<char*>(&stack_alloc_id_) -
-      reinterpret_cast<char*>(&status_code_)) + sizeof(stack_alloc_id_));
+      reinterpret_cast<char*>(&deadline_ms_) -
+      reinterpret_cast<char*>(&status_code_)) + sizeof(deadline_ms_));
   _internal_metadata_.Clear<::PROTOBUF_NAMESPACE_ID::UnknownFieldSet>();
 }
 
@@ -769,6 +771,13 @@ const char* Context::_InternalParse(const char* ptr, ::PROTOBUF_NAMESPACE_ID::in
           } while (::PROTOBUF_NAMESPACE_ID::internal::ExpectTag<66>(ptr));
         } else goto handle_unusual;
         continue;
+      // int64 deadline_ms = 9;
+      case 9:
+        if (PROTOBUF_PREDICT_TRUE(static_cast<::PROTOBUF_NAMESPACE_ID::uint8>(tag) == 72)) {
+          deadline_ms_ = ::PROTOBUF_NAMESPACE_ID::internal::ReadVarint64(&ptr);
+          CHK_(ptr);
+        } else goto handle_unusual;
+        continue;
       default: {
       handle_unusual:
         if ((tag & 7) == 4 || tag == 0) {
@@ -859,6 +868,12 @@ failure:
       InternalWriteMessage(8, this->_internal_trace_stack(i), target, stream);
   }
 
+  // int64 deadline_ms = 9;
+  if (this->deadline_ms() != 0) {
+    target = stream->EnsureSpace(target);
+    target = ::PROTOBUF_NAMESPACE_ID::internal::WireFormatLite::WriteInt64ToArray(9, this->_internal_deadline_ms(), target);
+  }
+
   if (PROTOBUF_PREDICT_FALSE(_internal_metadata_.have_unknown_fields())) {
     target = ::PROTOBUF_NAMESPACE_ID::internal::WireFormat::InternalSerializeUnknownFieldsToArray(
         _internal_metadata_.unknown_fields<::PROTOBUF_NAMESPACE_ID::UnknownFieldSet>(::PROTOBUF_NAMESPACE_ID::UnknownFieldSet::default_instance), target, stream);
@@ -931,6 +946,13 @@ size_t Context::ByteSizeLong() const {
         this->_internal_stack_alloc_id());
   }
 
+  // int64 deadline_ms = 9;
+  if (this->deadline_ms() != 0) {
+    total_size += 1 +
+      ::PROTOBUF_NAMESPACE_ID::internal::WireFormatLite::Int64Size(
+        this->_internal_deadline_ms());
+  }
+
   if (PROTOBUF_PREDICT_FALSE(_internal_metadata_.have_unknown_fields())) {
     return ::PROTOBUF_NAMESPACE_ID::internal::ComputeUnknownFieldsSize(
         _internal_metadata_, total_size, &_cached_size_);
@@ -984,6 +1006,9 @@ void Context::MergeFrom(const Context& from) {
   if (from.stack_alloc_id() != 0) {
     _internal_set_stack_alloc_id(from._internal_stack_alloc_id());
   }
+  if (from.deadline_ms() != 0) {
+    _internal_set_deadline_ms(from._internal_deadline_ms());
+  }
 }
 
 void Context::CopyFrom(const ::PROTOBUF_NAMESPACE_ID::Message& from) {
@@ -1012,8 +1037,8 @@ void Context::InternalSwap(Context* other) {
   service_name_.Swap(&other->service_name_, &::PROTOBUF_NAMESPACE_ID::internal::GetEmptyStringAlreadyInited(), GetArena());
   rpc_name_.Swap(&other->rpc_name_, &::PROTOBUF_NAMESPACE_ID::internal::GetEmptyStringAlreadyInited(), GetArena());
   ::PROTOBUF_NAMESPACE_ID::internal::memswap<
-      PROTOBUF_FIELD_OFFSET(Context, stack_alloc_id_)
-      + sizeof(Context::stack_alloc_id_)
+      PROTOBUF_FIELD_OFFSET(Context, deadline_ms_)
+      + sizeof(Context::deadline_ms_)
       - PROTOBUF_FIELD_OFFSET(Context, status_code_)>(
           reinterpret_cast<char*>(&status_code_),
           reinterpret_cast<char*>(&other->status_code_));
@@ -465,6 +465,7 @@ class Context PROTOBUF_FINAL :
     kCurrentStackIdFieldNumber = 5,
     kParentStackIdFieldNumber = 6,
     kStackAllocIdFieldNumber = 7,
+    kDeadlineMsFieldNumber = 9,
   };
   // repeated .MySvr.Base.TraceStack trace_stack = 8;
   int trace_stack_size() const;
@@ -595,6 +596,15 @@ class Context PROTOBUF_FINAL :
   void _internal_set_stack_alloc_id(::PROTOBUF_NAMESPACE_ID::int32 value);
   public:
 
+  // int64 deadline_ms = 9;
+  void clear_deadline_ms();
+  ::PROTOBUF_NAMESPACE_ID::int64 deadline_ms() const;
+  void set_deadline_ms(::PROTOBUF_NAMESPACE_ID::int64 value);
+  private:
+  ::PROTOBUF_NAMESPACE_ID::int64 _internal_deadline_ms() const;
+  void _internal_set_deadline_ms(::PROTOBUF_NAMESPACE_ID::int64 value);
+  public:
+
   // @@protoc_insertion_point(class_scope:MySvr.Base.Context)
  private:
   class _Internal;
@@ -610,6 +620,7 @@ class Context PROTOBUF_FINAL :
   ::PROTOBUF_NAMESPACE_ID::int32 current_stack_id_;
   ::PROTOBUF_NAMESPACE_ID::int32 parent_stack_id_;
   ::PROTOBUF_NAMESPACE_ID::int32 stack_alloc_id_;
+  ::PROTOBUF_NAMESPACE_ID::int64 deadline_ms_;
   mutable ::PROTOBUF_NAMESPACE_ID::internal::CachedSize _cached_size_;
   friend struct ::TableStruct_base_2eproto;
 };
@@ -1589,6 +1600,26 @@ Context::trace_stack() const {
   return trace_stack_;
 }
 
+// int64 deadline_ms = 9;
+inline void Context::clear_deadline_ms() {
+  deadline_ms_ = PROTOBUF_LONGLONG(0);
+}
+inline ::PROTOBUF_NAMESPACE_ID::int64 Context::_internal_deadline_ms() const {
+  return deadline_ms_;
+}
+inline ::PROTOBUF_NAMESPACE_ID::int64 Context::deadline_ms() const {
+  // @@protoc_insertion_point(field_get:MySvr.Base.Context.deadline_ms)
+  return _internal_deadline_ms();
+}
+inline void Context::_internal_set_deadline_ms(::PROTOBUF_NAMESPACE_ID::int64 value) {
+  
+  deadline_ms_ = value;
+}
+inline void Context::set_deadline_ms(::PROTOBUF_NAMESPACE_ID::int64 value) {
+  _internal_set_deadline_ms(value);
+  // @@protoc_insertion_point(field_set:MySvr.Base.Context.deadline_ms)
+}
+
 // -------------------------------------------------------------------
 
 // OneWayResponse
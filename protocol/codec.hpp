@@ -22,8 +22,33 @@ public:
     virtual bool Encode(void *msg, Packet &pkt) = 0;
     virtual bool Decode(size_t len) = 0;
     virtual CodecType Type() = 0;
+    // 开启批量读取：使用len大小的缓冲区，每次尽量多读，协议的解析在已经读取到的数据上进行，一次read可以读到多个完整的消息，
+    // 解析完一个消息之后缓冲区重复使用。调用方需要能处理多读的数据（例如服务端的连接），按协议长度精确读取的客户端不要开启
+    void EnableBulkRead(size_t len) {
+        bulk_len_ = len;
+        pkt_.ReAlloc(len);
+    }
+    void SwapPacket(Packet &pkt) { pkt_.Swap(pkt); } // 直接接管已经读取了数据的缓冲区，不需要拷贝
+
+protected:
+    // 解析完一个消息之后重置缓冲区，缓冲区中可能已经读取了下一个消息的数据（客户端pipeline发送请求），需要保留。
+    // 批量读取的缓冲区大小没有变化时只移动剩余的数据，被大消息扩大过的缓冲区重新分配，及时释放空间
+    void resetPacket(size_t initLen) {
+        size_t remain = pkt_.NeedParseLen();
+        size_t len = std::max(bulk_len_ > 0 ? bulk_len_ : initLen, remain * 2);
+        if (bulk_len_ > 0 && pkt_.len_ == len) {
+            pkt_.Compact();
+            return;
+        }
+        Packet next;
+        next.Alloc(len);
+        memmove(next.Data(), pkt_.DataParse(), remain);
+        next.UpdateUseLen(remain);
+        pkt_.Swap(next);
+    }
 
 protected:
     Packet pkt_;
+    size_t bulk_len_{0}; // 批量读取的缓冲区大小，0表示按协议需要的长度读取
 };
 } // namespace Protocols
\ No newline at end of file
@@ -98,7 +98,7 @@ public:
         if (decodeLen > 0)
             pkt_.UpdateParseLen(decodeLen);
         if (FINISH == decode_status_)
-            pkt_.Alloc(FIRST_READ_LEN); // 解析完一个消息及时释放空间，并申请新的空间
+            resetPacket(FIRST_READ_LEN); // 解析完一个消息及时释放空间，并申请新的空间
         return true;
     }
 
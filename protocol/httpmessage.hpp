@@ -5,12 +5,13 @@
 
 namespace Protocol
 {
-// 目前只支持4个状态码
+// 目前只支持5个状态码
 enum HttpStatusCode {
     OK = 200,                    // 请求成功
     BAD_REQUEST = 400,           // 错误的请求，目前body只支持json格式，非json格式返回这个错误码
     NOT_FOUND = 404,             // 请求失败，未找到相关资源
     INTERNAL_SERVER_ERROR = 500, // 内部服务错误
+    SERVICE_UNAVAILABLE = 503,   // 服务端过载，请求被拒绝
 };
 
 // http消息
@@ -32,6 +33,8 @@ typedef struct HttpMessage
             first_line_ = "HTTP/1.1 400 Bad Request";
         else if (NOT_FOUND == statusCode)
             first_line_ = "HTTP/1.1 404 Not Found";
+        else if (SERVICE_UNAVAILABLE == statusCode)
+            first_line_ = "HTTP/1.1 503 Service Unavailable";
         else
             first_line_ = "HTTP/1.1 500 Internal Server Error";
     }
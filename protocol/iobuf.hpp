@@ -0,0 +1,160 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <atomic>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "../common/bufferpool.hpp"
+
+namespace Protocol {
+constexpr size_t IOBUF_BLOCK_LEN = 4 * 1024; // IOBuf追加拷贝数据时新申请的内存块的最小大小
+
+// 带引用计数的内存块，头部和数据在同一次内存分配中，数据紧跟在头部之后。内存从线程级的缓冲区池中申请，
+// 数据区的实际大小是池中规格的大小减去头部，不小于申请的大小
+class IOBlock {
+public:
+    static IOBlock *Create(size_t cap) {
+        size_t size = 0;
+        void *mem = Common::BufferPool::Acquire(sizeof(IOBlock) + cap, size);
+        return new (mem) IOBlock(size - sizeof(IOBlock));
+    }
+    // 扩大没有被共享的内存块，规格的容量足够时不需要重新申请，否则申请新的内存块并拷贝前面copyLen字节的数据
+    static IOBlock *Resize(IOBlock *block, size_t cap, size_t copyLen) {
+        if (nullptr == block)
+            return Create(cap);
+        if (block->cap_ >= cap)
+            return block;
+        IOBlock *newBlock = Create(cap);
+        memmove(newBlock->Data(), block->Data(), copyLen);
+        block->Unref();
+        return newBlock;
+    }
+    void Ref() { ref_.fetch_add(1, std::memory_order_relaxed); }
+    void Unref() {
+        if (ref_.fetch_sub(1, std::memory_order_acq_rel) != 1)
+            return;
+        size_t size = sizeof(IOBlock) + cap_;
+        this->~IOBlock();
+        Common::BufferPool::Release((void *)this, size);
+    }
+    bool Shared() const { return ref_.load(std::memory_order_acquire) > 1; }
+    uint8_t *Data() { return (uint8_t *)(this + 1); }
+    size_t Cap() const { return cap_; }
+
+private:
+    IOBlock(size_t cap) : cap_(cap) {}
+
+private:
+    std::atomic<int32_t> ref_{1};
+    size_t cap_{0}; // 数据区的大小
+};
+static_assert(sizeof(IOBlock) <= Common::BUFFER_POOL_HEADROOM, "IOBlock header exceeds buffer pool headroom");
+
+// 链式缓冲区：由多个内存块上的片段组成，拷贝IOBuf和追加其他IOBuf、Packet都只增加内存块的引用计数，不拷贝数据。
+// 写入socket时直接把各个片段交给writev，多个应答不需要先拼接到一块连续的内存中。
+class IOBuf {
+public:
+    IOBuf() {}
+    IOBuf(const IOBuf &buf) { Append(buf); }
+    IOBuf &operator=(const IOBuf &buf) {
+        if (this != &buf) {
+            Clear();
+            Append(buf);
+        }
+        return *this;
+    }
+    ~IOBuf() { Clear(); }
+
+    // 拷贝数据到尾部的内存块，尾部的内存块被共享或者空间不够时申请新的内存块
+    void Append(const void *data, size_t len) {
+        if (0 == len)
+            return;
+        if (not slices_.empty()) {
+            Slice &tail = slices_.back();
+            if (not tail.block_->Shared() && tail.offset_ + tail.len_ + len <= tail.block_->Cap()) {
+                memmove(tail.block_->Data() + tail.offset_ + tail.len_, data, len);
+                tail.len_ += len;
+                length_ += len;
+                return;
+            }
+        }
+        IOBlock *block = IOBlock::Create(len > IOBUF_BLOCK_LEN ? len : IOBUF_BLOCK_LEN);
+        memmove(block->Data(), data, len);
+        slices_.push_back(Slice{block, 0, len});
+        length_ += len;
+    }
+    void Append(const IOBuf &buf) {
+        for (const Slice &slice : buf.slices_)
+            AppendBlock(slice.block_, slice.offset_, slice.len_);
+    }
+    // 引用内存块中[offset, offset + len)的数据
+    void AppendBlock(IOBlock *block, size_t offset, size_t len) {
+        if (nullptr == block || 0 == len)
+            return;
+        block->Ref();
+        slices_.push_back(Slice{block, offset, len});
+        length_ += len;
+    }
+    size_t Length() const { return length_; }
+    size_t SliceCount() const { return slices_.size(); }
+    bool Empty() const { return 0 == length_; }
+
+    // 把前面最多maxCount个片段填充到iov中，返回填充的个数
+    int Iovecs(struct iovec *iov, int maxCount) const {
+        int count = 0;
+        for (const Slice &slice : slices_) {
+            if (count >= maxCount)
+                break;
+            iov[count].iov_base = slice.block_->Data() + slice.offset_;
+            iov[count].iov_len = slice.len_;
+            count++;
+        }
+        return count;
+    }
+    // 丢弃前面len字节的数据，例如writev只写入了一部分
+    void Consume(size_t len) {
+        size_t index = 0;
+        while (len > 0 && index < slices_.size()) {
+            Slice &slice = slices_[index];
+            if (len < slice.len_) {
+                slice.offset_ += len;
+                slice.len_ -= len;
+                length_ -= len;
+                break;
+            }
+            len -= slice.len_;
+            length_ -= slice.len_;
+            slice.block_->Unref();
+            index++;
+        }
+        slices_.erase(slices_.begin(), slices_.begin() + index);
+    }
+    std::string ToString() const {
+        std::string str;
+        str.reserve(length_);
+        for (const Slice &slice : slices_)
+            str.append((char *)slice.block_->Data() + slice.offset_, slice.len_);
+        return str;
+    }
+    void Clear() {
+        for (Slice &slice : slices_)
+            slice.block_->Unref();
+        slices_.clear();
+        length_ = 0;
+    }
+
+private:
+    typedef struct Slice {
+        IOBlock *block_;
+        size_t offset_; // 片段在内存块中的开始位置
+        size_t len_;    // 片段的长度
+    } Slice;
+    std::vector<Slice> slices_;
+    size_t length_{0};
+};
+} // namespace Protocol
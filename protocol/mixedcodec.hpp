@@ -7,6 +7,12 @@
 namespace Protocol {
 class MixedCodec {
 public:
+    // bulkLen大于0时开启批量读取：从第一次读取开始就使用bulkLen大小的缓冲区，用读取到的第一个字节判断协议，
+    // 具体协议的编解码器直接接管这个缓冲区继续解析，小的请求一次read就可以读取完整
+    explicit MixedCodec(size_t bulkLen = 0) : bulk_len_(bulkLen) {
+        if (bulk_len_ > 0)
+            first_pkt_.Alloc(bulk_len_);
+    }
     ~MixedCodec() {
         if (codec_) delete codec_;
     }
@@ -15,11 +21,11 @@ public:
         return codec_->Type();
     }
     uint8_t *Data() {
-        if (nullptr == codec_) return &first_byte_; // 无法确定具体协议之前，只读取一个字节
+        if (nullptr == codec_) return bulk_len_ > 0 ? first_pkt_.Data() : &first_byte_; // 无法确定具体协议之前，只读取一个字节
         return codec_->Data();
     }
     size_t Len() {
-        if (nullptr == codec_) return 1; // 无法确定具体协议之前，只读取一个字节
+        if (nullptr == codec_) return bulk_len_ > 0 ? first_pkt_.Len() : 1; // 无法确定具体协议之前，只读取一个字节
         return codec_->Len();
     }
     void *GetMessage() {
@@ -31,8 +37,10 @@ public:
         if (nullptr == codec_) return false;
         return codec_->Encode(msg, pkt);
     }
+    // len为0时只解析缓冲区中已经读取但还没有解析的数据，用于连续处理客户端pipeline发送的多个请求
     bool Decode(size_t len) {
-        assert(len >= 1);
+        if (0 == len && nullptr == codec_)
+            return true;
         createCodec();
         assert(codec_ != nullptr);
         return codec_->Decode(len);
@@ -60,10 +68,11 @@ public:
             httpMessage.SetBody(R"({"message":")" + mySvrMessage.Message() + R"("})");
     }
     static bool PbParseFromMySvr(google::protobuf::Message &pb, MySvrMessage &mySvr){
-        std::string str((char *)mySvr.body_.DataRaw(), mySvr.body_.UseLen());
-        if (mySvr.BodyIsJson()) // json格式
+        if (mySvr.BodyIsJson()) { // json格式
+            std::string str((char *)mySvr.body_.DataRaw(), mySvr.body_.UseLen());
             return Common::Convert::JsonStr2Pb(str, pb);
-        return pb.ParseFromString(str);
+        }
+        return pb.ParseFromArray(mySvr.body_.DataRaw(), (int)mySvr.body_.UseLen()); // 直接从body解析，不需要拷贝
     }
 
     //将一个 Protobuf 消息对象（pb）序列化并填充到一个自定义的 MySvrMessage 对象（mySvr）中。
@@ -99,10 +108,18 @@ private:
     void createCodec() {
         if (codec_ != nullptr)
             return;
+        if (bulk_len_ > 0)
+            first_byte_ = *first_pkt_.DataRaw();
         if (PROTO_MAGIC_AND_VERSION == first_byte_)
             codec_ = new MySvrCodec;
         else
             codec_ = new HttpCodec;
+        if (bulk_len_ > 0) {
+            codec_->SwapPacket(first_pkt_); // 编解码器接管已经读取了数据的缓冲区，原来的缓冲区随first_pkt_释放
+            codec_->EnableBulkRead(bulk_len_);
+            Packet().Swap(first_pkt_);
+            return;
+        }
         memmove(codec_->Data(), &first_byte_, 1); // 拷贝1个字节的内容
         first_byte_ = 0;
     }
@@ -110,5 +127,7 @@ private:
 private:
     Codec *codec_{nullptr};
     uint8_t first_byte_{0}; // 第一个字节，用于判断具体的协议
+    size_t bulk_len_{0};    // 批量读取的缓冲区大小，0表示确定协议之前只读取一个字节
+    Packet first_pkt_;      // 批量读取时，确定协议之前读取数据的缓冲区
 };
 } // namespace Protocol
\ No newline at end of file
@@ -49,28 +49,28 @@ public:
         max_body_len_ = maxBodyLen;
     }
 
+    // 一次分配出包的最大长度，上下文序列化到包尾部的临时空间，上下文和消息体都直接压缩到最终的位置，最后再填充消息头
     bool Encode(void *msg, Packet &pkt) {
         MySvrMessage &message = *(MySvrMessage *)msg;
-        std::string body((const char *)message.body_.DataRaw(), message.body_.UseLen());
-        std::string context;
-        std::string compressBody;
-        std::string compressContext;
-        if (not message.context_.SerializePartialToString(&context))
+        size_t contextLen = message.context_.ByteSizeLong();
+        size_t bodyLen = message.body_.UseLen();
+        const char *body = bodyLen > 0 ? (const char *)message.body_.DataRaw() : "";
+        size_t maxLen = PROTO_HEAD_LEN + snappy::MaxCompressedLength(contextLen) + snappy::MaxCompressedLength(bodyLen);
+        pkt.Alloc(maxLen + contextLen); // 多分配contextLen字节，用于存放序列化之后还没有压缩的上下文
+        char *data = (char *)pkt.Data();
+        char *context = data + maxLen;
+        if (not message.context_.SerializePartialToArray(context, (int)contextLen))
             return false;
-        
-        snappy::Compress(body.data(), body.size(), &compressBody);
-        snappy::Compress(context.data(), context.size(), &compressContext);
-        message.head_.context_len_ = compressContext.size();                                // 设置消息上下文的长度
-        message.head_.body_len_ = compressBody.size();                                      // 设置消息体的长度
-        size_t len = PROTO_HEAD_LEN + message.head_.context_len_ + message.head_.body_len_; // 计算包总长度
-        pkt.Alloc(len);                                                                     // 分配空间
-        encodeHead(message, pkt);
-                                                                   // 打包消息头
-        pkt.UpdateUseLen(PROTO_HEAD_LEN);
-        memmove(pkt.Data(), compressContext.data(), compressContext.size()); // 打包消息上下文
-        pkt.UpdateUseLen(compressContext.size());
-        memmove(pkt.Data(), compressBody.data(), compressBody.size()); // 打包消息体
-        pkt.UpdateUseLen(compressBody.size());
+        size_t compressContextLen = 0;
+        size_t compressBodyLen = 0;
+        snappy::RawCompress(context, contextLen, data + PROTO_HEAD_LEN, &compressContextLen);
+        if (compressContextLen > UINT16_MAX) // 消息头中上下文的长度只有16位
+            return false;
+        snappy::RawCompress(body, bodyLen, data + PROTO_HEAD_LEN + compressContextLen, &compressBodyLen);
+        message.head_.context_len_ = compressContextLen; // 设置消息上下文的长度
+        message.head_.body_len_ = compressBodyLen;       // 设置消息体的长度
+        encodeHead(message, pkt);                        // 打包消息头
+        pkt.UpdateUseLen(PROTO_HEAD_LEN + compressContextLen + compressBodyLen);
         return true;
     }
     
@@ -106,7 +106,7 @@ public:
         if (decodeLen > 0)
             pkt_.UpdateParseLen(decodeLen);
         if (MY_SVR_FINISH == decode_status_)
-            pkt_.Alloc(PROTO_HEAD_LEN); // 解析完一个消息及时释放空间，并申请协议头部需要的空间
+            resetPacket(PROTO_HEAD_LEN); // 解析完一个消息及时释放空间，并申请协议头部需要的空间
         return true;
     }
 
@@ -149,8 +149,33 @@ private:
         decodeLen += PROTO_HEAD_LEN;
         (*data) += PROTO_HEAD_LEN;
         decode_status_ = MY_SVR_CONTEXT;
-        // 重新分配内存空间，这样解析一个消息最多就分配两次内存
-        pkt_.ReAlloc(PROTO_HEAD_LEN + message_->head_.context_len_ + message_->head_.body_len_);
+        // 重新分配内存空间，这样解析一个消息最多就分配两次内存。批量读取时缓冲区中可能已经有后续的数据，
+        // 缓冲区地址可能变化，需要重新定位解析的位置
+        size_t offset = *data - pkt_.DataRaw();
+        pkt_.ReAlloc(offset + message_->head_.context_len_ + message_->head_.body_len_);
+        *data = pkt_.DataRaw() + offset;
+        return true;
+    }
+
+    // 读取压缩数据解压之后的长度。snappy一个3字节的复制标记最多展开成64字节，
+    // 声明的长度超过压缩数据长度的32倍时一定是错误的数据，不能按这个长度分配内存
+    static bool uncompressedLength(const uint8_t *data, size_t compressLen, size_t &len) {
+        if (not snappy::GetUncompressedLength((const char *)data, compressLen, &len))
+            return false;
+        return len <= compressLen * 32 + 64;
+    }
+
+    // 压缩长度为0表示对端没有发送上下文或者消息体，snappy不接受空的压缩数据，直接当作空结果
+    static bool uncompress(const uint8_t *data, size_t compressLen, Packet &pkt) {
+        if (0 == compressLen)
+            return true;
+        size_t len = 0;
+        if (not uncompressedLength(data, compressLen, len))
+            return false;
+        pkt.Alloc(len);
+        if (not snappy::RawUncompress((const char *)data, compressLen, (char *)pkt.Data()))
+            return false;
+        pkt.UpdateUseLen(len);
         return true;
     }
 
@@ -162,10 +187,10 @@ private:
             decodeBreak = true;
             return true;
         }
-        std::string context;
-        std::string compressContext((const char *)*data, (size_t)contextLen);
-        snappy::Uncompress(compressContext.data(), compressContext.size(), &context);
-        if (not message_->context_.ParseFromString(context))
+        Packet context; // 解压到从缓冲区池中申请的临时空间，再直接从这里反序列化
+        if (not uncompress(*data, contextLen, context))
+            return false;
+        if (not message_->context_.ParseFromArray(context.DataRaw(), (int)context.UseLen()))
             return false;
         // 更新剩余待解析数据长度，已经解析的长度，缓冲区指针的位置，当前解析的状态。
         needDecodeLen -= contextLen;
@@ -181,12 +206,8 @@ private:
         uint32_t bodyLen = message_->head_.body_len_;
         if (needDecodeLen < bodyLen)
             return true;
-        std::string body;
-        std::string compressBody((const char *)*data, (size_t)bodyLen);
-        snappy::Uncompress(compressBody.data(), compressBody.size(), &body);
-        message_->body_.Alloc(body.size());
-        memmove(message_->body_.Data(), body.data(), body.size());
-        message_->body_.UpdateUseLen(body.size());
+        if (not uncompress(*data, bodyLen, message_->body_)) // 直接解压到消息体的缓冲区中
+            return false;
         // 更新剩余待解析数据长度，已经解析的长度，缓冲区指针的位置，当前解析的状态。
         needDecodeLen -= bodyLen;
         decodeLen += bodyLen;
@@ -1,40 +1,69 @@
 #pragma once
 
+#include <algorithm>
+
 #include "base.pb.h"
+#include "iobuf.hpp"
 
 namespace Protocol {
-class Packet { // 二进制包
+// 二进制包，缓冲区是带引用计数的内存块。CopyFrom只共享内存块并增加引用计数，
+// 共享的缓冲区在写入或者扩容之前才拷贝一份（写时拷贝），没有写入的一方不会发生拷贝
+class Packet {
 public:
-    ~Packet() {
-        if (data_)
-            free(data_);
-    }
+    ~Packet() { release(); }
     void Alloc(size_t len) {
-        if (data_)
-            free(data_);
-        data_ = (uint8_t *)malloc(len);
+        release();
+        block_ = IOBlock::Create(len);
+        data_ = block_->Data();
         len_ = len;
-        use_len_ = 0;
-        parse_len_ = 0;
     }
     void ReAlloc(size_t len) {
-        if (len < len_)
+        if (len <= len_)
             return;
-        data_ = (uint8_t *)realloc(data_, len);
+        if (block_ && block_->Shared()) {
+            unshare(len);
+            return;
+        }
+        block_ = IOBlock::Resize(block_, len, use_len_);
+        data_ = block_->Data();
         len_ = len;
     }
 
     void CopyFrom(const Packet &pkt) {
-        if (data_)
-            free(data_);
-        data_ = (uint8_t *)malloc(pkt.len_);
-        memmove(data_, pkt.data_, pkt.len_);
+        if (this == &pkt)
+            return;
+        release();
+        block_ = pkt.block_;
+        if (block_)
+            block_->Ref();
+        data_ = pkt.data_;
         len_ = pkt.len_;
         use_len_ = pkt.use_len_;
         parse_len_ = pkt.parse_len_;
     }
+    void Swap(Packet &pkt) { // 交换两个包的缓冲区，不拷贝数据
+        std::swap(block_, pkt.block_);
+        std::swap(data_, pkt.data_);
+        std::swap(len_, pkt.len_);
+        std::swap(use_len_, pkt.use_len_);
+        std::swap(parse_len_, pkt.parse_len_);
+    }
+    void Compact() { // 丢弃已经解析的数据，把还没有解析的数据移动到缓冲区的开始位置，缓冲区可以重复使用
+        if (block_ && block_->Shared())
+            unshare(len_);
+        size_t remain = NeedParseLen();
+        if (remain > 0 && parse_len_ > 0)
+            memmove(data_, data_ + parse_len_, remain);
+        use_len_ = remain;
+        parse_len_ = 0;
+    }
+    void ShareTo(IOBuf &buf) { buf.AppendBlock(block_, 0, use_len_); } // 已经写入的数据追加到buf中，不拷贝数据
     
-    uint8_t *Data() { return data_ + use_len_; }            // 缓冲区可以写入的开始地址
+    uint8_t *Data() { // 缓冲区可以写入的开始地址
+        if (block_ && block_->Shared())
+            unshare(len_);
+        return data_ + use_len_;
+    }
     uint8_t *DataRaw() { return data_; }                    // 原始缓冲区的开始地址
     uint8_t *DataParse() { return data_ + parse_len_; }     // 需要解析的开始地址
     size_t NeedParseLen() { return use_len_ - parse_len_; } // 还需要解析的长度
@@ -43,10 +72,30 @@ public:
     void UpdateUseLen(size_t add_len) { use_len_ += add_len; }
     void UpdateParseLen(size_t add_len) { parse_len_ += add_len; }
 
+private:
+    void release() {
+        if (block_)
+            block_->Unref();
+        block_ = nullptr;
+        data_ = nullptr;
+        len_ = 0;
+        use_len_ = 0;
+        parse_len_ = 0;
+    }
+    void unshare(size_t len) { // 拷贝一份独占的缓冲区，原来的内存块只减少引用计数
+        IOBlock *block = IOBlock::Create(len);
+        memmove(block->Data(), data_, use_len_);
+        block_->Unref();
+        block_ = block;
+        data_ = block->Data();
+        len_ = len;
+    }
+
 public:
-    uint8_t *data_{nullptr}; // 二进制缓冲区
-    size_t len_{0};          // 缓冲区的长度
-    size_t use_len_{0};      // 缓冲区使用长度
-    size_t parse_len_{0};    // 完成解析的长度
+    IOBlock *block_{nullptr}; // 缓冲区所在的内存块
+    uint8_t *data_{nullptr};  // 二进制缓冲区
+    size_t len_{0};           // 缓冲区的长度
+    size_t use_len_{0};       // 缓冲区使用长度
+    size_t parse_len_{0};     // 完成解析的长度
 };
 } // namespace Protocol
\ No newline at end of file
@@ -0,0 +1,137 @@
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "../core/admission.hpp"
+#include "../core/handler.hpp"
+#include "unittestcore.h"
+
+class AdmissionTestHandler : public Core::MyHandler {
+ public:
+  void MySvrHandler(Protocol::MySvrMessage& req, Protocol::MySvrMessage& resp) {}
+};
+
+// 等待队列有界，按入队时间判断队首是否排队超时
+TEST_CASE(Admission_Queue) {
+  Core::Admission admission;
+  admission.Init(2, 20);
+  Core::EventData eventData1(1, -1, Core::CLIENT);
+  Core::EventData eventData2(2, -1, Core::CLIENT);
+  int64_t depth = Core::Admission::QueueDepth();
+  ASSERT_TRUE(admission.Push(&eventData1));
+  ASSERT_TRUE(admission.Push(&eventData2));
+  ASSERT_FALSE(admission.Push(&eventData2));  // 队列满了
+  ASSERT_EQ(Core::Admission::QueueDepth() - depth, 2);
+  ASSERT_FALSE(admission.FrontExpired());
+  usleep(25000);
+  ASSERT_TRUE(admission.FrontExpired());
+  ASSERT_EQ(admission.Pop(), &eventData1);
+  ASSERT_EQ(admission.Pop(), &eventData2);
+  ASSERT_TRUE(admission.Empty());
+  ASSERT_EQ(Core::Admission::QueueDepth(), depth);
+  admission.Init(0, 20);  // 不排队
+  ASSERT_FALSE(admission.Push(&eventData1));
+}
+
+// 过载时MySvr请求回复OVERLOADED状态码，连接可以继续使用
+TEST_CASE(Admission_RejectMySvr) {
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds), 0);
+  Protocol::MySvrMessage req;
+  req.context_.set_service_name("echo");
+  req.context_.set_rpc_name("ping");
+  req.context_.set_log_id("666");
+  Protocol::MySvrCodec codec;
+  Protocol::Packet pkt;
+  ASSERT_TRUE(codec.Encode(&req, pkt));
+  ASSERT_EQ(write(fds[1], pkt.DataRaw(), pkt.UseLen()), (ssize_t)pkt.UseLen());
+  AdmissionTestHandler handler;
+  Core::EventData eventData(fds[0], -1, Core::CLIENT);
+  ASSERT_TRUE(handler.RejectOverloaded(&eventData));
+  Protocol::MySvrMessage* resp = nullptr;
+  while (nullptr == resp) {
+    ssize_t ret = read(fds[1], codec.Data(), codec.Len());
+    ASSERT_TRUE(ret > 0);
+    ASSERT_TRUE(codec.Decode(ret));
+    resp = (Protocol::MySvrMessage*)codec.GetMessage();
+  }
+  ASSERT_EQ(resp->StatusCode(), OVERLOADED);
+  ASSERT_EQ(resp->context_.log_id(), "666");
+  delete resp;
+
+  req.EnableOneway();  // oneway请求直接丢弃，不回包
+  Protocol::Packet onewayPkt;
+  ASSERT_TRUE(codec.Encode(&req, onewayPkt));
+  ASSERT_EQ(write(fds[1], onewayPkt.DataRaw(), onewayPkt.UseLen()), (ssize_t)onewayPkt.UseLen());
+  ASSERT_TRUE(handler.RejectOverloaded(&eventData));
+  char buf[16];
+  ASSERT_EQ(read(fds[1], buf, sizeof(buf)), -1);
+  Core::MyHandler::DeleteConn(&eventData);
+  close(fds[0]);
+  close(fds[1]);
+}
+
+// 拒绝的应答没有写完时保留连接，剩余的数据留在连接上，socket可写之后继续写回
+TEST_CASE(Admission_RejectShortWrite) {
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds), 0);
+  char fill[4096] = {0};
+  while (write(fds[0], fill, sizeof(fill)) > 0) {  // 填满socket的发送缓冲区
+  }
+  Protocol::MySvrMessage req;
+  req.context_.set_rpc_name("ping");
+  req.context_.set_log_id("666");
+  Protocol::MySvrCodec codec;
+  Protocol::Packet pkt;
+  ASSERT_TRUE(codec.Encode(&req, pkt));
+  ASSERT_EQ(write(fds[1], pkt.DataRaw(), pkt.UseLen()), (ssize_t)pkt.UseLen());
+  AdmissionTestHandler handler;
+  Core::EventData eventData(fds[0], -1, Core::CLIENT);
+  int64_t writeCount = Core::System::WriteCount();
+  ASSERT_TRUE(handler.RejectOverloaded(&eventData));
+  ASSERT_EQ(Core::System::WriteCount() - writeCount, 1);
+  ASSERT_TRUE(Core::MyHandler::HasPendingResp(&eventData));
+  while (read(fds[1], fill, sizeof(fill)) > 0) {  // 对端读走积压的数据，socket重新可写
+  }
+  ASSERT_TRUE(handler.RejectOverloaded(&eventData));
+  ASSERT_FALSE(Core::MyHandler::HasPendingResp(&eventData));
+  Protocol::MySvrMessage* resp = nullptr;
+  while (nullptr == resp) {
+    ssize_t ret = read(fds[1], codec.Data(), codec.Len());
+    ASSERT_TRUE(ret > 0);
+    ASSERT_TRUE(codec.Decode(ret));
+    resp = (Protocol::MySvrMessage*)codec.GetMessage();
+  }
+  ASSERT_EQ(resp->StatusCode(), OVERLOADED);
+  ASSERT_EQ(resp->context_.log_id(), "666");
+  delete resp;
+  Core::MyHandler::DeleteConn(&eventData);
+  close(fds[0]);
+  close(fds[1]);
+}
+
+// 过载时HTTP请求回复503；不完整的请求保留在连接的编解码器中，数据到齐之后再拒绝
+TEST_CASE(Admission_RejectHttp) {
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds), 0);
+  std::string req = "POST /index HTTP/1.1\r\nContent-Type: application/json\r\nContent-Length: 2\r\n\r\n{}";
+  ASSERT_EQ(write(fds[1], req.data(), req.size()), (ssize_t)req.size());
+  AdmissionTestHandler handler;
+  Core::EventData eventData(fds[0], -1, Core::CLIENT);
+  ASSERT_TRUE(handler.RejectOverloaded(&eventData));
+  char buf[1024] = {0};
+  ASSERT_TRUE(read(fds[1], buf, sizeof(buf) - 1) > 0);
+  ASSERT_EQ(std::string(buf).find("HTTP/1.1 503 Service Unavailable"), 0);
+  ASSERT_TRUE(std::string(buf).find("server overloaded") != std::string::npos);
+  ASSERT_EQ(write(fds[1], req.data(), 10), 10);
+  ASSERT_TRUE(handler.RejectOverloaded(&eventData));
+  ASSERT_EQ(read(fds[1], buf, sizeof(buf) - 1), -1);  // 请求不完整，不回包
+  ASSERT_EQ(write(fds[1], req.data() + 10, req.size() - 10), (ssize_t)(req.size() - 10));
+  ASSERT_TRUE(handler.RejectOverloaded(&eventData));
+  memset(buf, 0, sizeof(buf));
+  ASSERT_TRUE(read(fds[1], buf, sizeof(buf) - 1) > 0);
+  ASSERT_EQ(std::string(buf).find("HTTP/1.1 503 Service Unavailable"), 0);
+  close(fds[1]);
+  ASSERT_FALSE(handler.RejectOverloaded(&eventData));  // 对端关闭了连接
+  Core::MyHandler::DeleteConn(&eventData);
+  close(fds[0]);
+}
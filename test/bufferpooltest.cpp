@@ -0,0 +1,76 @@
+#include "../common/bufferpool.hpp"
+#include "../protocol/packet.hpp"
+#include "unittestcore.h"
+
+TEST_CASE(BufferPool_ClassSize) {
+  size_t headroom = Common::BUFFER_POOL_HEADROOM;
+  ASSERT_EQ(Common::BufferPool::ClassSize(1), 256 + headroom);
+  ASSERT_EQ(Common::BufferPool::ClassSize(256 + headroom), 256 + headroom);
+  ASSERT_EQ(Common::BufferPool::ClassSize(257 + headroom), 512 + headroom);
+  ASSERT_EQ(Common::BufferPool::ClassSize(16 * 1024 + 16), 16 * 1024 + headroom);  // 小头部不会升到下一个规格
+  ASSERT_EQ(Common::BufferPool::ClassSize(1024 * 1024 + headroom), 1024 * 1024 + headroom);
+  ASSERT_EQ(Common::BufferPool::ClassSize(1024 * 1024 + headroom + 1), 0);
+}
+
+TEST_CASE(BufferPool_AcquireRelease) {
+  Common::BufferPool& pool = BUFFER_POOL;
+  pool.Trim();
+  pool.Trim();  // 两次回收之后池中没有空闲的缓冲区
+  int64_t allocCount = pool.AllocCount();
+  int64_t hitCount = pool.HitCount();
+  size_t cap = 0;
+  void* buf = Common::BufferPool::Acquire(1000, cap);
+  ASSERT_EQ(cap, 1024 + Common::BUFFER_POOL_HEADROOM);
+  Common::BufferPool::Release(buf, cap);
+  ASSERT_EQ(pool.BytesHeld(), (int64_t)cap);
+  void* buf2 = Common::BufferPool::Acquire(800, cap);  // 同一个规格，复用刚释放的缓冲区
+  ASSERT_EQ(buf2, buf);
+  ASSERT_EQ(pool.BytesHeld(), 0);
+  ASSERT_EQ(pool.AllocCount() - allocCount, 2);
+  ASSERT_EQ(pool.HitCount() - hitCount, 1);
+  Common::BufferPool::Release(buf2, cap);
+  void* big = Common::BufferPool::Acquire(2 * 1024 * 1024, cap);  // 超过最大规格直接malloc
+  ASSERT_EQ(cap, 2 * 1024 * 1024);
+  Common::BufferPool::Release(big, cap);
+  ASSERT_EQ(pool.AllocCount() - allocCount, 2);
+}
+
+// 高水位回收：保留回到本周期在用峰值需要的空闲缓冲区，下一个周期没有再用到时全部释放
+TEST_CASE(BufferPool_Trim) {
+  Common::BufferPool& pool = BUFFER_POOL;
+  pool.Trim();
+  pool.Trim();
+  ASSERT_EQ(pool.BytesHeld(), 0);
+  size_t cap = 0;
+  void* bufs[10];
+  for (int i = 0; i < 10; i++) {
+    bufs[i] = Common::BufferPool::Acquire(4096, cap);
+  }
+  for (int i = 0; i < 10; i++) {
+    Common::BufferPool::Release(bufs[i], cap);
+  }
+  void* buf = Common::BufferPool::Acquire(4096, cap);
+  pool.Trim();  // 峰值10个，当前在用1个，保留9个空闲
+  ASSERT_EQ(pool.BytesHeld(), (int64_t)(9 * cap));
+  Common::BufferPool::Release(buf, cap);
+  pool.Trim();  // 本周期峰值1个，当前在用0个，只保留1个空闲
+  ASSERT_EQ(pool.BytesHeld(), (int64_t)cap);
+  pool.Trim();
+  ASSERT_EQ(pool.BytesHeld(), 0);
+}
+
+// Packet的缓冲区从池中申请，解析消息时反复申请和释放的缓冲区都能复用
+TEST_CASE(BufferPool_Packet) {
+  Common::BufferPool& pool = BUFFER_POOL;
+  int64_t allocCount = pool.AllocCount();
+  int64_t hitCount = pool.HitCount();
+  for (int i = 0; i < 1000; i++) {
+    Protocol::Packet pkt;
+    pkt.Alloc(100);
+    pkt.ReAlloc(200);  // 规格的容量足够，不需要重新申请
+    pkt.ReAlloc(1000);
+  }
+  ASSERT_EQ(pool.AllocCount() - allocCount, 2000);
+  ASSERT_TRUE(pool.HitCount() - hitCount >= 1998);
+  std::cout << "buffer pool hit rate = " << pool.HitRate() << std::endl;
+}
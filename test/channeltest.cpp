@@ -0,0 +1,297 @@
+#include <unistd.h>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "../common/timedeal.hpp"
+#include "../core/channel.hpp"
+#include "../core/waitgroup.hpp"
+#include "unittestcore.h"
+
+// 模拟subReactor的调度：只唤醒被标记的协程
+void ChannelRunUntilIdle() {
+  while (MyCoroutine::CoroutineResumeWakeUp(SCHEDULE) == MyCoroutine::Success) {
+  }
+}
+
+typedef struct ChannelArg {
+  Core::Channel<int>* channel_;
+  int count_;
+  int64_t sum_;
+  size_t max_size_;
+} ChannelArg;
+
+void ChannelProducer(void* arg) {
+  ChannelArg* channelArg = (ChannelArg*)arg;
+  for (int i = 1; i <= channelArg->count_; i++) {
+    channelArg->channel_->Send(std::move(i));
+    channelArg->max_size_ = std::max(channelArg->max_size_, channelArg->channel_->Size());
+  }
+  channelArg->channel_->Close();
+}
+
+void ChannelConsumer(void* arg) {
+  ChannelArg* channelArg = (ChannelArg*)arg;
+  int value = 0;
+  int expect = 1;
+  while (channelArg->channel_->Recv(value)) {
+    if (value != expect++) return;  // 数据按写入的顺序读取
+    channelArg->sum_ += value;
+  }
+}
+
+TEST_CASE(Channel_Unbounded) {
+  Core::Channel<int> channel;
+  ChannelArg arg{&channel, 100, 0, 0};
+  MyCoroutine::ScheduleInit(SCHEDULE, 2, 8 * 1024);
+  int consumer = MyCoroutine::CoroutineCreate(SCHEDULE, ChannelConsumer, &arg);
+  int producer = MyCoroutine::CoroutineCreate(SCHEDULE, ChannelProducer, &arg);
+  MyCoroutine::CoroutineResumeById(SCHEDULE, consumer);  // 通道为空，挂起
+  MyCoroutine::CoroutineResumeById(SCHEDULE, producer);  // 无界通道，一次写完
+  ASSERT_EQ(arg.max_size_, 100);
+  ChannelRunUntilIdle();
+  ASSERT_EQ(arg.sum_, 5050);
+  ASSERT_FALSE(MyCoroutine::ScheduleRunning(SCHEDULE));
+  MyCoroutine::ScheduleClean(SCHEDULE);
+}
+
+TEST_CASE(Channel_Bounded) {
+  Core::Channel<int> channel(2);
+  ChannelArg arg{&channel, 100, 0, 0};
+  MyCoroutine::ScheduleInit(SCHEDULE, 2, 8 * 1024);
+  int producer = MyCoroutine::CoroutineCreate(SCHEDULE, ChannelProducer, &arg);
+  int consumer = MyCoroutine::CoroutineCreate(SCHEDULE, ChannelConsumer, &arg);
+  MyCoroutine::CoroutineResumeById(SCHEDULE, producer);  // 写满之后挂起
+  ASSERT_EQ(channel.Size(), 2);
+  MyCoroutine::CoroutineResumeById(SCHEDULE, consumer);
+  ChannelRunUntilIdle();
+  ASSERT_EQ(arg.sum_, 5050);
+  ASSERT_EQ(arg.max_size_, 2);
+  ASSERT_FALSE(MyCoroutine::ScheduleRunning(SCHEDULE));
+  MyCoroutine::ScheduleClean(SCHEDULE);
+}
+
+void ChannelMoveOnlySend(void* arg) {
+  Core::Channel<std::unique_ptr<int>>* channel = (Core::Channel<std::unique_ptr<int>>*)arg;
+  channel->Send(std::unique_ptr<int>(new int(666)));
+}
+
+void ChannelMoveOnlyRecv(void* arg) {
+  Core::Channel<std::unique_ptr<int>>* channel = (Core::Channel<std::unique_ptr<int>>*)arg;
+  std::unique_ptr<int> value;
+  channel->Recv(value);
+  if (value && *value == 666) channel->Close();
+}
+
+// 只能移动的类型也可以在通道中传递
+TEST_CASE(Channel_MoveOnly) {
+  Core::Channel<std::unique_ptr<int>> channel(1);
+  MyCoroutine::ScheduleInit(SCHEDULE, 2, 8 * 1024);
+  int receiver = MyCoroutine::CoroutineCreate(SCHEDULE, ChannelMoveOnlyRecv, &channel);
+  int sender = MyCoroutine::CoroutineCreate(SCHEDULE, ChannelMoveOnlySend, &channel);
+  MyCoroutine::CoroutineResumeById(SCHEDULE, receiver);
+  MyCoroutine::CoroutineResumeById(SCHEDULE, sender);
+  ChannelRunUntilIdle();
+  ASSERT_TRUE(channel.IsClosed());
+  MyCoroutine::ScheduleClean(SCHEDULE);
+}
+
+typedef struct FanInArg {
+  Core::Channel<int>* channels_[2];
+  int64_t sum_;
+  int recv_count_;
+} FanInArg;
+
+void ChannelFanIn(void* arg) {
+  FanInArg* fanInArg = (FanInArg*)arg;
+  bool closed[2] = {false, false};
+  while (not closed[0] || not closed[1]) {
+    int values[2] = {0, 0};
+    Core::Select select;
+    for (int i = 0; i < 2; i++) {
+      if (not closed[i]) select.AddRecv(*fanInArg->channels_[i], values[i]);
+    }
+    int index = select.Wait();
+    int channelIndex = (not closed[0]) ? index : 1;  // 关闭的通道不再加入select
+    if (not select.Ok()) {
+      closed[channelIndex] = true;
+      continue;
+    }
+    fanInArg->sum_ += values[channelIndex];
+    fanInArg->recv_count_++;
+  }
+}
+
+// 多个生产者写入不同的通道，一个消费者通过select汇总
+TEST_CASE(Channel_SelectFanIn) {
+  Core::Channel<int> channels[2] = {Core::Channel<int>(1), Core::Channel<int>(1)};
+  FanInArg fanInArg{{&channels[0], &channels[1]}, 0, 0};
+  ChannelArg args[2] = {{&channels[0], 50, 0, 0}, {&channels[1], 100, 0, 0}};
+  MyCoroutine::ScheduleInit(SCHEDULE, 3, 8 * 1024);
+  int fanIn = MyCoroutine::CoroutineCreate(SCHEDULE, ChannelFanIn, &fanInArg);
+  MyCoroutine::CoroutineResumeById(SCHEDULE, fanIn);
+  for (int i = 0; i < 2; i++) {
+    int producer = MyCoroutine::CoroutineCreate(SCHEDULE, ChannelProducer, &args[i]);
+    MyCoroutine::CoroutineResumeById(SCHEDULE, producer);
+  }
+  ChannelRunUntilIdle();
+  ASSERT_EQ(fanInArg.recv_count_, 150);
+  ASSERT_EQ(fanInArg.sum_, 1275 + 5050);
+  ASSERT_FALSE(MyCoroutine::ScheduleRunning(SCHEDULE));
+  MyCoroutine::ScheduleClean(SCHEDULE);
+}
+
+typedef struct SelectSendArg {
+  Core::Channel<std::unique_ptr<int>>* channels_[2];
+  std::unique_ptr<int> values_[2];
+  int index_;
+  bool ok_;
+} SelectSendArg;
+
+void ChannelSelectSend(void* arg) {
+  SelectSendArg* sendArg = (SelectSendArg*)arg;
+  Core::Select select;
+  select.AddSend(*sendArg->channels_[0], sendArg->values_[0]);
+  select.AddSend(*sendArg->channels_[1], sendArg->values_[1]);
+  sendArg->index_ = select.Wait();
+  sendArg->ok_ = select.Ok();
+}
+
+// 两个有界通道一开始都是满的，哪个通道先有空位就写入哪个，没有被选中的值不会被移走
+TEST_CASE(Channel_SelectSend) {
+  Core::Channel<std::unique_ptr<int>> channels[2] = {Core::Channel<std::unique_ptr<int>>(1),
+                                                     Core::Channel<std::unique_ptr<int>>(1)};
+  for (int i = 0; i < 2; i++) {
+    ASSERT_TRUE(channels[i].TrySend(std::unique_ptr<int>(new int(i))));
+  }
+  SelectSendArg sendArg{
+      {&channels[0], &channels[1]}, {std::unique_ptr<int>(new int(10)), std::unique_ptr<int>(new int(11))}, -1, false};
+  MyCoroutine::ScheduleInit(SCHEDULE, 1, 8 * 1024);
+  int cid = MyCoroutine::CoroutineCreate(SCHEDULE, ChannelSelectSend, &sendArg);
+  MyCoroutine::CoroutineResumeById(SCHEDULE, cid);  // 两个通道都满了，挂起
+  ASSERT_EQ(sendArg.index_, -1);
+  std::unique_ptr<int> value;
+  ASSERT_TRUE(channels[1].TryRecv(value));  // 腾出空位，唤醒select
+  ASSERT_EQ(*value, 1);
+  ChannelRunUntilIdle();
+  ASSERT_EQ(sendArg.index_, 1);
+  ASSERT_TRUE(sendArg.ok_);
+  ASSERT_TRUE(channels[1].TryRecv(value));
+  ASSERT_EQ(*value, 11);
+  ASSERT_TRUE(sendArg.values_[1] == nullptr);
+  ASSERT_EQ(*sendArg.values_[0], 10);
+  ASSERT_EQ(channels[0].Size(), 1);
+  ASSERT_FALSE(MyCoroutine::ScheduleRunning(SCHEDULE));
+  MyCoroutine::ScheduleClean(SCHEDULE);
+}
+
+void ChannelSelectTimeOut(void* arg) {
+  Core::Channel<int> channel;
+  int value = 0;
+  Core::Select select;
+  select.AddRecv(channel, value);
+  Common::TimeStat timeStat;
+  int index = select.Wait(20);
+  *(int64_t*)arg = (Core::SELECT_NONE == index) ? timeStat.GetSpendTimeUs() : -1;
+}
+
+TEST_CASE(Channel_SelectTimeOut) {
+  int64_t spendUs = 0;
+  MyCoroutine::ScheduleInit(SCHEDULE, 1, 8 * 1024);
+  int cid = MyCoroutine::CoroutineCreate(SCHEDULE, ChannelSelectTimeOut, &spendUs);
+  MyCoroutine::CoroutineResumeById(SCHEDULE, cid);
+  Core::TimerData timerData;
+  while (MyCoroutine::ScheduleRunning(SCHEDULE) && TIMER.GetLastTimer(timerData)) {  // 模拟subReactor的定时器处理
+    usleep(TIMER.TimeOutMs(timerData) * 1000);
+    TIMER.Run(timerData);
+    ChannelRunUntilIdle();
+  }
+  ASSERT_TRUE(spendUs >= 20000);
+  ASSERT_FALSE(MyCoroutine::ScheduleRunning(SCHEDULE));
+  MyCoroutine::ScheduleClean(SCHEDULE);
+}
+
+typedef struct PingPongArg {
+  Core::Channel<int>* ping_;
+  Core::Channel<int>* pong_;
+  int loop_;
+} PingPongArg;
+
+void ChannelPing(void* arg) {
+  PingPongArg* pingPongArg = (PingPongArg*)arg;
+  int value = 0;
+  for (int i = 0; i < pingPongArg->loop_; i++) {
+    pingPongArg->ping_->Send(std::move(i));
+    pingPongArg->pong_->Recv(value);
+  }
+  pingPongArg->ping_->Close();
+}
+
+void ChannelPong(void* arg) {
+  PingPongArg* pingPongArg = (PingPongArg*)arg;
+  int value = 0;
+  while (pingPongArg->ping_->Recv(value)) {
+    pingPongArg->pong_->Send(std::move(value));
+  }
+}
+
+// 两个协程通过通道来回传递数据，统计一次往返的耗时
+TEST_CASE(Channel_PingPongBenchmark) {
+  Core::Channel<int> ping(1), pong(1);
+  PingPongArg arg{&ping, &pong, 1000000};
+  MyCoroutine::ScheduleInit(SCHEDULE, 2, 8 * 1024);
+  Common::TimeStat timeStat;
+  int pongId = MyCoroutine::CoroutineCreate(SCHEDULE, ChannelPong, &arg);
+  int pingId = MyCoroutine::CoroutineCreate(SCHEDULE, ChannelPing, &arg);
+  MyCoroutine::CoroutineResumeById(SCHEDULE, pongId);
+  MyCoroutine::CoroutineResumeById(SCHEDULE, pingId);
+  ChannelRunUntilIdle();
+  int64_t spendUs = timeStat.GetSpendTimeUs();
+  std::cout << "channel ping pong cost = " << spendUs * 1000.0 / arg.loop_ << "ns" << std::endl;
+  ASSERT_FALSE(MyCoroutine::ScheduleRunning(SCHEDULE));
+  MyCoroutine::ScheduleClean(SCHEDULE);
+}
+
+typedef struct BatchRecvArg {
+  Core::Channel<int>* channel_;
+  int sum_;
+  bool finish_;
+} BatchRecvArg;
+
+void ChannelBatchRecvChild(void* arg) {
+  BatchRecvArg* batchRecvArg = (BatchRecvArg*)arg;
+  int value = 0;
+  if (batchRecvArg->channel_->Recv(value)) batchRecvArg->sum_ += value;
+}
+
+void ChannelBatchRecvParent(void* arg) {
+  Core::WaitGroup wg;
+  wg.Add(ChannelBatchRecvChild, arg);
+  wg.Add(ChannelBatchRecvChild, arg);
+  wg.Wait();
+  ((BatchRecvArg*)arg)->finish_ = true;
+}
+
+void ChannelBatchSend(void* arg) {
+  BatchRecvArg* batchRecvArg = (BatchRecvArg*)arg;
+  batchRecvArg->channel_->Send(1);
+  batchRecvArg->channel_->Send(2);
+}
+
+// batch中的子协程被通道唤醒并执行完之后，等待batch的协程也要被恢复，不能等到有其他的事件到来
+TEST_CASE(Channel_BatchChildRecv) {
+  Core::Channel<int> channel;
+  BatchRecvArg arg{&channel, 0, false};
+  MyCoroutine::ScheduleInit(SCHEDULE, 4, 8 * 1024);
+  int parent = MyCoroutine::CoroutineCreate(SCHEDULE, ChannelBatchRecvParent, &arg);
+  MyCoroutine::CoroutineResumeById(SCHEDULE, parent);
+  MyCoroutine::CoroutineResumeInBatch(SCHEDULE, parent);  // 子协程都挂起在Recv上
+  ASSERT_FALSE(arg.finish_);
+  int sender = MyCoroutine::CoroutineCreate(SCHEDULE, ChannelBatchSend, &arg);
+  MyCoroutine::CoroutineResumeById(SCHEDULE, sender);
+  ChannelRunUntilIdle();
+  ASSERT_EQ(arg.sum_, 3);
+  ASSERT_TRUE(arg.finish_);
+  ASSERT_FALSE(MyCoroutine::ScheduleRunning(SCHEDULE));
+  MyCoroutine::ScheduleClean(SCHEDULE);
+}
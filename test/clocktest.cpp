@@ -0,0 +1,64 @@
+#include <assert.h>
+#include <unistd.h>
+
+#include <thread>
+
+#include "../common/clock.hpp"
+#include "../common/timedeal.hpp"
+#include "unittestcore.h"
+
+// 没有调用过Update()的线程每次都读取时钟
+TEST_CASE(Clock_NoCache) {
+  int64_t begin = Common::Clock::NowMs();
+  usleep(10000);
+  ASSERT_GE(Common::Clock::NowMs() - begin, 10);
+}
+
+// 调用Update()之后返回缓存的时间，直到下一次Update()或者RefreshMs()
+TEST_CASE(Clock_Cache) {
+  std::thread thread([]() {
+    Common::Clock::Update();
+    int64_t nowMs = Common::Clock::NowMs();
+    int64_t wallMs = Common::Clock::WallMs();
+    usleep(10000);
+    assert(Common::Clock::NowMs() == nowMs);
+    assert(Common::Clock::WallMs() == wallMs);
+    int64_t refreshMs = Common::Clock::RefreshMs();
+    assert(refreshMs - nowMs >= 10);
+    assert(Common::Clock::NowMs() == refreshMs);
+    Common::Clock::Update();
+    assert(Common::Clock::WallMs() - wallMs >= 10);
+  });
+  thread.join();
+}
+
+// TSC换算的耗时和单调时钟一致
+TEST_CASE(Clock_Ticks) {
+  std::cout << "tsc enabled = " << Common::Clock::TscEnabled() << std::endl;
+  int64_t beginTicks = Common::Clock::Ticks();
+  int64_t begin = Common::Clock::NowMs();
+  usleep(50000);
+  int64_t spendUs = Common::Clock::TicksToUs(Common::Clock::Ticks() - beginTicks);
+  int64_t spendMs = Common::Clock::NowMs() - begin;
+  ASSERT_GE(spendUs, 50000);
+  ASSERT_TRUE(spendUs / 1000 >= spendMs - 1 && spendUs / 1000 <= spendMs + 1);
+}
+
+// 获取时间的开销
+TEST_CASE(Clock_Benchmark) {
+  int loop = 1000000;
+  int64_t sum = 0;
+  Common::TimeStat timeStat;
+  for (int i = 0; i < loop; i++) {
+    Common::TimeStat temp;
+    sum += temp.GetSpendTimeUs();
+  }
+  int64_t statUs = timeStat.GetSpendTimeUs();
+  for (int i = 0; i < loop / 10; i++) {
+    sum += Common::TimeFormat::GetTimeStr("%F %T", true).size();
+  }
+  int64_t formatUs = timeStat.GetSpendTimeUs();
+  std::cout << "TimeStat cost = " << statUs * 1000 / loop << "ns, GetTimeStr cost = " << formatUs * 10000 / loop
+            << "ns" << std::endl;
+  ASSERT_GT(sum, 0);
+}
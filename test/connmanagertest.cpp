@@ -44,7 +44,9 @@ static void ConnTest(void* data) {
 
 static void eventHandler(Core::EventData* eventData) {
   int cid = eventData->cid_;
-  assert(cid != MyCoroutine::INVALID_ROUTINE_ID);
+  if (cid == MyCoroutine::INVALID_ROUTINE_ID) {  // 连接池中空闲连接上的事件，没有等待的协程
+    return;
+  }
   MyCoroutine::CoroutineResumeById(SCHEDULE, cid);  // 唤醒之前主动让出cpu的协程
 }
 
@@ -0,0 +1,74 @@
+#include <unistd.h>
+#include <vector>
+
+#include "../common/timedeal.hpp"
+#include "../core/coroutine.h"
+#include "../core/coroutineio.hpp"
+#include "../core/waitgroup.hpp"
+#include "unittestcore.h"
+
+typedef struct SleepArg {
+  int64_t sleep_ms_;
+  std::vector<int64_t>* finish_order_;
+} SleepArg;
+
+void CoSleepFunc(void* arg) {
+  SleepArg* sleepArg = (SleepArg*)arg;
+  Core::CoSleep(sleepArg->sleep_ms_);
+  sleepArg->finish_order_->push_back(sleepArg->sleep_ms_);
+}
+
+// 多个协程同时睡眠，按睡眠时间的先后醒来
+TEST_CASE(Coroutineio_CoSleep) {
+  std::vector<int64_t> finishOrder;
+  SleepArg args[3] = {{30, &finishOrder}, {10, &finishOrder}, {20, &finishOrder}};
+  MyCoroutine::ScheduleInit(SCHEDULE, 3, 64 * 1024);
+  Common::TimeStat timeStat;
+  for (int i = 0; i < 3; i++) {
+    int cid = MyCoroutine::CoroutineCreate(SCHEDULE, CoSleepFunc, &args[i]);
+    MyCoroutine::CoroutineResumeById(SCHEDULE, cid);
+  }
+  Core::TimerData timerData;
+  while (MyCoroutine::ScheduleRunning(SCHEDULE) && TIMER.GetLastTimer(timerData)) {  // 模拟subReactor的定时器处理
+    usleep(TIMER.TimeOutMs(timerData) * 1000);
+    TIMER.Run(timerData);
+  }
+  ASSERT_TRUE(timeStat.GetSpendTimeUs() >= 30000);
+  ASSERT_EQ(finishOrder.size(), 3);
+  ASSERT_EQ(finishOrder[0], 10);
+  ASSERT_EQ(finishOrder[1], 20);
+  ASSERT_EQ(finishOrder[2], 30);
+  MyCoroutine::ScheduleClean(SCHEDULE);
+}
+
+void CoSleepFanOut(void* arg) {
+  SleepArg* args = (SleepArg*)arg;
+  Core::WaitGroup wg;
+  for (int i = 0; i < 2; i++) {
+    wg.Add(CoSleepFunc, &args[i]);
+  }
+  wg.Wait();
+  args[0].finish_order_->push_back(0);  // Wait返回时所有子协程都醒来了
+}
+
+// batch中的子协程睡眠醒来并执行完之后，定时器处理完就要恢复等待batch的协程
+TEST_CASE(Coroutineio_CoSleepInBatch) {
+  std::vector<int64_t> finishOrder;
+  SleepArg args[2] = {{20, &finishOrder}, {10, &finishOrder}};
+  MyCoroutine::ScheduleInit(SCHEDULE, 3, 64 * 1024);
+  int parent = MyCoroutine::CoroutineCreate(SCHEDULE, CoSleepFanOut, args);
+  MyCoroutine::CoroutineResumeById(SCHEDULE, parent);
+  MyCoroutine::CoroutineResumeInBatch(SCHEDULE, parent);
+  Core::TimerData timerData;
+  while (MyCoroutine::ScheduleRunning(SCHEDULE) && TIMER.GetLastTimer(timerData)) {  // 和subReactor一样处理定时器
+    usleep(TIMER.TimeOutMs(timerData) * 1000);
+    TIMER.Run(timerData);
+    MyCoroutine::CoroutineResumeBatchFinish(SCHEDULE);
+  }
+  ASSERT_EQ(finishOrder.size(), 3);
+  ASSERT_EQ(finishOrder[0], 10);
+  ASSERT_EQ(finishOrder[1], 20);
+  ASSERT_EQ(finishOrder[2], 0);
+  ASSERT_FALSE(MyCoroutine::ScheduleRunning(SCHEDULE));
+  MyCoroutine::ScheduleClean(SCHEDULE);
+}
@@ -0,0 +1,88 @@
+#include <iostream>
+#include <string>
+
+#include "../common/timedeal.hpp"
+#include "../core/coroutinelocal.hpp"
+#include "unittestcore.h"
+
+Core::CoroutineLocal<int> LocalInt;
+Core::CoroutineLocal<std::string> LocalStr;
+
+void CoroutineLocalSetAndGet(void* arg) {
+  int value = *(int*)arg;
+  LocalInt.Set(value);
+  LocalStr.Set(std::to_string(value));
+  MyCoroutine::CoroutineYield(SCHEDULE);  // 其他协程设置的值互不影响
+  *(int*)arg = (LocalInt.Get() == value && LocalStr.Get() == std::to_string(value)) ? 1 : 0;
+}
+
+TEST_CASE(CoroutineLocal_SetAndGet) {
+  int args[] = {100, 200, 300};
+  MyCoroutine::ScheduleInit(SCHEDULE, 3, 8 * 1024);
+  for (int i = 0; i < 3; i++) {
+    MyCoroutine::CoroutineCreate(SCHEDULE, CoroutineLocalSetAndGet, &args[i]);
+  }
+  while (MyCoroutine::ScheduleRunning(SCHEDULE)) {
+    MyCoroutine::CoroutineResume(SCHEDULE);
+  }
+  for (int i = 0; i < 3; i++) {
+    ASSERT_EQ(args[i], 1);
+  }
+  MyCoroutine::ScheduleClean(SCHEDULE);
+}
+
+void CoroutineLocalBatchChild(void* arg) { *(int*)arg = LocalInt.Get(); }
+
+void CoroutineLocalBatchParent(void* arg) {
+  int* childArgs = (int*)arg;
+  LocalInt.Set(666);
+  int batchId = MyCoroutine::BatchInit(SCHEDULE);
+  for (int i = 0; i < 2; i++) {
+    MyCoroutine::BatchAdd(SCHEDULE, batchId, CoroutineLocalBatchChild, &childArgs[i]);
+  }
+  MyCoroutine::BatchRun(SCHEDULE, batchId);
+}
+
+void CoroutineLocalSetOnly(void* arg) { LocalInt.Set(*(int*)arg); }
+
+// batch中的协程没有设置本地变量时，读取的是插入batch卡点的协程的值，而不是协程上一次运行时设置的值
+TEST_CASE(CoroutineLocal_BatchShare) {
+  int childArgs[2] = {0, 0};
+  int oldValue = 1;
+  MyCoroutine::ScheduleInit(SCHEDULE, 3, 8 * 1024);
+  for (int i = 0; i < 3; i++) {
+    MyCoroutine::CoroutineCreate(SCHEDULE, CoroutineLocalSetOnly, &oldValue);
+  }
+  while (MyCoroutine::ScheduleRunning(SCHEDULE)) {
+    MyCoroutine::CoroutineResume(SCHEDULE);
+  }
+  MyCoroutine::CoroutineCreate(SCHEDULE, CoroutineLocalBatchParent, childArgs);
+  while (MyCoroutine::ScheduleRunning(SCHEDULE)) {
+    MyCoroutine::CoroutineResume(SCHEDULE);
+  }
+  ASSERT_EQ(childArgs[0], 666);
+  ASSERT_EQ(childArgs[1], 666);
+  MyCoroutine::ScheduleClean(SCHEDULE);
+}
+
+void CoroutineLocalGetLoop(void* arg) {
+  int loop = *(int*)arg;
+  LocalInt.Set(1);
+  int64_t sum = 0;
+  Common::TimeStat timeStat;
+  for (int i = 0; i < loop; i++) {
+    sum += LocalInt.Get();
+  }
+  int64_t spendUs = timeStat.GetSpendTimeUs();
+  std::cout << "coroutine local get cost = " << spendUs * 1000.0 / loop << "ns" << std::endl;
+  *(int*)arg = (sum == loop) ? 1 : 0;
+}
+
+TEST_CASE(CoroutineLocal_GetBenchmark) {
+  int loop = 10000000;
+  MyCoroutine::ScheduleInit(SCHEDULE, 1, 8 * 1024);
+  MyCoroutine::CoroutineCreate(SCHEDULE, CoroutineLocalGetLoop, &loop);
+  MyCoroutine::CoroutineResume(SCHEDULE);
+  ASSERT_EQ(loop, 1);
+  MyCoroutine::ScheduleClean(SCHEDULE);
+}
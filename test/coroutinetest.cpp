@@ -0,0 +1,424 @@
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <thread>
+
+#include "../common/timedeal.hpp"
+#include "../core/coroutine.h"
+#include "unittestcore.h"
+
+void CoroutineCount(void* arg) { (*(int*)arg)++; }
+
+void CoroutineYieldOnce(void* arg) {
+  MyCoroutine::CoroutineYield(SCHEDULE);
+  (*(int*)arg)++;
+}
+
+TEST_CASE(Coroutine_CreateAndCanCreate) {
+  int count = 0;
+  MyCoroutine::ScheduleInit(SCHEDULE, 3, 8 * 1024);
+  int cid1 = MyCoroutine::CoroutineCreate(SCHEDULE, CoroutineYieldOnce, &count);
+  int cid2 = MyCoroutine::CoroutineCreate(SCHEDULE, CoroutineYieldOnce, &count);
+  int cid3 = MyCoroutine::CoroutineCreate(SCHEDULE, CoroutineYieldOnce, &count);
+  ASSERT_NE(cid1, MyCoroutine::INVALID_ROUTINE_ID);
+  ASSERT_NE(cid2, MyCoroutine::INVALID_ROUTINE_ID);
+  ASSERT_NE(cid3, MyCoroutine::INVALID_ROUTINE_ID);
+  ASSERT_FALSE(MyCoroutine::CoroutineCanCreate(SCHEDULE));
+  ASSERT_EQ(MyCoroutine::CoroutineCreate(SCHEDULE, CoroutineYieldOnce, &count), MyCoroutine::INVALID_ROUTINE_ID);
+  ASSERT_EQ(MyCoroutine::CoroutineResumeById(SCHEDULE, cid2), MyCoroutine::Success);
+  ASSERT_EQ(MyCoroutine::CoroutineResumeById(SCHEDULE, cid2), MyCoroutine::Success);  // cid2执行完，变成idle
+  ASSERT_EQ(count, 1);
+  ASSERT_TRUE(MyCoroutine::CoroutineCanCreate(SCHEDULE));
+  ASSERT_EQ(MyCoroutine::CoroutineCreate(SCHEDULE, CoroutineYieldOnce, &count), cid2);  // 复用刚刚释放的协程
+  while (MyCoroutine::ScheduleRunning(SCHEDULE)) {
+    MyCoroutine::CoroutineResume(SCHEDULE);
+  }
+  ASSERT_EQ(count, 4);
+  ASSERT_TRUE(MyCoroutine::CoroutineCanCreate(SCHEDULE));
+  MyCoroutine::ScheduleClean(SCHEDULE);
+}
+
+// 协程池中几乎所有的协程都处于非idle状态时，创建协程的耗时不应该随协程池的大小增长
+TEST_CASE(Coroutine_CreateBenchmark) {
+  int sizes[] = {1000, 10000, 100000};
+  for (int size : sizes) {
+    int count = 0;
+    MyCoroutine::ScheduleInit(SCHEDULE, size, 2 * 1024);
+    MyCoroutine::ScheduleDisableStackCheck(SCHEDULE);
+    for (int i = 0; i < size - 1; i++) {  // 只保留一个空闲的协程
+      MyCoroutine::CoroutineCreate(SCHEDULE, CoroutineCount, &count);
+    }
+    constexpr int loop = 100000;
+    Common::TimeStat timeStat;
+    for (int i = 0; i < loop; i++) {
+      ASSERT_TRUE(MyCoroutine::CoroutineCanCreate(SCHEDULE));
+      int cid = MyCoroutine::CoroutineCreate(SCHEDULE, CoroutineCount, &count);
+      ASSERT_NE(cid, MyCoroutine::INVALID_ROUTINE_ID);
+      MyCoroutine::CoroutineResumeById(SCHEDULE, cid);
+    }
+    int64_t spendUs = timeStat.GetSpendTimeUs();
+    ASSERT_EQ(count, loop);
+    std::cout << "coroutine_count = " << size << ", create + run cost = " << spendUs * 1000 / loop << "ns"
+              << std::endl;
+    MyCoroutine::ScheduleClean(SCHEDULE);
+  }
+}
+
+std::vector<int> ResumeOrder;
+void CoroutineRecordOrder(void* arg) { ResumeOrder.push_back(*(int*)arg); }
+
+TEST_CASE(Coroutine_ResumeByPriority) {
+  int args[] = {5, 1, 3, 1};
+  ResumeOrder.clear();
+  MyCoroutine::ScheduleInit(SCHEDULE, 10, 8 * 1024);
+  for (int i = 0; i < 4; i++) {
+    MyCoroutine::CoroutineCreate(SCHEDULE, CoroutineRecordOrder, &args[i], args[i]);
+  }
+  while (MyCoroutine::CoroutineResume(SCHEDULE) == MyCoroutine::Success) {
+  }
+  ASSERT_EQ(ResumeOrder.size(), 4);
+  ASSERT_EQ(ResumeOrder[0], 1);
+  ASSERT_EQ(ResumeOrder[1], 1);
+  ASSERT_EQ(ResumeOrder[2], 3);
+  ASSERT_EQ(ResumeOrder[3], 5);
+  ASSERT_FALSE(MyCoroutine::ScheduleRunning(SCHEDULE));
+  MyCoroutine::ScheduleClean(SCHEDULE);
+}
+
+void CoroutineBatchChild(void* arg) {
+  MyCoroutine::CoroutineYield(SCHEDULE);
+  ResumeOrder.push_back(*(int*)arg);
+}
+
+void CoroutineBatchParent(void* arg) {
+  static int childArgs[] = {1, 2, 3};
+  int batchId = MyCoroutine::BatchInit(SCHEDULE);
+  for (int i = 0; i < 3; i++) {
+    MyCoroutine::BatchAdd(SCHEDULE, batchId, CoroutineBatchChild, &childArgs[i]);
+  }
+  MyCoroutine::BatchRun(SCHEDULE, batchId);
+  ResumeOrder.push_back(*(int*)arg);
+}
+
+TEST_CASE(Coroutine_ResumeBatchPreference) {
+  int parentArg = 100;
+  ResumeOrder.clear();
+  MyCoroutine::ScheduleInit(SCHEDULE, 10, 8 * 1024);
+  MyCoroutine::CoroutineCreate(SCHEDULE, CoroutineBatchParent, &parentArg);
+  while (MyCoroutine::ScheduleRunning(SCHEDULE)) {
+    // 和事件循环一样，优先唤醒batch执行完的协程
+    if (MyCoroutine::CoroutineResumeBatchFinish(SCHEDULE) != MyCoroutine::Success) {
+      MyCoroutine::CoroutineResume(SCHEDULE);
+    }
+  }
+  // 被插入batch卡点的协程，要等batch中所有的协程都执行完才会被调度
+  ASSERT_EQ(ResumeOrder.size(), 4);
+  ASSERT_EQ(ResumeOrder[3], 100);
+  ASSERT_EQ(MyCoroutine::CoroutineResumeBatchFinish(SCHEDULE), MyCoroutine::NotRunnable);
+  MyCoroutine::ScheduleClean(SCHEDULE);
+}
+
+void CoroutineYieldLoop(void* arg) {
+  int loop = *(int*)arg;
+  for (int i = 0; i < loop; i++) {
+    MyCoroutine::CoroutineYield(SCHEDULE);
+  }
+}
+
+// 协程池中绝大部分协程都是idle状态时，resume的耗时不应该随协程池的大小增长
+TEST_CASE(Coroutine_ResumeBenchmark) {
+  int sizes[] = {1000, 10000, 100000};
+  for (int size : sizes) {
+    int loop = 100000;
+    MyCoroutine::ScheduleInit(SCHEDULE, size, 8 * 1024);
+    MyCoroutine::CoroutineCreate(SCHEDULE, CoroutineYieldLoop, &loop);
+    Common::TimeStat timeStat;
+    int count = 0;
+    while (MyCoroutine::CoroutineResume(SCHEDULE) == MyCoroutine::Success) {
+      count++;
+    }
+    int64_t spendUs = timeStat.GetSpendTimeUs();
+    ASSERT_EQ(count, loop + 1);
+    std::cout << "coroutine_count = " << size << ", resume cost = " << spendUs * 1000 / count << "ns" << std::endl;
+    MyCoroutine::ScheduleClean(SCHEDULE);
+  }
+}
+
+void CoroutineYieldAndSum(void* arg) {
+  double sum = 0;
+  for (int i = 1; i <= 100; i++) {
+    sum += i * 0.5;
+    MyCoroutine::CoroutineYield(SCHEDULE);
+  }
+  *(double*)arg = sum;
+}
+
+TEST_CASE(Coroutine_SwitchMode) {
+  MyCoroutine::SwitchMode modes[] = {MyCoroutine::UContext, MyCoroutine::Assembly};
+  for (auto mode : modes) {
+    double sums[3] = {0, 0, 0};
+    MyCoroutine::ScheduleInit(SCHEDULE, 10, 8 * 1024, mode);
+    for (int i = 0; i < 3; i++) {
+      MyCoroutine::CoroutineCreate(SCHEDULE, CoroutineYieldAndSum, &sums[i]);
+    }
+    while (MyCoroutine::ScheduleRunning(SCHEDULE)) {
+      MyCoroutine::CoroutineResume(SCHEDULE);
+    }
+    for (int i = 0; i < 3; i++) {
+      ASSERT_EQ(sums[i], 2525);
+    }
+    MyCoroutine::ScheduleClean(SCHEDULE);
+  }
+}
+
+// 对比ucontext和汇编两种上下文切换方式的耗时，一次resume + 一次yield是两次切换
+TEST_CASE(Coroutine_SwitchBenchmark) {
+  MyCoroutine::SwitchMode modes[] = {MyCoroutine::UContext, MyCoroutine::Assembly};
+  const char* names[] = {"ucontext", "assembly"};
+  for (int i = 0; i < 2; i++) {
+    int loop = 1000000;
+    MyCoroutine::ScheduleInit(SCHEDULE, 10, 8 * 1024, modes[i]);
+    int cid = MyCoroutine::CoroutineCreate(SCHEDULE, CoroutineYieldLoop, &loop);
+    Common::TimeStat timeStat;
+    while (MyCoroutine::CoroutineResumeById(SCHEDULE, cid) == MyCoroutine::Success) {
+    }
+    int64_t spendUs = timeStat.GetSpendTimeUs();
+    std::cout << names[i] << " switch cost = " << spendUs * 1000 / (2 * (loop + 1)) << "ns" << std::endl;
+    MyCoroutine::ScheduleClean(SCHEDULE);
+  }
+}
+
+void CoroutineStackData(void* arg) {
+  int base = *(int*)arg;
+  int data[256];  // 栈上的数据在协程切出再切回之后要保持不变
+  for (int i = 0; i < 256; i++) {
+    data[i] = base + i;
+  }
+  for (int i = 0; i < 10; i++) {
+    MyCoroutine::CoroutineYield(SCHEDULE);
+  }
+  int sum = 0;
+  for (int i = 0; i < 256; i++) {
+    sum += data[i] - base;
+  }
+  *(int*)arg = sum;
+}
+
+TEST_CASE(Coroutine_SharedStack) {
+  int args[8];
+  for (int i = 0; i < 8; i++) {
+    args[i] = i * 1000;
+  }
+  MyCoroutine::ScheduleInit(SCHEDULE, 8, 8 * 1024, MyCoroutine::DEFAULT_SWITCH_MODE, 2);
+  for (int i = 0; i < 8; i++) {
+    MyCoroutine::CoroutineCreate(SCHEDULE, CoroutineStackData, &args[i]);
+  }
+  while (MyCoroutine::ScheduleRunning(SCHEDULE)) {
+    MyCoroutine::CoroutineResume(SCHEDULE);
+  }
+  for (int i = 0; i < 8; i++) {
+    ASSERT_EQ(args[i], 255 * 256 / 2);
+  }
+  MyCoroutine::ScheduleClean(SCHEDULE);
+}
+
+// 对比私有栈和共享栈两种模式下协程池的栈内存占用和切换耗时，共享栈模式每次切换都需要换出换入栈内容
+TEST_CASE(Coroutine_SharedStackBenchmark) {
+  int sharedStackCnts[] = {0, 1, 16};
+  for (int sharedStackCnt : sharedStackCnts) {
+    constexpr int size = 10000;
+    int loop = 100;
+    MyCoroutine::ScheduleInit(SCHEDULE, size, 64 * 1024, MyCoroutine::DEFAULT_SWITCH_MODE, sharedStackCnt);
+    for (int i = 0; i < size; i++) {
+      MyCoroutine::CoroutineCreate(SCHEDULE, CoroutineYieldLoop, &loop);
+    }
+    Common::TimeStat timeStat;
+    int count = 0;
+    while (MyCoroutine::CoroutineResume(SCHEDULE) == MyCoroutine::Success) {
+      count++;
+    }
+    int64_t spendUs = timeStat.GetSpendTimeUs();
+    ASSERT_EQ(count, size * (loop + 1));
+    std::cout << "shared_stack_count = " << sharedStackCnt
+              << ", stack memory resident = " << MyCoroutine::ScheduleStackMemory(SCHEDULE) / 1024 / 1024
+              << "MB, nominal = " << MyCoroutine::ScheduleStackNominalMemory(SCHEDULE) / 1024 / 1024 << "MB"
+              << ", switch cost = " << spendUs * 1000 / (2 * count) << "ns" << std::endl;
+    MyCoroutine::ScheduleClean(SCHEDULE);
+  }
+}
+
+int CoroutineRecursion(int depth) {
+  volatile char buf[1024];
+  buf[0] = (char)depth;
+  return depth <= 0 ? buf[0] : CoroutineRecursion(depth - 1) + buf[0];
+}
+
+void CoroutineStackOverflow(void* arg) { *(int*)arg = CoroutineRecursion(1024); }
+
+// 栈溢出时访问到保护页，进程立即收到SIGSEGV，而不是等到协程执行完之后才由canary检测出来
+TEST_CASE(Coroutine_StackGuardPage) {
+  pid_t pid = fork();
+  ASSERT_GE(pid, 0);
+  if (0 == pid) {
+    int result = 0;
+    MyCoroutine::ScheduleInit(SCHEDULE, 1, 64 * 1024);
+    MyCoroutine::CoroutineCreate(SCHEDULE, CoroutineStackOverflow, &result);
+    MyCoroutine::CoroutineResume(SCHEDULE);
+    _exit(0);
+  }
+  int status = 0;
+  waitpid(pid, &status, 0);
+  ASSERT_TRUE(WIFSIGNALED(status));
+  ASSERT_EQ(WTERMSIG(status), SIGSEGV);
+}
+
+int64_t ProcessRssKB() {
+  int64_t size = 0, resident = 0;
+  std::ifstream statm("/proc/self/statm");
+  statm >> size >> resident;
+  return resident * sysconf(_SC_PAGESIZE) / 1024;
+}
+
+void CoroutineTouchStack(void* arg) {
+  volatile char buf[8 * 1024];  // 模拟处理请求时实际使用的栈空间
+  buf[0] = 1;
+  MyCoroutine::CoroutineYield(SCHEDULE);
+  *(int*)arg += buf[0];
+}
+
+// 名义栈大小为256KB时，物理内存只和实际使用的栈空间相关，冷的协程栈可以通过madvise归还
+TEST_CASE(Coroutine_StackLazyCommit) {
+  constexpr int size = 2000;
+  int count = 0;
+  int64_t beginRss = ProcessRssKB();
+  MyCoroutine::ScheduleInit(SCHEDULE, size, 256 * 1024);
+  for (int i = 0; i < size; i++) {
+    MyCoroutine::CoroutineCreate(SCHEDULE, CoroutineTouchStack, &count);
+  }
+  while (MyCoroutine::ScheduleRunning(SCHEDULE)) {
+    MyCoroutine::CoroutineResume(SCHEDULE);
+  }
+  ASSERT_EQ(count, size);
+  int64_t usedRss = ProcessRssKB() - beginRss;
+  int64_t nominal = MyCoroutine::ScheduleStackNominalMemory(SCHEDULE) / 1024;
+  int64_t resident = MyCoroutine::ScheduleStackMemory(SCHEDULE) / 1024;
+  ASSERT_LT(usedRss, nominal / 4);
+  ASSERT_LT(resident, nominal / 4);
+  ASSERT_GE(resident, size * 8);  // 每个协程至少实际使用了8KB的栈
+  for (int i = 0; i < 1024 + size / 25 + 10; i++) {  // 先让空闲协程数的统计生效，再分批归还全部空闲协程栈
+    MyCoroutine::ScheduleTryReleaseMemory(SCHEDULE);
+  }
+  ASSERT_EQ(MyCoroutine::ScheduleStackMemory(SCHEDULE), 0);
+  ASSERT_EQ(MyCoroutine::ScheduleStackNominalMemory(SCHEDULE), 0);
+  int64_t releasedRss = ProcessRssKB() - beginRss;
+  ASSERT_LT(releasedRss, usedRss);
+  std::cout << "nominal stack memory = " << nominal / 1024 << "MB, resident = " << resident / 1024
+            << "MB, rss after run = " << usedRss / 1024
+            << "MB, rss after release = " << releasedRss / 1024 << "MB" << std::endl;
+  count = 0;
+  for (int i = 0; i < size; i++) {  // 归还之后的协程栈可以继续使用
+    MyCoroutine::CoroutineCreate(SCHEDULE, CoroutineTouchStack, &count);
+  }
+  while (MyCoroutine::ScheduleRunning(SCHEDULE)) {
+    MyCoroutine::CoroutineResume(SCHEDULE);
+  }
+  ASSERT_EQ(count, size);
+  MyCoroutine::ScheduleClean(SCHEDULE);
+}
+
+int CoroutineUseStackDepth(int depth) {
+  volatile char buf[1024];  // 每层递归大约使用1KB的栈空间
+  buf[0] = (char)depth;
+  if (depth <= 1) {
+    MyCoroutine::CoroutineYield(SCHEDULE);
+    return buf[0];
+  }
+  return CoroutineUseStackDepth(depth - 1) + buf[0];
+}
+
+void CoroutineUseStack(void* arg) {
+  int kb = *(int*)arg;
+  MyCoroutine::CoroutineSetStackTag(SCHEDULE, "use_" + std::to_string(kb) + "k");
+  CoroutineUseStackDepth(kb);
+}
+
+TEST_CASE(Coroutine_StackProfile) {
+  int kbs[] = {4, 16};
+  MyCoroutine::ScheduleInit(SCHEDULE, 10, 128 * 1024);
+  MyCoroutine::ScheduleSetStackProfile(SCHEDULE, MyCoroutine::StackProfileOn);
+  for (int i = 0; i < 100; i++) {
+    MyCoroutine::CoroutineCreate(SCHEDULE, CoroutineUseStack, &kbs[i % 2]);
+    while (MyCoroutine::ScheduleRunning(SCHEDULE)) {
+      MyCoroutine::CoroutineResume(SCHEDULE);
+    }
+  }
+  auto& profile = MyCoroutine::ScheduleStackProfile(SCHEDULE);
+  ASSERT_EQ(profile.size(), 3);
+  ASSERT_EQ(profile.at("all").count, 100);
+  ASSERT_EQ(profile.at("use_4k").count, 50);
+  ASSERT_EQ(profile.at("use_16k").count, 50);
+  int32_t use4k = MyCoroutine::StackUsagePercentile(profile.at("use_4k"), 0.999);
+  int32_t use16k = MyCoroutine::StackUsagePercentile(profile.at("use_16k"), 0.999);
+  ASSERT_GE(use4k, 4 * 1024);
+  ASSERT_LT(use4k, 16 * 1024);  // 剩余的是buf之外的栈帧
+  ASSERT_GE(use16k, 16 * 1024);
+  ASSERT_LT(use16k, 28 * 1024);
+  ASSERT_EQ(MyCoroutine::StackUsagePercentile(profile.at("all"), 0.999), use16k);
+  MyCoroutine::ScheduleClean(SCHEDULE);
+}
+
+// 自动调整栈大小之后，新协程的栈大小按p99.9的使用量加上余量确定，而不是ScheduleInit设置的大小
+TEST_CASE(Coroutine_StackAutoSize) {
+  int kb = 4;
+  MyCoroutine::ScheduleInit(SCHEDULE, 10, 1024 * 1024);
+  MyCoroutine::ScheduleSetStackProfile(SCHEDULE, MyCoroutine::StackProfileAutoSize);
+  for (int i = 0; i < MyCoroutine::STACK_AUTO_SIZE_SAMPLE; i++) {
+    MyCoroutine::CoroutineCreate(SCHEDULE, CoroutineUseStack, &kb);
+    while (MyCoroutine::ScheduleRunning(SCHEDULE)) {
+      MyCoroutine::CoroutineResume(SCHEDULE);
+    }
+  }
+  int64_t before = MyCoroutine::ScheduleStackNominalMemory(SCHEDULE);
+  for (int i = 0; i < 10; i++) {
+    MyCoroutine::CoroutineCreate(SCHEDULE, CoroutineUseStack, &kb);
+  }
+  while (MyCoroutine::ScheduleRunning(SCHEDULE)) {
+    MyCoroutine::CoroutineResume(SCHEDULE);
+  }
+  int64_t after = MyCoroutine::ScheduleStackNominalMemory(SCHEDULE);
+  std::cout << "stack size before auto size = " << before / 1024 << "KB, after = " << after / 10 / 1024 << "KB"
+            << std::endl;
+  ASSERT_LT(after / 10, 64 * 1024);
+  ASSERT_GE(after / 10, 4 * 1024 + MyCoroutine::STACK_AUTO_SIZE_HEADROOM);
+  MyCoroutine::ScheduleClean(SCHEDULE);
+}
+
+void CoroutineThreadRun(int* count) {
+  MyCoroutine::ScheduleInit(SCHEDULE, 100, 8 * 1024);
+  for (int round = 0; round < 100; round++) {
+    for (int i = 0; i < 100; i++) {
+      MyCoroutine::CoroutineCreate(SCHEDULE, CoroutineYieldOnce, count);
+    }
+    while (MyCoroutine::ScheduleRunning(SCHEDULE)) {
+      MyCoroutine::CoroutineResume(SCHEDULE);
+    }
+  }
+  MyCoroutine::ScheduleClean(SCHEDULE);
+}
+
+// 每个线程都有自己的调度器，多个subReactor线程可以同时调度各自的协程
+TEST_CASE(Coroutine_ThreadLocalSchedule) {
+  int counts[4] = {0, 0, 0, 0};
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; i++) {
+    threads.emplace_back(CoroutineThreadRun, &counts[i]);
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (int i = 0; i < 4; i++) {
+    ASSERT_EQ(counts[i], 100 * 100);
+  }
+}
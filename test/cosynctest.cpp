@@ -0,0 +1,238 @@
+#include <unistd.h>
+#include <algorithm>
+#include <vector>
+
+#include "../core/cosync.hpp"
+#include "../core/waitgroup.hpp"
+#include "unittestcore.h"
+
+// 模拟subReactor的调度：唤醒被标记的协程，以及主动让出cpu的协程
+void CoSyncRunAll() {
+  while (MyCoroutine::ScheduleRunning(SCHEDULE)) {
+    if (MyCoroutine::CoroutineResumeWakeUp(SCHEDULE) != MyCoroutine::Success) {
+      MyCoroutine::CoroutineResume(SCHEDULE);
+    }
+  }
+}
+
+// 模拟subReactor的定时器处理
+void CoSyncRunTimer() {
+  Core::TimerData timerData;
+  while (MyCoroutine::ScheduleRunning(SCHEDULE) && TIMER.GetLastTimer(timerData)) {
+    usleep(TIMER.TimeOutMs(timerData) * 1000);
+    TIMER.Run(timerData);
+    while (MyCoroutine::CoroutineResumeWakeUp(SCHEDULE) == MyCoroutine::Success) {
+    }
+  }
+}
+
+typedef struct MutexArg {
+  Core::CoMutex* mutex_;
+  std::vector<int>* order_;
+  int id_;
+} MutexArg;
+
+void CoMutexHolder(void* arg) {
+  MutexArg* mutexArg = (MutexArg*)arg;
+  Core::CoLockGuard guard(*mutexArg->mutex_);
+  MyCoroutine::CoroutineYield(SCHEDULE);  // 持有锁时让出cpu
+  mutexArg->order_->push_back(mutexArg->id_);
+}
+
+// 等待者按加锁的先后顺序获得锁
+TEST_CASE(CoMutex_FifoHandOff) {
+  Core::CoMutex mutex;
+  std::vector<int> order;
+  MutexArg args[4] = {{&mutex, &order, 0}, {&mutex, &order, 1}, {&mutex, &order, 2}, {&mutex, &order, 3}};
+  MyCoroutine::ScheduleInit(SCHEDULE, 4, 8 * 1024);
+  for (int i = 0; i < 4; i++) {
+    int cid = MyCoroutine::CoroutineCreate(SCHEDULE, CoMutexHolder, &args[i]);
+    MyCoroutine::CoroutineResumeById(SCHEDULE, cid);
+  }
+  CoSyncRunAll();
+  ASSERT_EQ(order.size(), 4);
+  for (int i = 0; i < 4; i++) {
+    ASSERT_EQ(order[i], i);
+  }
+  ASSERT_FALSE(mutex.IsLocked());
+  MyCoroutine::ScheduleClean(SCHEDULE);
+}
+
+void CoMutexLockFor(void* arg) {
+  Core::CoMutex* mutex = (Core::CoMutex*)arg;
+  if (not mutex->LockFor(10)) {
+    mutex->Unlock();  // 超时之后由测试协程释放锁，验证没有被错误地交给超时的等待者
+  }
+}
+
+TEST_CASE(CoMutex_LockTimeOut) {
+  Core::CoMutex mutex;
+  mutex.Lock();  // 主协程中加锁不会挂起
+  MyCoroutine::ScheduleInit(SCHEDULE, 1, 8 * 1024);
+  int cid = MyCoroutine::CoroutineCreate(SCHEDULE, CoMutexLockFor, &mutex);
+  MyCoroutine::CoroutineResumeById(SCHEDULE, cid);
+  ASSERT_TRUE(MyCoroutine::ScheduleRunning(SCHEDULE));
+  CoSyncRunTimer();
+  ASSERT_FALSE(MyCoroutine::ScheduleRunning(SCHEDULE));
+  ASSERT_FALSE(mutex.IsLocked());
+  MyCoroutine::ScheduleClean(SCHEDULE);
+}
+
+typedef struct LimitArg {
+  Core::CoSemaphore* semaphore_;
+  int running_;
+  int max_running_;
+  int finish_;
+} LimitArg;
+
+void CoSemaphoreCall(void* arg) {
+  LimitArg* limitArg = (LimitArg*)arg;
+  Core::CoSemaphoreGuard guard(*limitArg->semaphore_);
+  limitArg->running_++;
+  limitArg->max_running_ = std::max(limitArg->max_running_, limitArg->running_);
+  MyCoroutine::CoroutineYield(SCHEDULE);  // 模拟下游调用
+  limitArg->running_--;
+  limitArg->finish_++;
+}
+
+// 信号量作为并发限制，同时在执行的下游调用不超过信号量的初始值
+TEST_CASE(CoSemaphore_ConcurrencyLimit) {
+  Core::CoSemaphore semaphore(2);
+  LimitArg limitArg{&semaphore, 0, 0, 0};
+  MyCoroutine::ScheduleInit(SCHEDULE, 10, 8 * 1024);
+  for (int i = 0; i < 10; i++) {
+    int cid = MyCoroutine::CoroutineCreate(SCHEDULE, CoSemaphoreCall, &limitArg);
+    MyCoroutine::CoroutineResumeById(SCHEDULE, cid);
+  }
+  ASSERT_EQ(semaphore.Waiting(), 8);
+  CoSyncRunAll();
+  ASSERT_EQ(limitArg.finish_, 10);
+  ASSERT_EQ(limitArg.max_running_, 2);
+  ASSERT_EQ(semaphore.Available(), 2);
+  MyCoroutine::ScheduleClean(SCHEDULE);
+}
+
+void CoSemaphoreHolder(void* arg) {
+  Core::CoSemaphoreGuard guard(*(Core::CoSemaphore*)arg);
+  MyCoroutine::CoroutineYield(SCHEDULE);  // 持有许可时让出cpu
+}
+
+void CoSemaphoreFastCall(void* arg) {
+  LimitArg* limitArg = (LimitArg*)arg;
+  Core::CoSemaphoreGuard guard(*limitArg->semaphore_);
+  limitArg->running_++;
+  limitArg->max_running_ = std::max(limitArg->max_running_, limitArg->running_);
+  limitArg->running_--;
+  limitArg->finish_++;
+}
+
+void CoSemaphoreFanOut(void* arg) {
+  LimitArg* limitArg = (LimitArg*)arg;
+  Core::WaitGroup wg;
+  for (int i = 0; i < 3; i++) {
+    wg.Add(CoSemaphoreFastCall, limitArg);
+  }
+  wg.Wait();
+  limitArg->finish_ = -limitArg->finish_;  // Wait返回时所有子协程都执行完了
+}
+
+// 信号量在WaitGroup中作为下游调用的并发限制，子协程通过许可的移交被唤醒并执行完之后，等待的协程也要被恢复
+TEST_CASE(CoSemaphore_WaitGroupLimit) {
+  Core::CoSemaphore semaphore(1);
+  LimitArg limitArg{&semaphore, 0, 0, 0};
+  MyCoroutine::ScheduleInit(SCHEDULE, 5, 8 * 1024);
+  int holder = MyCoroutine::CoroutineCreate(SCHEDULE, CoSemaphoreHolder, &semaphore);
+  MyCoroutine::CoroutineResumeById(SCHEDULE, holder);
+  int parent = MyCoroutine::CoroutineCreate(SCHEDULE, CoSemaphoreFanOut, &limitArg);
+  MyCoroutine::CoroutineResumeById(SCHEDULE, parent);
+  MyCoroutine::CoroutineResumeInBatch(SCHEDULE, parent);
+  ASSERT_EQ(semaphore.Waiting(), 3);
+  MyCoroutine::CoroutineResumeById(SCHEDULE, holder);  // 释放许可，移交给第一个等待的子协程
+  while (MyCoroutine::CoroutineResumeWakeUp(SCHEDULE) == MyCoroutine::Success) {
+  }
+  ASSERT_EQ(limitArg.finish_, -3);
+  ASSERT_EQ(limitArg.max_running_, 1);
+  ASSERT_EQ(semaphore.Available(), 1);
+  ASSERT_FALSE(MyCoroutine::ScheduleRunning(SCHEDULE));
+  MyCoroutine::ScheduleClean(SCHEDULE);
+}
+
+void CoSemaphoreAcquireFor(void* arg) {
+  Core::CoSemaphore* semaphore = (Core::CoSemaphore*)arg;
+  if (semaphore->AcquireFor(10)) {
+    semaphore->Release();
+  }
+}
+
+TEST_CASE(CoSemaphore_AcquireTimeOut) {
+  Core::CoSemaphore semaphore(0);
+  MyCoroutine::ScheduleInit(SCHEDULE, 2, 8 * 1024);
+  for (int i = 0; i < 2; i++) {
+    int cid = MyCoroutine::CoroutineCreate(SCHEDULE, CoSemaphoreAcquireFor, &semaphore);
+    MyCoroutine::CoroutineResumeById(SCHEDULE, cid);
+  }
+  ASSERT_EQ(semaphore.Waiting(), 2);
+  CoSyncRunTimer();
+  ASSERT_FALSE(MyCoroutine::ScheduleRunning(SCHEDULE));
+  ASSERT_EQ(semaphore.Waiting(), 0);
+  ASSERT_EQ(semaphore.Available(), 0);
+  MyCoroutine::ScheduleClean(SCHEDULE);
+}
+
+typedef struct CondArg {
+  Core::CoMutex mutex_;
+  Core::CoCondVar cond_;
+  int ready_{0};
+  int consume_{0};
+} CondArg;
+
+void CoCondVarWaiter(void* arg) {
+  CondArg* condArg = (CondArg*)arg;
+  Core::CoLockGuard guard(condArg->mutex_);
+  condArg->cond_.Wait(condArg->mutex_, [condArg]() { return condArg->ready_ > 0; });
+  condArg->ready_--;
+  condArg->consume_++;
+}
+
+void CoCondVarNotifier(void* arg) {
+  CondArg* condArg = (CondArg*)arg;
+  Core::CoLockGuard guard(condArg->mutex_);
+  condArg->ready_ = 3;
+  condArg->cond_.NotifyAll();
+}
+
+TEST_CASE(CoCondVar_NotifyAll) {
+  CondArg condArg;
+  MyCoroutine::ScheduleInit(SCHEDULE, 4, 8 * 1024);
+  for (int i = 0; i < 3; i++) {
+    int cid = MyCoroutine::CoroutineCreate(SCHEDULE, CoCondVarWaiter, &condArg);
+    MyCoroutine::CoroutineResumeById(SCHEDULE, cid);
+  }
+  ASSERT_EQ(condArg.consume_, 0);
+  int cid = MyCoroutine::CoroutineCreate(SCHEDULE, CoCondVarNotifier, &condArg);
+  MyCoroutine::CoroutineResumeById(SCHEDULE, cid);
+  CoSyncRunAll();
+  ASSERT_EQ(condArg.consume_, 3);
+  ASSERT_FALSE(condArg.mutex_.IsLocked());
+  MyCoroutine::ScheduleClean(SCHEDULE);
+}
+
+void CoCondVarWaitFor(void* arg) {
+  CondArg* condArg = (CondArg*)arg;
+  Core::CoLockGuard guard(condArg->mutex_);
+  if (not condArg->cond_.WaitFor(condArg->mutex_, 10)) {
+    condArg->consume_ = -1;
+  }
+}
+
+TEST_CASE(CoCondVar_WaitTimeOut) {
+  CondArg condArg;
+  MyCoroutine::ScheduleInit(SCHEDULE, 1, 8 * 1024);
+  int cid = MyCoroutine::CoroutineCreate(SCHEDULE, CoCondVarWaitFor, &condArg);
+  MyCoroutine::CoroutineResumeById(SCHEDULE, cid);
+  ASSERT_FALSE(condArg.mutex_.IsLocked());  // 等待时释放了锁
+  CoSyncRunTimer();
+  ASSERT_EQ(condArg.consume_, -1);
+  ASSERT_FALSE(condArg.mutex_.IsLocked());
+  MyCoroutine::ScheduleClean(SCHEDULE);
+}
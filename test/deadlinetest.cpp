@@ -0,0 +1,67 @@
+#include "../core/deadline.hpp"
+#include "../core/mysvrclient.hpp"
+#include "../service/echo/proto/echo.pb.h"
+#include "unittestcore.h"
+
+typedef struct DeadlineArg {
+  int64_t deadline_ms_;
+  Core::TimeOut time_out_;
+  int64_t call_deadline_ms_;
+  int ret_;
+} DeadlineArg;
+
+void DeadlineShrink(void* arg) {
+  DeadlineArg* deadlineArg = (DeadlineArg*)arg;
+  MySvr::Base::Context ctx;
+  ctx.set_deadline_ms(deadlineArg->deadline_ms_);
+  ReqCtx.Set(ctx);
+  deadlineArg->call_deadline_ms_ = Core::Deadline::ForCall(deadlineArg->time_out_);
+  Core::Deadline::ShrinkTimeOut(deadlineArg->time_out_);
+}
+
+// 超时缩短到请求剩余的时间内，下游的截止时间不超过上游的截止时间
+TEST_CASE(Deadline_ShrinkTimeOut) {
+  DeadlineArg arg{Core::Deadline::NowMs() + 100, Core::TimeOut(), 0, 0};
+  MyCoroutine::ScheduleInit(SCHEDULE, 1, 64 * 1024);
+  MyCoroutine::CoroutineCreate(SCHEDULE, DeadlineShrink, &arg);
+  MyCoroutine::CoroutineResume(SCHEDULE);
+  ASSERT_TRUE(arg.time_out_.read_time_out_ms_ <= 100 && arg.time_out_.read_time_out_ms_ > 0);
+  ASSERT_TRUE(arg.time_out_.write_time_out_ms_ <= 100);
+  ASSERT_EQ(arg.time_out_.connect_time_out_ms_, 50);
+  ASSERT_EQ(arg.call_deadline_ms_, arg.deadline_ms_);
+  MyCoroutine::ScheduleClean(SCHEDULE);
+}
+
+// 没有截止时间时，超时配置不变，下游的截止时间按本次调用的超时计算
+TEST_CASE(Deadline_NoDeadline) {
+  DeadlineArg arg{0, Core::TimeOut(), 0, 0};
+  int64_t nowMs = Core::Deadline::NowMs();
+  MyCoroutine::ScheduleInit(SCHEDULE, 1, 64 * 1024);
+  MyCoroutine::CoroutineCreate(SCHEDULE, DeadlineShrink, &arg);
+  MyCoroutine::CoroutineResume(SCHEDULE);
+  ASSERT_EQ(arg.time_out_.read_time_out_ms_, 1000);
+  ASSERT_EQ(arg.time_out_.write_time_out_ms_, 1000);
+  ASSERT_TRUE(arg.call_deadline_ms_ >= nowMs + 2000);
+  MyCoroutine::ScheduleClean(SCHEDULE);
+}
+
+void DeadlineExpiredCall(void* arg) {
+  DeadlineArg* deadlineArg = (DeadlineArg*)arg;
+  MySvr::Base::Context ctx;
+  ctx.set_deadline_ms(deadlineArg->deadline_ms_);
+  ReqCtx.Set(ctx);
+  MySvr::Echo::EchoMySelfRequest request;
+  MySvr::Echo::EchoMySelfResponse response;
+  deadlineArg->ret_ = Core::MySvrClient().RpcCall(request, response);
+}
+
+// 请求已经超过截止时间，不再调用下游
+TEST_CASE(Deadline_ExpiredCallFailFast) {
+  DeadlineArg arg{Core::Deadline::NowMs() - 1, Core::TimeOut(), 0, 0};
+  MyCoroutine::ScheduleInit(SCHEDULE, 1, 64 * 1024);
+  MyCoroutine::CoroutineCreate(SCHEDULE, DeadlineExpiredCall, &arg);
+  MyCoroutine::CoroutineResume(SCHEDULE);
+  ASSERT_EQ(arg.ret_, DEADLINE_EXCEEDED);
+  ASSERT_FALSE(MyCoroutine::ScheduleRunning(SCHEDULE));
+  MyCoroutine::ScheduleClean(SCHEDULE);
+}
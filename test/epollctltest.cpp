@@ -0,0 +1,183 @@
+#include <assert.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <iostream>
+#include <thread>
+
+#include "../core/coroutineio.hpp"
+#include "../core/epollctl.hpp"
+#include "unittestcore.h"
+
+// 监听的事件没有变化时不调用epoll_ctl，ONESHOT触发之后才需要MOD重新激活
+TEST_CASE(EpollCtl_SetEventCache) {
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds), 0);
+  int epollFd = epoll_create(1);
+  Core::EventData eventData(fds[0], epollFd, Core::CLIENT);
+  int64_t count = Core::EpollCtl::CtlCount();
+  Core::EpollCtl::SetEvent(&eventData, EPOLLIN | EPOLLONESHOT);  // ADD
+  Core::EpollCtl::SetEvent(&eventData, EPOLLIN | EPOLLONESHOT);  // 没有变化
+  ASSERT_EQ(Core::EpollCtl::CtlCount() - count, 1);
+  ASSERT_EQ(write(fds[1], "x", 1), 1);
+  epoll_event events[4];
+  ASSERT_EQ(epoll_wait(epollFd, events, 4, 1000), 1);
+  Core::EpollCtl::Triggered((Core::EventData*)events[0].data.ptr, events[0].events);
+  ASSERT_EQ(eventData.interest_, 0);
+  ASSERT_EQ(epoll_wait(epollFd, events, 4, 0), 0);               // 触发之后内核禁用了监听
+  Core::EpollCtl::SetEvent(&eventData, EPOLLIN | EPOLLONESHOT);  // MOD重新激活
+  ASSERT_EQ(Core::EpollCtl::CtlCount() - count, 2);
+  ASSERT_EQ(epoll_wait(epollFd, events, 4, 0), 1);
+
+  int otherEpollFd = epoll_create(1);
+  eventData.epoll_fd_ = otherEpollFd;                            // 迁移到其他epoll实例
+  Core::EpollCtl::SetEvent(&eventData, EPOLLIN | EPOLLONESHOT);  // DEL + ADD
+  ASSERT_EQ(Core::EpollCtl::CtlCount() - count, 4);
+  ASSERT_EQ(eventData.registered_epoll_fd_, otherEpollFd);
+  Core::EpollCtl::RemoveEvent(&eventData, false);
+  Core::EpollCtl::RemoveEvent(&eventData, false);  // 没有注册时不调用epoll_ctl
+  ASSERT_EQ(Core::EpollCtl::CtlCount() - count, 5);
+  close(fds[0]);
+  close(fds[1]);
+  close(epollFd);
+  close(otherEpollFd);
+}
+
+typedef struct EpollCtlReadArg {
+  int fd_;
+  int epoll_fd_;
+  Core::EventData* conn_event_data_;
+  int loop_;
+  int read_count_;
+} EpollCtlReadArg;
+
+void EpollCtlReadLoop(void* arg) {
+  EpollCtlReadArg* readArg = (EpollCtlReadArg*)arg;
+  RpcTimeOut.Set(Core::TimeOut());
+  EpollFd.Set(readArg->epoll_fd_);
+  if (readArg->conn_event_data_) {
+    readArg->conn_event_data_->cid_ = MyCoroutine::ScheduleGetRunCid(SCHEDULE);
+  }
+  for (int i = 0; i < readArg->loop_; i++) {
+    char data;
+    if (Core::CoRead(readArg->fd_, &data, 1, readArg->conn_event_data_) == 1) {
+      readArg->read_count_++;
+    }
+  }
+}
+
+// 模拟subReactor的事件分发，每轮往对端写入1个字节，直到读协程结束
+void EpollCtlDispatch(EpollCtlReadArg& readArg, int peerFd) {
+  Core::TimerData timerData;
+  MyCoroutine::CoroutineResume(SCHEDULE);
+  while (MyCoroutine::ScheduleRunning(SCHEDULE)) {
+    assert(write(peerFd, "x", 1) == 1);
+    epoll_event events[4];
+    int num = epoll_wait(readArg.epoll_fd_, events, 4, 1000);
+    for (int i = 0; i < num; i++) {
+      Core::EventData* eventData = (Core::EventData*)events[i].data.ptr;
+      Core::EpollCtl::Triggered(eventData, events[i].events);
+      if (eventData->cid_ != MyCoroutine::INVALID_ROUTINE_ID) {
+        MyCoroutine::CoroutineResumeById(SCHEDULE, eventData->cid_);
+      }
+    }
+  }
+  while (TIMER.GetLastTimer(timerData)) {
+    TIMER.Run(timerData);
+  }
+}
+
+// 连接池中的长连接一直以边缘触发的方式注册，每次读等待都不需要epoll_ctl
+TEST_CASE(EpollCtl_PersistentEventRead) {
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds), 0);
+  SYSTEM.SetIoMock(nullptr);
+  EpollCtlReadArg readArg{fds[0], epoll_create(1), nullptr, 100, 0};
+  PERSISTENT_EVENT.Add(fds[0], readArg.epoll_fd_);
+  MyCoroutine::ScheduleInit(SCHEDULE, 10, 64 * 1024);
+  MyCoroutine::CoroutineCreate(SCHEDULE, EpollCtlReadLoop, &readArg);
+  int64_t count = Core::EpollCtl::CtlCount();
+  EpollCtlDispatch(readArg, fds[1]);
+  std::cout << "persistent read, epoll_ctl per read = "
+            << (Core::EpollCtl::CtlCount() - count) * 1.0 / readArg.loop_ << std::endl;
+  ASSERT_EQ(readArg.read_count_, readArg.loop_);
+  ASSERT_EQ(Core::EpollCtl::CtlCount() - count, 0);
+  MyCoroutine::ScheduleClean(SCHEDULE);
+  PERSISTENT_EVENT.Remove(fds[0]);
+  close(fds[0]);
+  close(fds[1]);
+  close(readArg.epoll_fd_);
+}
+
+// 服务端的客户端连接以ONESHOT方式注册，每次读等待只需要一次MOD重新激活，不再有ADD/DEL
+TEST_CASE(EpollCtl_ConnEventRead) {
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds), 0);
+  SYSTEM.SetIoMock(nullptr);
+  int epollFd = epoll_create(1);
+  Core::EventData eventData(fds[0], epollFd, Core::CLIENT);
+  Core::EpollCtl::SetEvent(&eventData, EPOLLIN | EPOLLONESHOT);
+  EpollCtlReadArg readArg{fds[0], epollFd, &eventData, 100, 0};
+  MyCoroutine::ScheduleInit(SCHEDULE, 10, 64 * 1024);
+  MyCoroutine::CoroutineCreate(SCHEDULE, EpollCtlReadLoop, &readArg);
+  int64_t count = Core::EpollCtl::CtlCount();
+  EpollCtlDispatch(readArg, fds[1]);
+  ASSERT_EQ(readArg.read_count_, readArg.loop_);
+  ASSERT_TRUE(Core::EpollCtl::CtlCount() - count <= readArg.loop_);
+  MyCoroutine::ScheduleClean(SCHEDULE);
+  Core::EpollCtl::RemoveEvent(&eventData);
+  close(fds[1]);
+  close(epollFd);
+}
+
+typedef struct EpollCtlHandOffArg {
+  int epoll_fd_;
+  int other_epoll_fd_;
+  std::atomic<int> *hand_off_count_;
+  std::atomic<int> *stale_count_;
+  int loop_;
+} EpollCtlHandOffArg;
+
+// 模拟连接在两个reactor之间迁移：收到事件的线程检查缓存的注册信息，再把连接交给另一个线程的epoll实例
+void EpollCtlHandOff(EpollCtlHandOffArg *arg) {
+  int idleCount = 0;
+  epoll_event event;
+  while (arg->hand_off_count_->load() < arg->loop_ && idleCount < 10) {
+    if (epoll_wait(arg->epoll_fd_, &event, 1, 100) <= 0) {
+      idleCount++;
+      continue;
+    }
+    idleCount = 0;
+    Core::EventData *eventData = (Core::EventData *)event.data.ptr;
+    Core::EpollCtl::Triggered(eventData, event.events);
+    if (eventData->registered_epoll_fd_ != arg->epoll_fd_ || eventData->interest_ != 0)
+      (*arg->stale_count_)++;
+    (*arg->hand_off_count_)++;
+    eventData->epoll_fd_ = arg->other_epoll_fd_;
+    Core::EpollCtl::SetEvent(eventData, EPOLLIN | EPOLLONESHOT);
+  }
+}
+
+// 迁移时ADD之后事件马上会在另一个线程中触发，这时EventData中缓存的注册信息必须已经是最新的
+TEST_CASE(EpollCtl_HandOffRace) {
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds), 0);
+  ASSERT_EQ(write(fds[1], "x", 1), 1);  // 一直可读，每次注册之后都会马上触发
+  int epollFds[2] = {epoll_create(1), epoll_create(1)};
+  std::atomic<int> handOffCount(0);
+  std::atomic<int> staleCount(0);
+  EpollCtlHandOffArg args[2] = {{epollFds[0], epollFds[1], &handOffCount, &staleCount, 100000},
+                                {epollFds[1], epollFds[0], &handOffCount, &staleCount, 100000}};
+  Core::EventData eventData(fds[0], epollFds[0], Core::CLIENT);
+  std::thread threads[2] = {std::thread(EpollCtlHandOff, &args[0]), std::thread(EpollCtlHandOff, &args[1])};
+  Core::EpollCtl::SetEvent(&eventData, EPOLLIN | EPOLLONESHOT);
+  threads[0].join();
+  threads[1].join();
+  std::cout << "hand off count = " << handOffCount.load() << std::endl;
+  ASSERT_EQ(staleCount.load(), 0);
+  ASSERT_TRUE(handOffCount.load() >= 100000);
+  close(fds[0]);
+  close(fds[1]);
+  close(epollFds[0]);
+  close(epollFds[1]);
+}
@@ -0,0 +1,139 @@
+#include <assert.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <iostream>
+
+#include "../core/handler.hpp"
+#include "unittestcore.h"
+
+class PipelineHandler : public Core::MyHandler {
+ public:
+  PipelineHandler() {
+    service_name_ = "Echo";
+    rpc_names_.insert("EchoMySelf");
+  }
+  void MySvrHandler(Protocol::MySvrMessage& req, Protocol::MySvrMessage& resp) {
+    resp.body_.Alloc(req.body_.UseLen());
+    memmove(resp.body_.Data(), req.body_.DataRaw(), req.body_.UseLen());
+    resp.body_.UpdateUseLen(req.body_.UseLen());
+  }
+};
+
+std::string EncodeEchoReq(const std::string& body) {
+  Protocol::MySvrMessage req;
+  req.context_.set_service_name("Echo");
+  req.context_.set_rpc_name("EchoMySelf");
+  req.body_.Alloc(body.size());
+  memmove(req.body_.Data(), body.data(), body.size());
+  req.body_.UpdateUseLen(body.size());
+  Protocol::MySvrCodec codec;
+  Protocol::Packet pkt;
+  codec.Encode(&req, pkt);
+  return std::string((char*)pkt.DataRaw(), pkt.UseLen());
+}
+
+// 从fd上读取一个应答，返回应答的body
+std::string ReadEchoResp(int fd, Protocol::MySvrCodec& codec) {
+  Protocol::MySvrMessage* resp = nullptr;
+  while (nullptr == resp) {
+    ssize_t ret = read(fd, codec.Data(), codec.Len());
+    assert(ret > 0);
+    assert(codec.Decode(ret));
+    resp = (Protocol::MySvrMessage*)codec.GetMessage();
+  }
+  assert(resp->StatusCode() == 0);
+  std::string body((char*)resp->body_.DataRaw(), resp->body_.UseLen());
+  delete resp;
+  return body;
+}
+
+void PipelineHandlerEntry(void* arg) {
+  Core::EventData* eventData = (Core::EventData*)arg;
+  EpollFd.Set(eventData->epoll_fd_);
+  eventData->cid_ = MyCoroutine::ScheduleGetRunCid(SCHEDULE);
+  PipelineHandler handler;
+  handler.HandlerEntry(eventData);
+}
+
+// 客户端pipeline发送的多个请求在同一个协程中连续处理，应答按请求的顺序一次写回，只需要一次epoll_ctl重新激活监听
+TEST_CASE(Handler_Pipeline) {
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds), 0);
+  SYSTEM.SetIoMock(nullptr);
+  const int depth = 16;
+  std::string reqs;
+  for (int i = 0; i < depth; i++) {
+    reqs.append(EncodeEchoReq(std::to_string(i)));
+  }
+  ASSERT_EQ(write(fds[1], reqs.data(), reqs.size()), (ssize_t)reqs.size());
+  int epollFd = epoll_create(1);
+  Core::EventData* eventData = new Core::EventData(fds[0], epollFd, Core::CLIENT);
+  MyCoroutine::ScheduleInit(SCHEDULE, 10, 64 * 1024);
+  MyCoroutine::CoroutineCreate(SCHEDULE, PipelineHandlerEntry, eventData);
+  int64_t ctlCount = Core::EpollCtl::CtlCount();
+  int64_t readCount = Core::System::ReadCount();
+  int64_t writeCount = Core::System::WriteCount();
+  MyCoroutine::CoroutineResume(SCHEDULE);
+  ASSERT_FALSE(MyCoroutine::ScheduleRunning(SCHEDULE));  // 所有请求都处理完了，协程已经退出
+  ASSERT_EQ(Core::EpollCtl::CtlCount() - ctlCount, 1);
+  ASSERT_EQ(Core::System::ReadCount() - readCount, 2);  // 一次read就读取了所有的请求，再读取一次返回EAGAIN
+  ASSERT_EQ(Core::System::WriteCount() - writeCount, 1);  // 所有的应答一次writev写回
+  ASSERT_EQ(eventData->interest_, EPOLLIN | EPOLLONESHOT);
+
+  Protocol::MySvrCodec codec;
+  for (int i = 0; i < depth; i++) {
+    ASSERT_EQ(ReadEchoResp(fds[1], codec), std::to_string(i));
+  }
+  MyCoroutine::ScheduleClean(SCHEDULE);
+  Core::EpollCtl::RemoveEvent(eventData);
+  Core::MyHandler::DeleteConn(eventData);
+  delete eventData;
+  close(fds[1]);
+  close(epollFd);
+}
+
+
+// 每次可读事件到达一个小请求，批量读取时一次read就读取了完整的请求，处理完之后再读取一次确认没有pipeline的请求。
+// 请求比读缓冲区大时缓冲区临时扩大，之后的小请求仍然只需要一次read
+TEST_CASE(Handler_BulkRead) {
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds), 0);
+  SYSTEM.SetIoMock(nullptr);
+  int epollFd = epoll_create(1);
+  Core::EventData* eventData = new Core::EventData(fds[0], epollFd, Core::CLIENT);
+  MyCoroutine::ScheduleInit(SCHEDULE, 10, 64 * 1024);
+  Protocol::MySvrCodec codec;
+  const int count = 1000;
+  int64_t readCount = Core::System::ReadCount();
+  for (int i = 0; i < count; i++) {
+    std::string req = EncodeEchoReq("hello" + std::to_string(i));
+    ASSERT_EQ(write(fds[1], req.data(), req.size()), (ssize_t)req.size());
+    MyCoroutine::CoroutineCreate(SCHEDULE, PipelineHandlerEntry, eventData);
+    MyCoroutine::CoroutineResume(SCHEDULE);
+    ASSERT_FALSE(MyCoroutine::ScheduleRunning(SCHEDULE));
+    ASSERT_EQ(ReadEchoResp(fds[1], codec), "hello" + std::to_string(i));
+  }
+  readCount = Core::System::ReadCount() - readCount;
+  std::cout << "read syscalls per request = " << readCount * 1.0 / count << " (including the EAGAIN probe)" << std::endl;
+  ASSERT_EQ(readCount, 2 * count);
+
+  std::string big(64 * 1024, 0);  // 压缩之后仍然比读缓冲区大
+  uint32_t seed = 1;
+  for (size_t i = 0; i < big.size(); i++) {
+    seed = seed * 1103515245 + 12345;
+    big[i] = (char)(seed >> 16);
+  }
+  std::string reqs = EncodeEchoReq(big) + EncodeEchoReq("small");
+  ASSERT_EQ(write(fds[1], reqs.data(), reqs.size()), (ssize_t)reqs.size());
+  MyCoroutine::CoroutineCreate(SCHEDULE, PipelineHandlerEntry, eventData);
+  MyCoroutine::CoroutineResume(SCHEDULE);
+  ASSERT_FALSE(MyCoroutine::ScheduleRunning(SCHEDULE));
+  ASSERT_EQ(ReadEchoResp(fds[1], codec), big);
+  ASSERT_EQ(ReadEchoResp(fds[1], codec), "small");
+  MyCoroutine::ScheduleClean(SCHEDULE);
+  Core::EpollCtl::RemoveEvent(eventData);
+  Core::MyHandler::DeleteConn(eventData);
+  delete eventData;
+  close(fds[1]);
+  close(epollFd);
+}
@@ -174,3 +174,35 @@ TEST_CASE(HttpCodec_Decode_Error_Not_Content_Length) {
   bool result = codec.Decode(rawResp.size());
   ASSERT_FALSE(result);
 }
+
+// 一次读取了多个请求的数据时，解析完一个请求之后剩余的数据保留在缓冲区中，Decode(0)继续解析下一个请求
+TEST_CASE(HttpCodec_Decode_Pipeline) {
+  std::string rawReq = "POST /index HTTP/1.1\r\nContent-Length: 2\r\n\r\n{}";
+  std::string rawReqs = rawReq + rawReq + rawReq.substr(0, 10);
+  Protocol::HttpCodec codec;
+  size_t offset = 0;
+  while (offset < rawReqs.size()) {  // 模拟一次读取到缓冲区中的所有数据
+    size_t len = std::min(codec.Len(), rawReqs.size() - offset);
+    memmove(codec.Data(), rawReqs.data() + offset, len);
+    ASSERT_TRUE(codec.Decode(len));
+    offset += len;
+    if (codec.GetMessage() != nullptr) {
+      break;
+    }
+  }
+  ASSERT_EQ(offset, rawReqs.size());
+  ASSERT_TRUE(codec.Decode(0));
+  Protocol::HttpMessage* message = (Protocol::HttpMessage*)codec.GetMessage();
+  ASSERT_TRUE(message != nullptr);
+  ASSERT_EQ(message->body_, "{}");
+  delete message;
+  ASSERT_TRUE(codec.Decode(0));
+  ASSERT_TRUE(codec.GetMessage() == nullptr);  // 第三个请求不完整
+  std::string remain = rawReq.substr(10);
+  memmove(codec.Data(), remain.data(), remain.size());
+  ASSERT_TRUE(codec.Decode(remain.size()));
+  message = (Protocol::HttpMessage*)codec.GetMessage();
+  ASSERT_TRUE(message != nullptr);
+  ASSERT_EQ(message->first_line_, "POST /index HTTP/1.1");
+  delete message;
+}
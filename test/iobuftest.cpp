@@ -0,0 +1,75 @@
+#include "../protocol/packet.hpp"
+#include "unittestcore.h"
+
+TEST_CASE(IOBuf_Append) {
+  Protocol::IOBuf buf;
+  ASSERT_TRUE(buf.Empty());
+  buf.Append("hello", 5);
+  buf.Append(" world", 6);
+  ASSERT_EQ(buf.Length(), 11);
+  ASSERT_EQ(buf.SliceCount(), 1);  // 尾部的内存块还有空间，拷贝到同一个片段中
+  ASSERT_EQ(buf.ToString(), "hello world");
+  std::string big(Protocol::IOBUF_BLOCK_LEN * 2, 'a');
+  buf.Append(big.data(), big.size());
+  ASSERT_EQ(buf.SliceCount(), 2);
+  ASSERT_EQ(buf.ToString(), "hello world" + big);
+}
+
+TEST_CASE(IOBuf_Share) {
+  Protocol::IOBuf buf;
+  buf.Append("hello", 5);
+  Protocol::IOBuf buf2(buf);  // 只共享内存块
+  buf2.Append("!", 1);        // 尾部的内存块被共享，追加到新的内存块，不影响buf
+  ASSERT_EQ(buf2.SliceCount(), 2);
+  ASSERT_EQ(buf2.ToString(), "hello!");
+  ASSERT_EQ(buf.ToString(), "hello");
+  buf.Clear();
+  ASSERT_EQ(buf2.ToString(), "hello!");  // 内存块的引用计数没有减到0，仍然有效
+  Protocol::IOBuf buf3;
+  buf3 = buf2;
+  buf3.Append(buf2);
+  ASSERT_EQ(buf3.SliceCount(), 4);
+  ASSERT_EQ(buf3.ToString(), "hello!hello!");
+}
+
+TEST_CASE(IOBuf_Iovecs_Consume) {
+  Protocol::IOBuf buf;
+  Protocol::Packet pkt1, pkt2;
+  pkt1.Alloc(5);
+  memmove(pkt1.Data(), "hello", 5);
+  pkt1.UpdateUseLen(5);
+  pkt2.Alloc(5);
+  memmove(pkt2.Data(), "world", 5);
+  pkt2.UpdateUseLen(5);
+  pkt1.ShareTo(buf);
+  pkt2.ShareTo(buf);
+  struct iovec iov[4];
+  ASSERT_EQ(buf.Iovecs(iov, 4), 2);
+  ASSERT_EQ(iov[0].iov_base, pkt1.DataRaw());  // 片段直接指向包的缓冲区
+  ASSERT_EQ(iov[1].iov_len, 5);
+  ASSERT_EQ(buf.Iovecs(iov, 1), 1);
+  buf.Consume(7);  // 模拟writev只写入了一部分
+  ASSERT_EQ(buf.Length(), 3);
+  ASSERT_EQ(buf.SliceCount(), 1);
+  ASSERT_EQ(buf.ToString(), "rld");
+  buf.Consume(3);
+  ASSERT_TRUE(buf.Empty());
+}
+
+TEST_CASE(IOBuf_PacketCopyOnWrite) {
+  Protocol::Packet pkt;
+  pkt.Alloc(16);
+  memmove(pkt.Data(), "hello", 5);
+  pkt.UpdateUseLen(5);
+  Protocol::Packet pkt2;
+  pkt2.CopyFrom(pkt);
+  ASSERT_EQ(pkt2.DataRaw(), pkt.DataRaw());  // 只增加引用计数
+  memmove(pkt2.Data(), " world", 6);         // 写入之前拷贝
+  pkt2.UpdateUseLen(6);
+  ASSERT_EQ(std::string((char*)pkt.DataRaw(), pkt.UseLen()), "hello");
+  ASSERT_EQ(std::string((char*)pkt2.DataRaw(), pkt2.UseLen()), "hello world");
+  Protocol::IOBuf buf;
+  pkt.ShareTo(buf);
+  pkt.Alloc(8);  // 包重新分配缓冲区之后，buf引用的内存块仍然有效
+  ASSERT_EQ(buf.ToString(), "hello");
+}
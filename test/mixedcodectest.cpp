@@ -92,3 +92,39 @@ TEST_CASE(MixedCodec_Data_Len) {
   Protocol::MixedCodec codec;
   ASSERT_EQ(codec.Len(), 1);
 }
+
+// 批量读取：一次读取到的多个完整消息和一个不完整的消息，协议判断和消息解析都在同一个缓冲区上进行
+TEST_CASE(MixedCodec_BulkRead) {
+  Protocol::MySvrMessage message;
+  message.context_.set_rpc_name("ping");
+  message.body_.Alloc(5);
+  memmove(message.body_.Data(), "hello", 5);
+  message.body_.UpdateUseLen(5);
+  Protocol::MySvrCodec mySvrCodec;
+  Protocol::Packet pkt;
+  mySvrCodec.Encode(&message, pkt);
+  std::string frame((char *)pkt.DataRaw(), pkt.UseLen());
+  std::string data = frame + frame + frame + frame.substr(0, 3);
+
+  Protocol::MixedCodec codec(1024);
+  ASSERT_EQ(codec.Len(), 1024);
+  memmove(codec.Data(), data.data(), data.size());
+  ASSERT_TRUE(codec.Decode(data.size()));
+  ASSERT_EQ(codec.GetCodecType(), Protocol::MY_SVR);
+  for (int i = 0; i < 3; i++) {
+    if (i > 0) ASSERT_TRUE(codec.Decode(0));
+    Protocol::MySvrMessage *message1 = (Protocol::MySvrMessage *)codec.GetMessage();
+    ASSERT_TRUE(message1 != nullptr);
+    ASSERT_EQ(std::string((char *)message1->body_.DataRaw(), message1->body_.UseLen()), "hello");
+    delete message1;
+  }
+  ASSERT_TRUE(codec.Decode(0));
+  ASSERT_TRUE(codec.GetMessage() == nullptr);
+  ASSERT_EQ(codec.Len(), 1024 - 3);  // 缓冲区重复使用，不完整的消息移动到了开始位置
+  memmove(codec.Data(), frame.data() + 3, frame.size() - 3);
+  ASSERT_TRUE(codec.Decode(frame.size() - 3));
+  Protocol::MySvrMessage *message1 = (Protocol::MySvrMessage *)codec.GetMessage();
+  ASSERT_TRUE(message1 != nullptr);
+  delete message1;
+  ASSERT_EQ(codec.Len(), 1024);
+}
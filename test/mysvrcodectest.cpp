@@ -94,4 +94,84 @@ TEST_CASE(MySvrCodec_SetLimit2) {
       break;
     }
   }
-}
\ No newline at end of file
+}
+TEST_CASE(MySvrCodec_Encode_Decode_Large) {
+  Protocol::MySvrMessage message;
+  message.context_.set_log_id("666");
+  message.context_.set_rpc_name("ping");
+  std::string body(64 * 1024, 0);
+  for (size_t i = 0; i < body.size(); i++) {
+    body[i] = (char)(i * 131 % 251);
+  }
+  message.body_.Alloc(body.size());
+  memmove(message.body_.Data(), body.data(), body.size());
+  message.body_.UpdateUseLen(body.size());
+
+  Protocol::MySvrCodec codec;
+  Protocol::Packet pkt;
+  ASSERT_TRUE(codec.Encode(&message, pkt));
+  ASSERT_EQ(pkt.UseLen(), Protocol::PROTO_HEAD_LEN + message.head_.context_len_ + message.head_.body_len_);
+  size_t offset = 0;
+  Protocol::MySvrMessage *message1 = nullptr;
+  while (nullptr == message1) {  // 按编解码器每次需要的长度读取
+    size_t len = std::min(codec.Len(), pkt.UseLen() - offset);
+    memmove(codec.Data(), pkt.DataRaw() + offset, len);
+    offset += len;
+    ASSERT_TRUE(codec.Decode(len));
+    message1 = (Protocol::MySvrMessage *)codec.GetMessage();
+  }
+  ASSERT_EQ(offset, pkt.UseLen());
+  ASSERT_EQ(message1->context_.log_id(), "666");
+  ASSERT_EQ(std::string((char *)message1->body_.DataRaw(), message1->body_.UseLen()), body);
+  delete message1;
+}
+
+// 压缩数据声明的解压长度不合法时解析失败，不会按这个长度分配内存
+TEST_CASE(MySvrCodec_Decode_Corrupt) {
+  Protocol::MySvrMessage message;
+  message.context_.set_rpc_name("ping");
+  std::string body = "hello world";
+  message.body_.Alloc(body.size());
+  memmove(message.body_.Data(), body.data(), body.size());
+  message.body_.UpdateUseLen(body.size());
+  Protocol::MySvrCodec codec;
+  Protocol::Packet pkt;
+  ASSERT_TRUE(codec.Encode(&message, pkt));
+  uint8_t *compressBody = pkt.DataRaw() + Protocol::PROTO_HEAD_LEN + message.head_.context_len_;
+  uint8_t hugeLen[] = {0xff, 0xff, 0xff, 0xff, 0x0f};
+  memmove(compressBody, hugeLen, sizeof(hugeLen));
+  memmove(codec.Data(), pkt.DataRaw(), Protocol::PROTO_HEAD_LEN);
+  ASSERT_TRUE(codec.Decode(Protocol::PROTO_HEAD_LEN));
+  size_t len = pkt.UseLen() - Protocol::PROTO_HEAD_LEN;
+  memmove(codec.Data(), pkt.DataRaw() + Protocol::PROTO_HEAD_LEN, len);
+  ASSERT_FALSE(codec.Decode(len));
+}
+
+// 上下文和消息体的压缩长度为0时按空内容处理，不交给snappy解压
+TEST_CASE(MySvrCodec_Decode_EmptyBody) {
+  Protocol::MySvrMessage message;
+  message.context_.set_rpc_name("ping");
+  Protocol::MySvrCodec codec;
+  Protocol::Packet pkt;
+  ASSERT_TRUE(codec.Encode(&message, pkt));
+  uint32_t contextLen = message.head_.context_len_;
+  *(uint32_t *)(pkt.DataRaw() + 4) = 0; // 去掉消息体，只保留消息头和上下文
+  memmove(codec.Data(), pkt.DataRaw(), Protocol::PROTO_HEAD_LEN);
+  ASSERT_TRUE(codec.Decode(Protocol::PROTO_HEAD_LEN));
+  memmove(codec.Data(), pkt.DataRaw() + Protocol::PROTO_HEAD_LEN, contextLen);
+  ASSERT_TRUE(codec.Decode(contextLen));
+  Protocol::MySvrMessage *message1 = (Protocol::MySvrMessage *)codec.GetMessage();
+  ASSERT_TRUE(message1 != nullptr);
+  ASSERT_EQ(message1->context_.rpc_name(), std::string("ping"));
+  ASSERT_EQ(message1->body_.UseLen(), 0);
+  delete message1;
+
+  uint8_t head[Protocol::PROTO_HEAD_LEN] = {Protocol::PROTO_MAGIC_AND_VERSION, 0, 0, 0, 0, 0, 0, 0};
+  memmove(codec.Data(), head, sizeof(head)); // 上下文和消息体都为空的消息
+  ASSERT_TRUE(codec.Decode(sizeof(head)));
+  message1 = (Protocol::MySvrMessage *)codec.GetMessage();
+  ASSERT_TRUE(message1 != nullptr);
+  ASSERT_TRUE(message1->context_.rpc_name().empty());
+  ASSERT_EQ(message1->body_.UseLen(), 0);
+  delete message1;
+}
@@ -36,9 +36,32 @@ TEST_CASE(Packet_Used) {
   ASSERT_EQ(pkt2.Len(), 90);
   ASSERT_EQ(pkt2.UseLen(), 10);
   ASSERT_EQ(pkt2.NeedParseLen(), 4);
+  ASSERT_EQ(pkt2.DataRaw(), pkt.DataRaw());  // CopyFrom只共享缓冲区
+  data = pkt2.Data();                        // 获取写入地址之前拷贝一份独占的缓冲区
+  ASSERT_NE(pkt2.DataRaw(), pkt.DataRaw());
+  ASSERT_EQ(pkt2.Len(), 90);
   dataRaw = pkt2.DataRaw();
-  data = pkt2.Data();
   dataParse = pkt2.DataParse();
   ASSERT_EQ(dataRaw + 10, data);
   ASSERT_EQ(dataRaw + 6, dataParse);
-}
\ No newline at end of file
+}
+TEST_CASE(Packet_Swap_Compact) {
+  Protocol::Packet pkt;
+  pkt.Alloc(100);
+  memmove(pkt.Data(), "0123456789", 10);
+  pkt.UpdateUseLen(10);
+  pkt.UpdateParseLen(6);
+  pkt.Compact();
+  ASSERT_EQ(pkt.UseLen(), 4);
+  ASSERT_EQ(pkt.NeedParseLen(), 4);
+  ASSERT_EQ(pkt.Len(), 96);
+  ASSERT_EQ(memcmp(pkt.DataRaw(), "6789", 4), 0);
+  Protocol::Packet pkt2;
+  pkt2.Alloc(10);
+  uint8_t* dataRaw = pkt.DataRaw();
+  pkt2.Swap(pkt);
+  ASSERT_EQ(pkt2.DataRaw(), dataRaw);
+  ASSERT_EQ(pkt2.UseLen(), 4);
+  ASSERT_EQ(pkt.Len(), 10);
+  ASSERT_EQ(pkt.UseLen(), 0);
+}
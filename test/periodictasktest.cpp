@@ -0,0 +1,69 @@
+#include <unistd.h>
+#include <algorithm>
+
+#include "../common/timedeal.hpp"
+#include "../core/coroutineio.hpp"
+#include "../core/periodictask.hpp"
+#include "unittestcore.h"
+
+// 模拟subReactor的定时器处理，运行ms毫秒
+void PeriodicTaskRunFor(int64_t ms) {
+  Common::TimeStat timeStat;
+  Core::TimerData timerData;
+  while (TIMER.GetLastTimer(timerData)) {
+    usleep(TIMER.TimeOutMs(timerData) * 1000);
+    TIMER.Run(timerData);
+    MyCoroutine::CoroutineResumeWakeUp(SCHEDULE);
+    if (timeStat.GetSpendTimeUs(false) >= ms * 1000) break;
+  }
+}
+
+typedef struct TaskArg {
+  int64_t sleep_ms_;
+  int run_count_;
+  int running_;
+  int max_running_;
+} TaskArg;
+
+void PeriodicTaskFunc(void* arg) {
+  TaskArg* taskArg = (TaskArg*)arg;
+  taskArg->run_count_++;
+  taskArg->running_++;
+  taskArg->max_running_ = std::max(taskArg->max_running_, taskArg->running_);
+  if (taskArg->sleep_ms_ > 0) Core::CoSleep(taskArg->sleep_ms_);
+  taskArg->running_--;
+}
+
+TEST_CASE(PeriodicTask_Run) {
+  TaskArg taskArg{0, 0, 0, 0};
+  PERIODIC_TASK.Clear();
+  PERIODIC_TASK.Add("test_run", 10, PeriodicTaskFunc, &taskArg);
+  MyCoroutine::ScheduleInit(SCHEDULE, 4, 64 * 1024);
+  PERIODIC_TASK.Start(1);  // 只在第0个subReactor上执行的任务不会启动
+  PeriodicTaskRunFor(30);
+  ASSERT_EQ(taskArg.run_count_, 0);
+  PERIODIC_TASK.Start(0);
+  PeriodicTaskRunFor(105);
+  PERIODIC_TASK.Stop();
+  ASSERT_TRUE(taskArg.run_count_ >= 8 && taskArg.run_count_ <= 11);
+  ASSERT_FALSE(MyCoroutine::ScheduleRunning(SCHEDULE));
+  PERIODIC_TASK.Clear();
+  MyCoroutine::ScheduleClean(SCHEDULE);
+}
+
+// 任务执行的时间超过了间隔，上一次没有执行完时跳过本次执行
+TEST_CASE(PeriodicTask_SkipIfRunning) {
+  TaskArg taskArg{25, 0, 0, 0};
+  PERIODIC_TASK.Clear();
+  PERIODIC_TASK.Add("test_skip", 10, PeriodicTaskFunc, &taskArg, 5);
+  MyCoroutine::ScheduleInit(SCHEDULE, 4, 64 * 1024);
+  PERIODIC_TASK.Start(0);
+  PeriodicTaskRunFor(150);
+  PERIODIC_TASK.Stop();
+  PeriodicTaskRunFor(50);  // 等待正在执行的任务结束
+  ASSERT_EQ(taskArg.max_running_, 1);
+  ASSERT_TRUE(taskArg.run_count_ >= 3 && taskArg.run_count_ <= 6);
+  ASSERT_FALSE(MyCoroutine::ScheduleRunning(SCHEDULE));
+  PERIODIC_TASK.Clear();
+  MyCoroutine::ScheduleClean(SCHEDULE);
+}
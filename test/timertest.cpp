@@ -1,7 +1,13 @@
+#include <stdlib.h>
+#include <sys/time.h>
 #include <unistd.h>
 
 #include <iostream>
+#include <queue>
+#include <unordered_set>
+#include <vector>
 
+#include "../common/timedeal.hpp"
 #include "../core/timer.hpp"
 #include "unittestcore.h"
 
@@ -44,4 +50,169 @@ TEST_CASE(Timer_Register) {
     }
   }
   ASSERT_FALSE(temp3);
-}
\ No newline at end of file
+}
+void timerCount(void *data) { (*(int *)data)++; }
+
+// 取消之后节点被复用，旧的id失效，新的id版本号不同
+TEST_CASE(Timer_CancelReuse) {
+  Core::Timer timer;
+  int count = 0;
+  uint64_t id1 = timer.Register(timerCount, &count, 10);
+  uint64_t id2 = timer.Register(timerCount, &count, 500);  // 放在第1层
+  ASSERT_EQ(timer.Size(), 2);
+  timer.Cancel(id1);
+  uint64_t id3 = timer.Register(timerCount, &count, 10);
+  ASSERT_TRUE(id3 != id1);
+  ASSERT_EQ(id3 & 0xffffffff, id1 & 0xffffffff);
+  timer.Cancel(id2);
+  timer.Cancel(id3);
+  ASSERT_EQ(timer.Size(), 0);
+  Core::TimerData timerData;
+  ASSERT_FALSE(timer.GetLastTimer(timerData));
+}
+
+// 不同层的定时器按超时时间先后执行，同一个槽中的定时器在一次Run中批量执行
+TEST_CASE(Timer_CascadeOrder) {
+  Core::Timer timer;
+  int fast = 0;
+  int slow = 0;
+  int batch = 0;
+  for (int i = 0; i < 100; i++) {
+    timer.Register(timerCount, &batch, 20);
+  }
+  timer.Register(timerCount, &fast, 300);   // 第1层，需要cascade
+  timer.Register(timerCount, &slow, 1000);  // 第1层
+  Core::TimerData timerData;
+  ASSERT_TRUE(timer.GetLastTimer(timerData));
+  usleep(timer.TimeOutMs(timerData) * 1000);
+  timer.Run(timerData);
+  ASSERT_EQ(batch, 100);
+  ASSERT_EQ(fast, 0);
+  int64_t begin = timer.GetCurrentTimeMs();
+  while (timer.GetLastTimer(timerData)) {
+    usleep(timer.TimeOutMs(timerData) * 1000);
+    timer.Run(timerData);
+    if (fast == 1 && slow == 0) {
+      ASSERT_TRUE(timer.GetCurrentTimeMs() - begin < 1000);
+    }
+  }
+  ASSERT_EQ(fast, 1);
+  ASSERT_EQ(slow, 1);
+}
+
+// 超过时间轮范围（2^32毫秒）的定时器放在最远的槽中，但是超时时间保持不变，不会提前执行
+TEST_CASE(Timer_BeyondWheelRange) {
+  Core::Timer timer;
+  int count = 0;
+  int64_t timeOutMs = ((int64_t)1 << 32) * 3 + 12345;
+  int64_t begin = timer.GetCurrentTimeMs();
+  uint64_t farId = timer.Register(timerCount, &count, timeOutMs);
+  Core::TimerData timerData;
+  ASSERT_TRUE(timer.GetLastTimer(timerData));
+  ASSERT_TRUE(timerData.abs_time_ms_ >= begin + timeOutMs);
+  ASSERT_TRUE(timerData.abs_time_ms_ <= timer.GetCurrentTimeMs() + timeOutMs);
+  ASSERT_EQ(timer.TimeOutMs(timerData), INT32_MAX);  // epoll_wait的超时参数不会溢出
+  timer.Register(timerCount, &count, 10);
+  ASSERT_TRUE(timer.GetLastTimer(timerData));
+  ASSERT_TRUE(timerData.abs_time_ms_ < begin + 1000);
+  usleep(timer.TimeOutMs(timerData) * 1000);
+  timer.Run(timerData);
+  ASSERT_EQ(count, 1);
+  ASSERT_EQ(timer.Size(), 1);
+  ASSERT_TRUE(timer.GetLastTimer(timerData));
+  ASSERT_TRUE(timerData.abs_time_ms_ >= begin + timeOutMs);
+  timer.Cancel(farId);
+  ASSERT_EQ(timer.Size(), 0);
+}
+
+// 时间轮之前基于priority_queue的定时器实现，只用于下面的性能对比
+class HeapTimer {
+ public:
+  uint64_t Register(Core::TimerCallBack callBack, void *data, int64_t timeOutMs) {
+    alloc_id_++;
+    Core::TimerData timerData;
+    timerData.id_ = alloc_id_;
+    timerData.data_ = data;
+    timerData.abs_time_ms_ = GetCurrentTimeMs() + timeOutMs;
+    timerData.call_back_ = callBack;
+    timers_.push(timerData);
+    timer_ids_.insert(timerData.id_);
+    return alloc_id_;
+  }
+  void Cancel(uint64_t id) { cancel_ids_.insert(id); }  // 这里只是做一下记录
+  bool GetLastTimer(Core::TimerData &timerData) {
+    while (not timers_.empty()) {
+      timerData = timers_.top();
+      timers_.pop();
+      if (cancel_ids_.find(timerData.id_) != cancel_ids_.end()) {  // 被取消的定时器不执行，直接删除
+        cancel_ids_.erase(timerData.id_);
+        timer_ids_.erase(timerData.id_);
+        continue;
+      }
+      return true;
+    }
+    return false;
+  }
+  void Run(Core::TimerData &timerData) {
+    if (GetCurrentTimeMs() < timerData.abs_time_ms_) {  // 没有过期则重新塞入队列中去重新排队
+      timers_.push(timerData);
+      return;
+    }
+    timer_ids_.erase(timerData.id_);
+    if (cancel_ids_.erase(timerData.id_) > 0) return;
+    timerData.call_back_(timerData.data_);
+  }
+  size_t Size() const { return timer_ids_.size() - cancel_ids_.size(); }
+  int64_t GetCurrentTimeMs() {
+    struct timeval current;
+    gettimeofday(&current, NULL);
+    return current.tv_sec * 1000 + current.tv_usec / 1000;
+  }
+
+ private:
+  struct Later {
+    bool operator()(const Core::TimerData &left, const Core::TimerData &right) const {
+      return left.abs_time_ms_ > right.abs_time_ms_;
+    }
+  };
+  uint64_t alloc_id_{0};
+  std::unordered_set<uint64_t> timer_ids_;
+  std::unordered_set<uint64_t> cancel_ids_;
+  std::priority_queue<Core::TimerData, std::vector<Core::TimerData>, Later> timers_;
+};
+
+// 100万个存活的定时器下，注册并取消定时器（每次CoRead/CoWrite的模式）的耗时，
+// 以及事件循环每一轮获取最近定时器并执行的耗时。超时时间足够长，测试过程中不会有定时器超时
+template <typename T>
+void timerBenchmark(T &timer, const char *name, int &count) {
+  unsigned int seed = 1;
+  for (int i = 0; i < 1000000; i++) {
+    timer.Register(timerCount, &count, 60000 + rand_r(&seed) % 30000);
+  }
+  int loop = 1000000;
+  Common::TimeStat timeStat;
+  for (int i = 0; i < loop; i++) {
+    uint64_t id = timer.Register(timerCount, &count, 60000 + rand_r(&seed) % 30000);
+    timer.Cancel(id);
+  }
+  int64_t spendUs = timeStat.GetSpendTimeUs();
+  Core::TimerData timerData;
+  Common::TimeStat getStat;
+  for (int i = 0; i < loop; i++) {
+    if (timer.GetLastTimer(timerData)) timer.Run(timerData);
+  }
+  int64_t getUs = getStat.GetSpendTimeUs();
+  std::cout << name << ": live timers = " << timer.Size() << ", register+cancel cost = " << spendUs * 1000 / loop
+            << "ns, GetLastTimer+Run cost = " << getUs * 1000 / loop << "ns" << std::endl;
+}
+
+TEST_CASE(Timer_RegisterCancelBenchmark) {
+  int count = 0;
+  Core::Timer timer;
+  timerBenchmark(timer, "timing wheel", count);
+  ASSERT_EQ(timer.Size(), 1000000);
+  HeapTimer heapTimer;
+  timerBenchmark(heapTimer, "heap timer  ", count);
+  ASSERT_EQ(heapTimer.Size(), 1000000);
+  ASSERT_EQ(count, 0);
+}
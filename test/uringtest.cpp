@@ -0,0 +1,192 @@
+#include <assert.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <iostream>
+
+#include "../core/coroutineio.hpp"
+#include "../core/uring.hpp"
+#include "unittestcore.h"
+
+typedef struct UringEchoArg {
+  int fd_;
+  int loop_;
+  int ok_count_;
+} UringEchoArg;
+
+// 每个协程在自己的socket上先写后读，读写都通过io_uring提交
+void UringEcho(void* arg) {
+  UringEchoArg* echoArg = (UringEchoArg*)arg;
+  RpcTimeOut.Set(Core::TimeOut());
+  for (int i = 0; i < echoArg->loop_; i++) {
+    char data = 'a' + i % 26;
+    char recv = 0;
+    if (Core::CoWrite(echoArg->fd_, &data, 1) == 1 && Core::CoRead(echoArg->fd_, &recv, 1) == 1 && recv == data) {
+      echoArg->ok_count_++;
+    }
+  }
+}
+
+// 模拟subReactor：批量提交，收割完成事件并唤醒协程，对端把收到的数据原样写回
+void UringRunUntilFinish(int* peerFds, int count) {
+  while (MyCoroutine::ScheduleRunning(SCHEDULE)) {
+    URING.Submit();
+    for (int i = 0; i < count; i++) {
+      char buf[64];
+      ssize_t ret = read(peerFds[i], buf, sizeof(buf));
+      if (ret > 0) {
+        assert(write(peerFds[i], buf, ret) == ret);
+      }
+    }
+    for (int cid : URING.Reap()) {
+      MyCoroutine::CoroutineResumeById(SCHEDULE, cid);
+    }
+  }
+}
+
+TEST_CASE(Uring_ReadWrite) {
+  if (not URING.Init(256)) {
+    std::cout << "io_uring not supported, skip" << std::endl;
+    return;
+  }
+  const int count = 10;
+  int fds[count][2];
+  int peerFds[count];
+  UringEchoArg args[count];
+  MyCoroutine::ScheduleInit(SCHEDULE, count, 64 * 1024);
+  for (int i = 0; i < count; i++) {
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds[i]), 0);
+    peerFds[i] = fds[i][1];
+    args[i] = UringEchoArg{fds[i][0], 100, 0};
+    MyCoroutine::CoroutineCreate(SCHEDULE, UringEcho, &args[i]);
+  }
+  int64_t enterCount = Core::Uring::EnterCount();
+  MyCoroutine::CoroutineResume(SCHEDULE);  // 每个协程都提交了第一个请求
+  for (int i = 1; i < count; i++) {
+    MyCoroutine::CoroutineResume(SCHEDULE);
+  }
+  UringRunUntilFinish(peerFds, count);
+  enterCount = Core::Uring::EnterCount() - enterCount;
+  std::cout << "io_uring_enter per io = " << enterCount * 1.0 / (count * 100 * 2) << std::endl;
+  for (int i = 0; i < count; i++) {
+    ASSERT_EQ(args[i].ok_count_, 100);
+    close(fds[i][0]);
+    close(fds[i][1]);
+  }
+  ASSERT_TRUE(enterCount <= count * 100 * 2 / 2);  // 多个协程的请求批量提交
+  MyCoroutine::ScheduleClean(SCHEDULE);
+  URING.Exit();
+}
+
+void UringReadTimeOut(void* arg) {
+  Core::TimeOut timeOut;
+  timeOut.read_time_out_ms_ = 10;
+  RpcTimeOut.Set(timeOut);
+  char data;
+  ssize_t ret = Core::CoRead(*(int*)arg, &data, 1);
+  *(int*)arg = (-1 == ret && EAGAIN == errno) ? 1 : 0;
+}
+
+// 读超时由链接的超时请求取消，和epoll后端一样返回-1且errno为EAGAIN
+TEST_CASE(Uring_ReadTimeOut) {
+  if (not URING.Init(256)) {
+    std::cout << "io_uring not supported, skip" << std::endl;
+    return;
+  }
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds), 0);
+  int arg = fds[0];
+  MyCoroutine::ScheduleInit(SCHEDULE, 1, 64 * 1024);
+  MyCoroutine::CoroutineCreate(SCHEDULE, UringReadTimeOut, &arg);
+  MyCoroutine::CoroutineResume(SCHEDULE);
+  Common::TimeStat timeStat;
+  while (MyCoroutine::ScheduleRunning(SCHEDULE)) {
+    URING.Submit();
+    usleep(1000);
+    for (int cid : URING.Reap()) {
+      MyCoroutine::CoroutineResumeById(SCHEDULE, cid);
+    }
+  }
+  ASSERT_EQ(arg, 1);
+  ASSERT_TRUE(timeStat.GetSpendTimeUs() >= 10000);
+  close(fds[0]);
+  close(fds[1]);
+  MyCoroutine::ScheduleClean(SCHEDULE);
+  URING.Exit();
+}
+
+void UringWritev(void* arg) {
+  int fd = *(int*)arg;
+  RpcTimeOut.Set(Core::TimeOut());
+  struct iovec iov[2];
+  iov[0].iov_base = (void*)"hello ";
+  iov[0].iov_len = 6;
+  iov[1].iov_base = (void*)"world";
+  iov[1].iov_len = 5;
+  *(int*)arg = (int)Core::CoWritev(fd, iov, 2);
+}
+
+// 聚集写同样通过io_uring提交
+TEST_CASE(Uring_Writev) {
+  if (not URING.Init(256)) {
+    std::cout << "io_uring not supported, skip" << std::endl;
+    return;
+  }
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds), 0);
+  int arg = fds[0];
+  MyCoroutine::ScheduleInit(SCHEDULE, 1, 64 * 1024);
+  MyCoroutine::CoroutineCreate(SCHEDULE, UringWritev, &arg);
+  MyCoroutine::CoroutineResume(SCHEDULE);
+  while (MyCoroutine::ScheduleRunning(SCHEDULE)) {
+    URING.Submit();
+    usleep(1000);
+    for (int cid : URING.Reap()) {
+      MyCoroutine::CoroutineResumeById(SCHEDULE, cid);
+    }
+  }
+  ASSERT_EQ(arg, 11);
+  char buf[16] = {0};
+  ASSERT_EQ(read(fds[1], buf, sizeof(buf)), 11);
+  ASSERT_EQ(std::string(buf), "hello world");
+  close(fds[0]);
+  close(fds[1]);
+  MyCoroutine::ScheduleClean(SCHEDULE);
+  URING.Exit();
+}
+
+// 提交队列满了并且内核取不走SQE时（这里把ring的fd临时换成/dev/null让io_uring_enter失败），
+// GetSqe返回nullptr，已经排队的SQE不会被覆盖，恢复之后全部正常完成
+TEST_CASE(Uring_GetSqeFull) {
+  if (not URING.Init(4)) {
+    std::cout << "io_uring not supported, skip" << std::endl;
+    return;
+  }
+  int ringFd = dup(URING.Fd());
+  int nullFd = open("/dev/null", O_RDONLY);
+  ASSERT_TRUE(dup2(nullFd, URING.Fd()) >= 0);
+  Core::UringRequest requests[4];
+  for (int i = 0; i < 4; i++) {
+    io_uring_sqe* sqe = URING.GetSqe();
+    ASSERT_TRUE(sqe != nullptr);
+    sqe->opcode = IORING_OP_NOP;
+    requests[i].cid_ = i;
+    sqe->user_data = (uint64_t)&requests[i];
+  }
+  ASSERT_TRUE(URING.GetSqe() == nullptr);
+  ASSERT_TRUE(dup2(ringFd, URING.Fd()) >= 0);
+  ASSERT_EQ(URING.Submit(), 4);
+  std::vector<int> cids;
+  for (int i = 0; i < 100 && cids.size() < 4; i++) {
+    for (int cid : URING.Reap()) {
+      cids.push_back(cid);
+    }
+  }
+  ASSERT_EQ(cids.size(), 4);
+  for (int i = 0; i < 4; i++) {
+    ASSERT_EQ(cids[i], i);
+  }
+  close(ringFd);
+  close(nullFd);
+  URING.Exit();
+}
@@ -0,0 +1,72 @@
+#include <iostream>
+#include <vector>
+
+#include "../common/timedeal.hpp"
+#include "../core/waitgroup.hpp"
+#include "unittestcore.h"
+
+typedef struct FanOutArg {
+  int child_count_;
+  int finish_count_;
+} FanOutArg;
+
+void WaitGroupChild(void* arg) {
+  MyCoroutine::CoroutineYield(SCHEDULE);  // 模拟rpc调用时让出cpu
+  (*(int*)arg)++;
+}
+
+void WaitGroupParent(void* arg) {
+  FanOutArg* fanOutArg = (FanOutArg*)arg;
+  Core::WaitGroup wg;
+  for (int i = 0; i < fanOutArg->child_count_; i++) {
+    wg.Add(WaitGroupChild, &fanOutArg->finish_count_);
+  }
+  wg.Wait();
+  if (fanOutArg->finish_count_ == fanOutArg->child_count_) {  // Wait返回时所有子协程都执行完了
+    fanOutArg->finish_count_ = -1;
+  }
+}
+
+TEST_CASE(WaitGroup_Wait) {
+  FanOutArg fanOutArg{3, 0};
+  MyCoroutine::ScheduleInit(SCHEDULE, 10, 8 * 1024);
+  MyCoroutine::CoroutineCreate(SCHEDULE, WaitGroupParent, &fanOutArg);
+  while (MyCoroutine::ScheduleRunning(SCHEDULE)) {
+    MyCoroutine::CoroutineResume(SCHEDULE);
+  }
+  ASSERT_EQ(fanOutArg.finish_count_, -1);
+  MyCoroutine::ScheduleClean(SCHEDULE);
+}
+
+// 没有添加任何任务的WaitGroup，Wait直接返回
+TEST_CASE(WaitGroup_Empty) {
+  FanOutArg fanOutArg{0, 0};
+  MyCoroutine::ScheduleInit(SCHEDULE, 10, 8 * 1024);
+  int cid = MyCoroutine::CoroutineCreate(SCHEDULE, WaitGroupParent, &fanOutArg);
+  MyCoroutine::CoroutineResumeById(SCHEDULE, cid);
+  ASSERT_EQ(fanOutArg.finish_count_, -1);
+  ASSERT_FALSE(MyCoroutine::ScheduleRunning(SCHEDULE));
+  MyCoroutine::ScheduleClean(SCHEDULE);
+}
+
+// 扇出1到1000个子协程，每个子协程的平均耗时不应该随扇出的个数增长
+TEST_CASE(WaitGroup_FanOutBenchmark) {
+  int childCounts[] = {1, 10, 100, 1000};
+  MyCoroutine::ScheduleInit(SCHEDULE, 1024, 8 * 1024);
+  for (int childCount : childCounts) {
+    int loop = 100000 / childCount;
+    Common::TimeStat timeStat;
+    for (int i = 0; i < loop; i++) {
+      FanOutArg fanOutArg{childCount, 0};
+      MyCoroutine::CoroutineCreate(SCHEDULE, WaitGroupParent, &fanOutArg);
+      while (MyCoroutine::ScheduleRunning(SCHEDULE)) {
+        MyCoroutine::CoroutineResume(SCHEDULE);
+      }
+      ASSERT_EQ(fanOutArg.finish_count_, -1);
+    }
+    int64_t spendUs = timeStat.GetSpendTimeUs();
+    std::cout << "fan_out = " << childCount << ", cost per child = " << spendUs * 1000 / (loop * childCount) << "ns"
+              << std::endl;
+  }
+  MyCoroutine::ScheduleClean(SCHEDULE);
+}
@@ -0,0 +1,127 @@
+#include <poll.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "../core/workstealdeque.hpp"
+#include "unittestcore.h"
+
+// 所属线程不断插入和取出，同时多个线程并发窃取，每个元素只能被取出一次
+TEST_CASE(WorkStealDeque_ConcurrentSteal) {
+  const int itemCount = 200000;
+  std::vector<int> items(itemCount, 0);
+  std::vector<std::atomic<int>> takeCount(itemCount);
+  for (auto& count : takeCount) count = 0;
+  Core::WorkStealDeque<int> deque(1024);
+  std::atomic<bool> done{false};
+  std::vector<std::thread> thieves;
+  for (int t = 0; t < 3; t++) {
+    thieves.emplace_back([&]() {
+      while (not done.load() || deque.Size() > 0) {
+        int* item = deque.Steal();
+        if (item) takeCount[item - items.data()]++;
+      }
+    });
+  }
+  for (int i = 0; i < itemCount; i++) {
+    while (not deque.Push(&items[i])) {  // 队列满了，所属线程自己取出一些
+      int* item = deque.Pop();
+      if (item) takeCount[item - items.data()]++;
+    }
+    if (i % 3 == 0) {
+      int* item = deque.Pop();
+      if (item) takeCount[item - items.data()]++;
+    }
+  }
+  done = true;
+  for (auto& thief : thieves) thief.join();
+  int* item = nullptr;
+  while ((item = deque.Pop()) != nullptr) takeCount[item - items.data()]++;
+  int errCount = 0;
+  for (auto& count : takeCount) {
+    if (count != 1) errCount++;
+  }
+  ASSERT_EQ(errCount, 0);
+}
+
+typedef struct SkewTask {
+  int64_t enqueue_us_;
+  int64_t finish_us_;
+} SkewTask;
+
+int64_t NowUs() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void SkewTaskRun(SkewTask* task) {
+  int64_t beginUs = NowUs();
+  while (NowUs() - beginUs < 20) {  // 模拟20us的cpu计算
+  }
+  task->finish_us_ = NowUs();
+}
+
+int64_t SkewLoadP99(int threadCount, bool workStealing) {
+  const int taskCount = 20000;
+  std::vector<SkewTask> tasks(taskCount);
+  std::vector<std::unique_ptr<Core::WorkStealDeque<SkewTask>>> deques;
+  for (int i = 0; i < threadCount; i++) deques.emplace_back(new Core::WorkStealDeque<SkewTask>(32768));
+  std::atomic<int> finishCount{0};
+  std::vector<std::thread> threads;
+  for (int i = 0; i < threadCount; i++) {
+    threads.emplace_back([&, i]() {
+      while (finishCount.load() < taskCount) {
+        SkewTask* task = deques[i]->Steal();
+        for (int j = 1; workStealing && nullptr == task && j < threadCount; j++) {
+          task = deques[(i + j) % threadCount]->Steal();
+        }
+        if (nullptr == task) continue;
+        SkewTaskRun(task);
+        finishCount++;
+      }
+    });
+  }
+  for (int i = 0; i < taskCount; i++) {  // 所有的任务都落到0号线程上
+    tasks[i].enqueue_us_ = NowUs();
+    deques[0]->Push(&tasks[i]);
+    if (i % 4 == 3) std::this_thread::sleep_for(std::chrono::microseconds(10));
+  }
+  for (auto& thread : threads) thread.join();
+  std::vector<int64_t> latency;
+  for (auto& task : tasks) latency.push_back(task.finish_us_ - task.enqueue_us_);
+  std::sort(latency.begin(), latency.end());
+  return latency[latency.size() * 99 / 100];
+}
+
+// 任务都由0号线程（模拟繁忙的subReactor）产生，队列的Push只在生产线程中调用，工作线程都通过Steal取任务。
+// 负载倾斜时，开启工作窃取后，请求的尾延迟应该明显下降
+TEST_CASE(WorkStealDeque_SkewedLoadBenchmark) {
+  int threadCount = std::max(2u, std::min(4u, std::thread::hardware_concurrency()));
+  int64_t offP99 = SkewLoadP99(threadCount, false);
+  int64_t onP99 = SkewLoadP99(threadCount, true);
+  std::cout << "threads = " << threadCount << ", work_stealing off p99 = " << offP99
+            << "us, work_stealing on p99 = " << onP99 << "us" << std::endl;
+}
+
+// 只唤醒标记了空闲的subReactor，每次唤醒一个，被唤醒的subReactor的空闲标记被清除
+TEST_CASE(IdleWaker_WakeOne) {
+  Core::IdleWaker waker(3);
+  ASSERT_FALSE(waker.WakeOne(0));  // 没有空闲的subReactor
+  waker.SetIdle(0, true);
+  ASSERT_FALSE(waker.WakeOne(0));  // 不唤醒自己
+  waker.SetIdle(2, true);
+  ASSERT_TRUE(waker.WakeOne(0));
+  struct pollfd pfd = {waker.Fd(2), POLLIN, 0};
+  ASSERT_EQ(poll(&pfd, 1, 0), 1);
+  pfd.fd = waker.Fd(1);
+  ASSERT_EQ(poll(&pfd, 1, 0), 0);
+  waker.Drain(2);
+  pfd.fd = waker.Fd(2);
+  ASSERT_EQ(poll(&pfd, 1, 0), 0);
+  ASSERT_TRUE(waker.WakeOne(1));  // 2已经被唤醒，唤醒的是0
+  ASSERT_FALSE(waker.WakeOne(1));
+}
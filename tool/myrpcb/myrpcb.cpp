@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <iostream>
 #include <mutex>
 #include <string>
@@ -23,8 +24,12 @@ bool fastResp;
 int64_t sleepTime = 2; // 默认sleep 2秒
 int64_t totalTime;
 int64_t concurrency;
+int64_t requestCount = 1; // 每个连接发送的请求数
+int64_t depth = 1;        // 每个连接pipeline发送的请求数，发送完一批再按顺序接收应答
+int threadCount = 10;     // 压测线程数
 
 typedef struct Stat {
+    int conns{0};
     int sum{0};
     int success{0};
     int failure{0};
@@ -93,13 +98,14 @@ int getSpendMs(timeval begin, timeval end)
 }
 
 void UpdateFinalStat(Stat stat) {
+    FinalStat.conns += stat.conns;
     FinalStat.sum += stat.sum;
     FinalStat.success += stat.success;
     FinalStat.failure += stat.failure;
     FinalStat.spendms += stat.spendms;
 }
 
-bool SendRequest(int sockFd)
+bool SendRequest(int sockFd, int count = 1)
 {
     Protocol::Packet pkt;
     Protocol::MySvrCodec codec;
@@ -114,8 +120,11 @@ bool SendRequest(int sockFd)
         reqMessage.EnableFastResp(); // 开启fast-resp的flag
     }
     codec.Encode(&reqMessage, pkt);
+    std::string data; // pipeline模式下一次写入多个请求
+    for (int i = 0; i < count; i++)
+        data.append((char *)pkt.DataRaw(), pkt.UseLen());
     Common::RobustIo robustIo(sockFd);
-    if (robustIo.Write(pkt.DataRaw(), pkt.UseLen()) != (ssize_t)pkt.UseLen())
+    if (robustIo.Write((uint8_t *)data.data(), data.size()) != (ssize_t)data.size())
     {
         cout << RED_BEGIN << "send request failed." << COLOR_END << endl;
         return false;
@@ -157,58 +166,66 @@ bool RecvResponse(int sockFd) {
 
 void client(int theadId, Stat *curStat, Core::Route route)
 {
-    int sum = 0, success = 0, failure = 0, spendms = 0;
+    int conns = 0, sum = 0, success = 0, failure = 0, spendms = 0;
 
-    int concurrencyPerThread = concurrency / 10; // 每个线程的并发数
+    int concurrencyPerThread = concurrency / threadCount; // 每个线程的并发数
     if (concurrencyPerThread <= 0)
         concurrencyPerThread = 1;
     int *sockFd = new int[concurrencyPerThread];
+    int64_t *finished = new int64_t[concurrencyPerThread]; // 每个连接已经完成的请求数
     timeval end;
     timeval begin;
     gettimeofday(&begin, NULL);
     for (int i = 0; i < concurrencyPerThread; i++){
+        conns++;
+        finished[i] = 0;
         sockFd[i] = createSockAndConnect(route);
         if (sockFd[i] < 0) {
             sockFd[i] = 0;
-            failure++;
+            failure += requestCount;
         }
     }
-    auto failureDeal = [&sockFd, &failure](int i) {
+    auto failureDeal = [&sockFd, &finished, &failure](int i) { // 连接上剩余的请求都算失败
         close(sockFd[i]);
         sockFd[i] = 0;
-        failure++;
+        failure += requestCount - finished[i];
     };
     std::cout << "threadId[" << theadId << "] finish connection" << std::endl;
-    for (int i = 0; i < concurrencyPerThread; i++) {
-        if (sockFd[i])
-            if (not SendRequest(sockFd[i]))
-                failureDeal(i);
+    // 每个连接发送requestCount个请求，每批pipeline发送depth个请求，所有连接都发送完之后再按顺序接收应答
+    for (int64_t sent = 0; sent < requestCount; sent += depth) {
+        int count = (int)std::min(depth, requestCount - sent);
+        for (int i = 0; i < concurrencyPerThread; i++) {
+            if (sockFd[i])
+                if (not SendRequest(sockFd[i], count))
+                    failureDeal(i);
+        }
+        for (int i = 0; i < concurrencyPerThread; i++) {
+            for (int j = 0; sockFd[i] && j < count; j++) {
+                if (not oneway && not RecvResponse(sockFd[i])) {
+                    failureDeal(i);
+                    break;
+                }
+                finished[i]++;
+                success++;
+            }
+        }
     }
     std::cout << "threadId[" << theadId << "] finish send message" << std::endl;
     for (int i = 0; i < concurrencyPerThread; i++) {
-        if (sockFd[i]) {
-            if (oneway) {
-                close(sockFd[i]);
-                success++;
-                continue;
-            }
-            if (not RecvResponse(sockFd[i])) {
-                failureDeal(i);
-                continue;
-            }
+        if (sockFd[i])
             close(sockFd[i]);
-            success++;
-        }
     }
     if (not oneway)
     {
         std::cout << "threadId[" << theadId << "] finish recv message" << std::endl;
     }
     delete[] sockFd;
+    delete[] finished;
     sum = success + failure;
     gettimeofday(&end, NULL);
     spendms = getSpendMs(begin, end);
     std::lock_guard<std::mutex> guard(Mutex);
+    curStat->conns += conns;
     curStat->sum += sum;
     curStat->success += success;
     curStat->failure += failure;
@@ -218,7 +235,7 @@ void client(int theadId, Stat *curStat, Core::Route route)
 void usage()
 {
     cout << "myrpcb -service_name Echo -rpc_name EchoMySelf -json "
-         << "'{\"message\":\"hello\"}' -t 10 -c 1000 [-a -o -f]" << endl;
+         << "'{\"message\":\"hello\"}' -t 10 -c 1000 [-n 1 -d 1 -a -o -f]" << endl;
     cout << "options:" << endl;
     cout << "    -h,--help     print usage" << endl;
     cout << "    -service_name service name" << endl;
@@ -227,6 +244,8 @@ void usage()
     cout << "    -s            sleep time(unit second)" << endl;
     cout << "    -t            benchmark total time" << endl;
     cout << "    -c            benchmark concurrency" << endl;
+    cout << "    -n            request count per connection" << endl;
+    cout << "    -d            pipeline depth per connection" << endl;
     cout << "    -a            by access service" << endl;
     cout << "    -o            is oneway message mode" << endl;
     cout << "    -f            is fast response message mode" << endl;
@@ -241,18 +260,21 @@ void execBenchMark()
     while (true) {
         Stat curStat;
         std::thread threads[10];
-        for (int threadId = 0; threadId < 10; threadId++) {
+        for (int threadId = 0; threadId < threadCount; threadId++) {
             Core::Route route = getRoute(threadId + 1);
             threads[threadId] = std::thread(client, threadId, &curStat, route);
         }
-        for (int threadId = 0; threadId < 10; threadId++)
+        for (int threadId = 0; threadId < threadCount; threadId++)
             threads[threadId].join();
 
         runRoundCount++;
-        curStat.spendms /= 10;
+        curStat.spendms /= threadCount;
         UpdateFinalStat(curStat);
         gettimeofday(&end, NULL);
-        std::cout << "round " << runRoundCount << " spend " << curStat.spendms << " ms. " << std::endl;
+        // 每个请求都使用新建的连接，连接速率可以用来对比mainReactor迁移和subReactor直接接受连接的开销
+        std::cout << "round " << runRoundCount << " spend " << curStat.spendms << " ms. conn rate "
+                  << (curStat.spendms > 0 ? curStat.conns * 1000LL / curStat.spendms : 0) << "/s. qps "
+                  << (curStat.spendms > 0 ? curStat.sum * 1000LL / curStat.spendms : 0) << std::endl;
         if (getSpendMs(begin, end) >= totalTime * 1000) {
             break;
         }
@@ -261,7 +283,9 @@ void execBenchMark()
     std::cout << "total spend " << FinalStat.spendms 
               << " ms. avg spend " << FinalStat.spendms / runRoundCount
               << " ms. sum[" << FinalStat.sum << "],success[" 
-              << FinalStat.success << "],failure[" << FinalStat.failure << "]" << std::endl;
+              << FinalStat.success << "],failure[" << FinalStat.failure << "] conn rate["
+              << (FinalStat.spendms > 0 ? FinalStat.conns * 1000LL / FinalStat.spendms : 0) << "/s] qps["
+              << (FinalStat.spendms > 0 ? FinalStat.sum * 1000LL / FinalStat.spendms : 0) << "]" << std::endl;
 }
 
 int main(int argc, char *argv[])
@@ -272,11 +296,18 @@ int main(int argc, char *argv[])
     Common::CmdLine::Int64Opt(&totalTime, "t", 1);
     Common::CmdLine::Int64Opt(&concurrency, "c", 1);
     Common::CmdLine::Int64Opt(&sleepTime, "s", 2);
+    Common::CmdLine::Int64Opt(&requestCount, "n", 1);
+    Common::CmdLine::Int64Opt(&depth, "d", 1);
     Common::CmdLine::BoolOpt(&byAccessService, "a");
     Common::CmdLine::BoolOpt(&oneway, "o");
     Common::CmdLine::BoolOpt(&fastResp, "f");
     Common::CmdLine::SetUsage(usage);
     Common::CmdLine::Parse(argc, argv);
+    if (requestCount < 1)
+        requestCount = 1;
+    if (depth < 1)
+        depth = 1;
+    threadCount = concurrency < 10 ? (concurrency > 0 ? (int)concurrency : 1) : 10;
     execBenchMark();
     return 0;
 }
\ No newline at end of file